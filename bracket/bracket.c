@@ -1,6 +1,6 @@
 /****************************************************************************
 FILE          : bracket.c
-LAST REVISION : July 1993
+LAST REVISION : October 2026
 SUBJECT       : Program to check brace/bracket matching in C/C++ source code.
 PROGRAMMER    : Peter Chapin
 
@@ -15,11 +15,21 @@ are printed as close to the source of the error as possible (the actual
 error will always be above the message).
 
 The program notices unclosed comments, literals, or {...} pairs at the end
-of the file. The message produced by the program may be more useful than
-the "Unexpected EOF" message produced by many compilers.
+of the file. When an opener is never closed its line and column are given.
+The message produced by the program may be more useful than the
+"Unexpected EOF" message produced by many compilers.
 
 The program correctly disregards material inside of comments or literals.
 
+If files or directories are named on the command line the program checks
+them instead, several at a time, and prints only a line of the form
+
+     file:line:column: error: message
+
+for each problem. Directories are searched for C/C++ source files. The
+exit status is 1 if there were any problems. This is meant for checking
+large collections of files automatically.
+
 Please send comments or bug reports to
 
      Peter Chapin
@@ -30,25 +40,64 @@ Please send comments or bug reports to
 
 #include "local.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "standard.h"
 #include "ansiscrn.h"
 #include "scanners.h"
+#include "brcheck.h"
 
-/*=========================================*/
-/*           Function Defintions           */
-/*=========================================*/
+#if defined(__unix__) || defined(__APPLE__)
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define HAVE_DIRENT
+#endif
 
-/*--------------------------------------------------------------------------
-int grab_char(void);
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L && !defined(__STDC_NO_THREADS__)
+#include <threads.h>
+#define HAVE_THREADS
+#endif
 
-This function is used by the CmtScan module to extract characters from the
-input file. In this program, characters are simply taken from stdin.
---------------------------------------------------------------------------*/
+/*=================================*/
+/*           Global Data           */
+/*=================================*/
 
-int grab_char(void)
-  {
-    return getchar();
-  }
+#define BLOCK_SIZE 65536
+#define MAX_ERRORS 20         /* Default limit on messages per file. */
+
+PRIVATE char   buffer[BLOCK_SIZE];  /* Holds a block of the input.       */
+PRIVATE size_t shown;               /* Number of chars in buffer printed. */
+
+/* The following are used when checking files. */
+
+typedef struct {
+  char   *name;
+  char   *output;             /* Messages for this file (or NULL).  */
+  size_t  output_length;
+  size_t  output_size;
+  long    error_count;
+  boolean failed;             /* =YES if the file had any problems. */
+} FileJob;
+
+PRIVATE FileJob *jobs = NULL;
+PRIVATE size_t   job_count = 0;
+PRIVATE size_t   job_size = 0;
+PRIVATE size_t   next_job = 0;
+PRIVATE long     max_errors = MAX_ERRORS;
+
+#ifdef HAVE_THREADS
+PRIVATE mtx_t    job_lock;         /* Protects next_job. */
+#endif
+
+/* Files with these extensions are checked when a directory is searched. */
+PRIVATE const char *source_types[] = {
+  ".c", ".h", ".cpp", ".hpp", ".cc", ".hh", ".cxx", ".hxx", NULL
+  };
+
+/*=========================================*/
+/*           Function Defintions           */
+/*=========================================*/
 
 /*--------------------------------------------------------------------------
 The error handling functions print the error messages of the program. The
@@ -57,114 +106,444 @@ close to the source of the error. ANSI escape sequences are used to display
 the messages in interesting attributes so they stand out.
 --------------------------------------------------------------------------*/
 
-void error(char *message)
+void error(const char *message)
   {
     Bold_On(); Blink_On();
     printf(" <= ERROR: %s ", message);
     Reset_Screen();
   }
 
-void warning(char *message)
+void warning(const char *message)
   {
     Bold_On();
     printf(" <= WARNING: %s ", message);
     Reset_Screen();
   }
 
-void eof_error(char *message)
+void eof_error(const char *message)
   {
     Bold_On(); Blink_On();
     printf("\n\nERROR: %s", message);
     Reset_Screen();
   }
 
-/*==================================*/
-/*           Main Program           */
-/*==================================*/
+/*--------------------------------------------------------------------------
+void show_message(void *context, const BrMessage *message);
+
+This function receives the messages from the checker when the program is
+copying its input to its output. The input is printed up to and including
+the character that showed the problem (all of it at the end of the input)
+and then the message is printed. If the character at fault is somewhere
+else (an opener that was never closed, for example) its position is added.
+--------------------------------------------------------------------------*/
+
+PRIVATE
+void show_message(void *context, const BrMessage *message)
+  {
+    size_t end = message->at_eof ? message->offset : message->offset + 1;
+    char   text[128];
+
+    (void)context;
+    fwrite(buffer + shown, 1, end - shown, stdout);
+    shown = end;
+    if (message->at_eof || message->closer != 0)
+      sprintf(text, "%s at %ld:%ld", message->text, message->line, message->column);
+    else
+      sprintf(text, "%s", message->text);
+
+    if (message->at_eof) eof_error(text);
+    else if (message->severity == BR_ERROR) error(text);
+    else warning(text);
+  }
+
+/*--------------------------------------------------------------------------
+void echo_input(void);
+
+This function checks the standard input and copies it to the standard
+output with the messages in line. This is what the program has always done.
+--------------------------------------------------------------------------*/
+
+PRIVATE
+void echo_input(void)
+  {
+    BrChecker checker;  /* State of the checker.               */
+    size_t held = 0;    /* Chars carried over from last block. */
+    size_t count;       /* Number of chars in buffer.          */
+    size_t used;        /* Number of chars checked.            */
+    boolean at_end;     /* =YES if this is the last block.     */
+
+    BrReset(&checker, show_message, NULL);
+    do {
+      count  = held + fread(buffer + held, 1, BLOCK_SIZE - held, stdin);
+      at_end = (feof(stdin) || ferror(stdin)) ? YES : NO;
+      shown  = 0;
+      used   = BrCheckBlock(&checker, buffer, count, at_end);
+      if (used > shown) fwrite(buffer + shown, 1, used - shown, stdout);
+
+      /* A '/' at the end of the block is given again with the next one. */
+      held = count - used;
+      if (held != 0) buffer[0] = buffer[used];
+    } while (!at_end);
+    BrFree(&checker);
+  }
+
+/*--------------------------------------------------------------------------
+void *get_memory(void *old, size_t size);
+
+This function is realloc() that gives up on the program if it fails.
+--------------------------------------------------------------------------*/
+
+PRIVATE
+void *get_memory(void *old, size_t size)
+  {
+    void *p = realloc(old, size);
+
+    if (p == NULL) {
+      fprintf(stderr, "BRACKET: Out of memory\n");
+      exit(2);
+    }
+    return p;
+  }
+
+/*--------------------------------------------------------------------------
+void add_file(const char *name);
+
+This function adds a file to the list of files to check.
+--------------------------------------------------------------------------*/
+
+PRIVATE
+void add_file(const char *name)
+  {
+    FileJob *job;
+
+    if (job_count == job_size) {
+      job_size = (job_size == 0) ? 64 : 2 * job_size;
+      jobs = (FileJob *)get_memory(jobs, job_size * sizeof(FileJob));
+    }
+    job = &jobs[job_count++];
+    job->name = (char *)get_memory(NULL, strlen(name) + 1);
+    strcpy(job->name, name);
+    job->output = NULL;
+    job->output_length = job->output_size = 0;
+    job->error_count = 0;
+    job->failed = NO;
+  }
+
+/*--------------------------------------------------------------------------
+void add_directory(const char *path);
+
+This function adds the C/C++ source files in a directory, and in all the
+directories below it, to the list of files to check. Symbolic links to
+directories are not followed so the search can't go around in circles.
+--------------------------------------------------------------------------*/
+
+#ifdef HAVE_DIRENT
+
+PRIVATE
+boolean is_source(const char *name)
+  {
+    const char  *dot = strrchr(name, '.');
+    const char **type;
+
+    if (dot == NULL) return NO;
+    for (type = source_types; *type != NULL; type++) {
+      if (strcmp(dot, *type) == 0) return YES;
+    }
+    return NO;
+  }
+
+PRIVATE
+void add_directory(const char *path)
+  {
+    DIR           *directory;
+    struct dirent *entry;
+    struct stat    info;
+    char          *name;
+
+    if ((directory = opendir(path)) == NULL) {
+      fprintf(stderr, "BRACKET: Can't open directory %s\n", path);
+      return;
+    }
+    while ((entry = readdir(directory)) != NULL) {
+      if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+      name = (char *)get_memory(NULL, strlen(path) + strlen(entry->d_name) + 2);
+      sprintf(name, "%s/%s", path, entry->d_name);
+      if (lstat(name, &info) == 0) {
+        if (S_ISDIR(info.st_mode)) add_directory(name);
+        else if (is_source(entry->d_name) && stat(name, &info) == 0 && S_ISREG(info.st_mode))
+          add_file(name);
+      }
+      free(name);
+    }
+    closedir(directory);
+  }
+
+#endif
+
+/*--------------------------------------------------------------------------
+void add_name(const char *name);
+
+This function adds a name from the command line or from a list file. A
+directory is searched; anything else is taken to be a file.
+--------------------------------------------------------------------------*/
+
+PRIVATE
+void add_name(const char *name)
+  {
+#ifdef HAVE_DIRENT
+    struct stat info;
+
+    if (stat(name, &info) == 0 && S_ISDIR(info.st_mode)) {
+      add_directory(name);
+      return;
+    }
+#endif
+    add_file(name);
+  }
 
 /*--------------------------------------------------------------------------
-int main(void);
+boolean add_list(const char *list_name);
 
-The main function extracts characters from the CmtScan module (which
-analysizes the input stream for C/C++ comments and literals). If the
-character is in the normal code region, it is checked for the various
-interesting characters ("{}()[]"). If an error is found, corrective action
-is often taken to prevent a "cascade" of error messages.
+This function adds the names in a list file, one per line. The name "-"
+means the standard input. It returns NO if the list can't be read.
 --------------------------------------------------------------------------*/
 
-int main(void)
-  {
-    int ch;             /* Character obtained after filtering. */
-    int brace = 0;      /* {...} level.                        */
-    int parens = 0;     /* (...) level.                        */
-    int bracket = 0;    /* [...] level.                        */
-
-    CmtScanInit(grab_char);
-    while ((ch=CmtScanGetChar()) != EOF) {
-      putchar(ch);
-      if (!Comment && !DoubleQuote && !SingleQuote) {
-        switch (ch) {
-
-          case '{':
-            brace++;
-            if (parens > 0) {
-              error("Extra (");
-              parens = 0;
-            }
-            if (bracket > 0) {
-              error("Extra [");
-              bracket = 0;
-            }
-            break;
-
-          case '}':
-            brace--;
-            if (brace == -1) {
-              error("Extra }");
-              brace = 0;
-            }
-            if (parens > 0) {
-              error("Extra (");
-              parens = 0;
-            }
-            if (bracket > 0) {
-              error("Extra [");
-              bracket = 0;
-            }
-            if (brace == 0) warning("Brace level now at zero");
-            break;
-
-          case '(':
-            parens++;
-            break;
-
-          case ')':
-            parens--;
-            if (parens == -1) {
-              error("Extra )");
-              parens = 0;
-            }
-            break;
-
-          case '[':
-            bracket++;
-            break;
-
-          case ']':
-            bracket--;
-            if (bracket == -1) {
-              error("Extra ]");
-              bracket = 0;
-            }
-            break;
-        }
+PRIVATE
+boolean add_list(const char *list_name)
+  {
+    FILE  *list;
+    char   line[1024];
+    size_t length;
+
+    list = (strcmp(list_name, "-") == 0) ? stdin : fopen(list_name, "r");
+    if (list == NULL) {
+      fprintf(stderr, "BRACKET: Can't open list %s\n", list_name);
+      return NO;
+    }
+    while (fgets(line, sizeof(line), list) != NULL) {
+      length = strlen(line);
+      while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')) length--;
+      line[length] = '\0';
+      if (length > 0) add_name(line);
+    }
+    if (list != stdin) fclose(list);
+    return YES;
+  }
+
+/*--------------------------------------------------------------------------
+void note(FileJob *job, long line, long column, const char *text);
+
+This function adds a message to a file's output. A line of zero means the
+message is about the file as a whole.
+--------------------------------------------------------------------------*/
+
+PRIVATE
+void note(FileJob *job, long line, long column, const char *text)
+  {
+    size_t needed = strlen(job->name) + strlen(text) + 64;
+
+    if (job->output_length + needed > job->output_size) {
+      job->output_size = 2 * (job->output_length + needed);
+      job->output = (char *)get_memory(job->output, job->output_size);
+    }
+    if (line == 0) {
+      job->output_length += sprintf(
+        job->output + job->output_length, "%s: error: %s\n", job->name, text);
+    }
+    else {
+      job->output_length += sprintf(
+        job->output + job->output_length, "%s:%ld:%ld: error: %s\n",
+        job->name, line, column, text);
+    }
+    job->failed = YES;
+  }
+
+/*--------------------------------------------------------------------------
+void record_message(void *context, const BrMessage *message);
+
+This function receives the messages from the checker when files are being
+checked. Warnings are dropped. After max_errors errors the rest are dropped
+too so the output can't grow with the size of the file.
+--------------------------------------------------------------------------*/
+
+PRIVATE
+void record_message(void *context, const BrMessage *message)
+  {
+    FileJob *job = (FileJob *)context;
+    char     text[128];
+
+    if (message->severity != BR_ERROR) return;
+    job->error_count++;
+    if (job->error_count <= max_errors) {
+      if (message->closer != 0) {
+        sprintf(text, "%s before %c at %ld:%ld",
+          message->text, message->closer, message->closer_line, message->closer_column);
       }
+      else sprintf(text, "%s", message->text);
+      note(job, message->line, message->column, text);
+    }
+    else if (job->error_count == max_errors + 1) note(job, 0, 0, "Too many errors; giving up");
+  }
+
+/*--------------------------------------------------------------------------
+void check_file(FileJob *job, char *block);
+
+This function checks one file. The block is a BLOCK_SIZE work area.
+--------------------------------------------------------------------------*/
+
+PRIVATE
+void check_file(FileJob *job, char *block)
+  {
+    BrChecker checker;
+    FILE     *file;
+    size_t    held = 0;
+    size_t    count;
+    size_t    used;
+    boolean   at_end;
+
+    if ((file = fopen(job->name, "rb")) == NULL) {
+      note(job, 0, 0, "Can't open file");
+      return;
     }
+    BrReset(&checker, record_message, job);
+    do {
+      count  = held + fread(block + held, 1, BLOCK_SIZE - held, file);
+      at_end = (feof(file) || ferror(file)) ? YES : NO;
+      used   = BrCheckBlock(&checker, block, count, at_end);
+      held   = count - used;
+      if (held != 0) block[0] = block[used];
+    } while (!at_end && job->error_count <= max_errors);
+    BrFree(&checker);
+
+    if (ferror(file)) note(job, 0, 0, "Error reading file");
+    fclose(file);
+  }
+
+/*--------------------------------------------------------------------------
+int worker(void *unused);
+
+Each worker takes files from the list until there are none left.
+--------------------------------------------------------------------------*/
 
-    if (brace > 0)        eof_error("Unclosed {...}");
-    if (OpenCommentError) eof_error("Unclosed comments");
-    if (DoubleQuote)      eof_error("Unclosed string literal");
-    if (SingleQuote)      eof_error("Unclosed character literal");
+PRIVATE
+int worker(void *unused)
+  {
+    char  *block = (char *)get_memory(NULL, BLOCK_SIZE);
+    size_t i;
 
+    (void)unused;
+    loop {
+#ifdef HAVE_THREADS
+      mtx_lock(&job_lock);
+#endif
+      i = next_job++;
+#ifdef HAVE_THREADS
+      mtx_unlock(&job_lock);
+#endif
+      if (i >= job_count) break;
+      check_file(&jobs[i], block);
+    }
+    free(block);
     return 0;
   }
+
+/*--------------------------------------------------------------------------
+int check_files(int thread_count);
+
+This function checks all the files on the list and prints their messages
+in the order the files were named. It returns the exit status.
+--------------------------------------------------------------------------*/
+
+PRIVATE
+int check_files(int thread_count)
+  {
+    size_t i;
+    int    status = 0;
+
+#ifdef HAVE_THREADS
+    thrd_t *threads;
+    int     started;
+
+    mtx_init(&job_lock, mtx_plain);
+    if (thread_count > 1 && job_count > 1) {
+      if ((size_t)thread_count > job_count) thread_count = (int)job_count;
+      threads = (thrd_t *)get_memory(NULL, thread_count * sizeof(thrd_t));
+      for (started = 0; started < thread_count; started++) {
+        if (thrd_create(&threads[started], worker, NULL) != thrd_success) break;
+      }
+      if (started == 0) worker(NULL);
+      for (i = 0; i < (size_t)started; i++) thrd_join(threads[i], NULL);
+      free(threads);
+    }
+    else worker(NULL);
+    mtx_destroy(&job_lock);
+#else
+    (void)thread_count;
+    worker(NULL);
+#endif
+
+    for (i = 0; i < job_count; i++) {
+      if (jobs[i].output != NULL) fwrite(jobs[i].output, 1, jobs[i].output_length, stdout);
+      if (jobs[i].failed) status = 1;
+    }
+    return status;
+  }
+
+/*--------------------------------------------------------------------------
+int default_threads(void);
+
+This function returns the number of processors, if that can be found.
+--------------------------------------------------------------------------*/
+
+PRIVATE
+int default_threads(void)
+  {
+#if defined(HAVE_DIRENT) && defined(_SC_NPROCESSORS_ONLN)
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (count > 0) return (int)count;
+#endif
+    return 4;
+  }
+
+/*==================================*/
+/*           Main Program           */
+/*==================================*/
+
+/*--------------------------------------------------------------------------
+int main(int argc, char **argv);
+
+With no arguments the main function checks the standard input and copies
+it to the standard output with the messages in line. Otherwise it gathers
+the names of the files to check and checks them all. The switches are
+
+     -fname   Read the names of files (or directories) from a file.
+     -jn      Use n threads (default: one per processor).
+     -mn      Give up on a file after n errors (default: 20).
+--------------------------------------------------------------------------*/
+
+int main(int argc, char **argv)
+  {
+    int thread_count = default_threads();
+    int i;
+
+    if (argc == 1) {
+      echo_input();
+      return 0;
+    }
+
+    for (i = 1; i < argc; i++) {
+      if (argv[i][0] != '-' || argv[i][1] == '\0') add_name(argv[i]);
+      else if (argv[i][1] == 'f') {
+        if (!add_list(argv[i] + 2)) return 2;
+      }
+      else if (argv[i][1] == 'j' && atoi(argv[i] + 2) > 0) thread_count = atoi(argv[i] + 2);
+      else if (argv[i][1] == 'm' && atol(argv[i] + 2) > 0) max_errors = atol(argv[i] + 2);
+      else {
+        fprintf(stderr, "Usage: BRACKET < file.c\n");
+        fprintf(stderr, "       BRACKET [-fname] [-jn] [-mn] file_or_directory ...\n");
+        return 2;
+      }
+    }
+    return check_files(thread_count);
+  }
@@ -0,0 +1,397 @@
+/*****************************************************************************
+FILE          : brcheck.c
+LAST REVISION : October 2026
+SUBJECT       : Checking of {}, (), and [] in C/C++ source code.
+PROGRAMMER    : Peter Chapin
+
+This module checks C/C++ source text for problems with {}, (), and []. It
+uses the comment scanner to find the code between the comments and
+literals, and looks only at that.
+
+Every opener is pushed on a stack along with its line and column. A closer
+that matches the opener on top of the stack pops it. A closer that matches
+an opener further down shows that the openers above that one were never
+closed; each of them is reported at its own position, along with the
+position of the closer, and they are all popped. A closer that matches
+nothing on the stack is reported as extra and otherwise ignored. This
+keeps one mistake from causing a cascade of messages without a second
+pass over the input. At the end of the input, the openers still on the
+stack and any unclosed comment or literal are reported. An unclosed comment
+or literal is reported where it began. One that directly follows another
+of the same kind (as in "a""b) is part of the same run from the comment
+scanner, so it is reported where the first one began.
+
+The stack is an array that doubles in size when it is full, so pushing an
+opener almost never allocates memory even when millions are open at once.
+Each entry is eight bytes. Counts of each kind of opener on the stack are
+kept so a closer can tell at once if it has a match.
+
+The module works like this.
+
+1.   BrReset() prepares a BrChecker for a new file and records the
+     function to which messages are to be sent. BrFree() releases the
+     stack when the checker is no longer needed.
+
+2.   BrCheckBlock() is given a block of the file. Like CmtScanBlock() it
+     might not consume a '/' at the very end of a block; it returns the
+     number of characters it used and the rest must be presented again
+     at the start of the next block. The last block must be passed with
+     the final parameter YES. The end of input checks are done then.
+
+3.   Each message gives the line and column of the character at fault
+     and the offset in the current block where the problem was found.
+     The offset allows a caller that copies the input to its output to
+     put the message right after the character that showed the problem.
+     Columns count characters from 1; a tab is one character.
+
+4.   BrCopy() and BrSameState() allow the state of a check to be saved
+     and compared. The incremental checker in brincr.c uses them.
+
+     Please send comments and bug reports to
+
+     Peter Chapin
+     chapinp@proton.me
+
+*****************************************************************************/
+
+#include "local.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "standard.h"
+#include "scanners.h"
+#include "brcheck.h"
+
+/*=================================*/
+/*           Global Data           */
+/*=================================*/
+
+#define FIRST_STACK_SIZE 256
+#define MAX_COLUMN       0x3FFFFFFFUL   /* Larger columns are recorded as this. */
+
+PRIVATE const char  closers[]       = { '}', ')', ']' };
+PRIVATE const char *extra_text[]    = { "Extra }", "Extra )", "Extra ]" };
+PRIVATE const char *unclosed_text[] = { "Unclosed {", "Unclosed (", "Unclosed [" };
+
+/*==========================================*/
+/*           Function Definitions           */
+/*==========================================*/
+
+/*------------------------------------------------------------------------*/
+/* void BrReset(BrChecker *checker, BrReport report, void *context);      */
+/*                                                                        */
+/*      This function prepares a checker for a new input file. If the     */
+/*      checker was used before, BrFree() must be called first.           */
+/*------------------------------------------------------------------------*/
+
+PUBLIC
+void BrReset(BrChecker *checker, BrReport report, void *context)
+  {
+    CmtScanReset(&checker->scanner);
+    checker->line        = 1;
+    checker->column      = 1;
+    checker->item_kind   = CMT_CODE;
+    checker->item_line   = checker->item_column = 0;
+    checker->stack       = NULL;
+    checker->depth       = 0;
+    checker->stack_size  = 0;
+    checker->open[BR_BRACE] = checker->open[BR_PAREN] = checker->open[BR_BRACKET] = 0;
+    checker->overflow    = NO;
+    checker->error_count = 0;
+    checker->report      = report;
+    checker->context     = context;
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void BrFree(BrChecker *checker);                                       */
+/*                                                                        */
+/*      This function releases the memory used by a checker.              */
+/*------------------------------------------------------------------------*/
+
+PUBLIC
+void BrFree(BrChecker *checker)
+  {
+    free(checker->stack);
+    checker->stack = NULL;
+    checker->depth = checker->stack_size = 0;
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* boolean BrCopy(BrChecker *to, const BrChecker *from);                  */
+/*                                                                        */
+/*      This function makes to a copy of from with its own stack. Any     */
+/*      memory used by to must be freed first. It returns NO if there is  */
+/*      no memory for the stack; to then has an empty one.                */
+/*------------------------------------------------------------------------*/
+
+PUBLIC
+boolean BrCopy(BrChecker *to, const BrChecker *from)
+  {
+    *to = *from;
+    to->stack = NULL;
+    to->stack_size = 0;
+    if (from->depth == 0) return YES;
+    if ((to->stack = (BrOpener *)malloc(from->depth * sizeof(BrOpener))) == NULL) {
+      to->depth = 0;
+      return NO;
+    }
+    memcpy(to->stack, from->stack, from->depth * sizeof(BrOpener));
+    to->stack_size = from->depth;
+    return YES;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void send(BrChecker *checker, BrMessage *message);                     */
+/*                                                                        */
+/*      This function sends a message to the caller's report function.    */
+/*      The issue(), unclosed_item(), and unclosed() functions fill in    */
+/*      messages for it.                                                  */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+void send(BrChecker *checker, BrMessage *message)
+  {
+    if (message->severity == BR_ERROR) checker->error_count++;
+    if (checker->report != NULL) checker->report(checker->context, message);
+    return;
+  }
+
+PRIVATE
+void issue(
+  BrChecker *checker, int severity, boolean at_eof, size_t offset, const char *text)
+  {
+    BrMessage message;
+
+    message.severity = severity;
+    message.at_eof   = at_eof;
+    message.offset   = offset;
+    message.line     = checker->line;
+    message.column   = checker->column;
+    message.text     = text;
+    message.closer   = 0;
+    message.closer_line = message.closer_column = 0;
+    send(checker, &message);
+    return;
+  }
+
+PRIVATE
+void unclosed_item(BrChecker *checker, size_t offset, const char *text)
+  {
+    BrMessage message;
+
+    message.severity = BR_ERROR;
+    message.at_eof   = YES;
+    message.offset   = offset;
+    message.line     = checker->item_line;
+    message.column   = checker->item_column;
+    message.text     = text;
+    message.closer   = 0;
+    message.closer_line = message.closer_column = 0;
+    send(checker, &message);
+    return;
+  }
+
+PRIVATE
+void unclosed(
+  BrChecker *checker, const BrOpener *opener, boolean at_eof, size_t offset, int closer)
+  {
+    BrMessage message;
+
+    message.severity = BR_ERROR;
+    message.at_eof   = at_eof;
+    message.offset   = offset;
+    message.line     = (long)opener->line;
+    message.column   = (long)(opener->place >> 2);
+    message.text     = unclosed_text[opener->place & 3];
+    message.closer   = closer;
+    message.closer_line   = (closer != 0) ? checker->line : 0;
+    message.closer_column = (closer != 0) ? checker->column : 0;
+    send(checker, &message);
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void push(BrChecker *checker, int kind, size_t offset);                */
+/*                                                                        */
+/*      This function records an opener at the current position. If the   */
+/*      stack can't grow the brackets in the rest of the file are not     */
+/*      checked.                                                          */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+void push(BrChecker *checker, int kind, size_t offset)
+  {
+    BrOpener     *stack;
+    size_t        size;
+    unsigned long column = (unsigned long)checker->column;
+
+    if (checker->overflow) return;
+    if (checker->depth == checker->stack_size) {
+      size = (checker->stack_size == 0) ? FIRST_STACK_SIZE : 2 * checker->stack_size;
+      if ((stack = (BrOpener *)realloc(checker->stack, size * sizeof(BrOpener))) == NULL) {
+        issue(checker, BR_ERROR, NO, offset, "Out of memory; brackets not checked from here");
+        checker->overflow = YES;
+        return;
+      }
+      checker->stack = stack;
+      checker->stack_size = size;
+    }
+    if (column > MAX_COLUMN) column = MAX_COLUMN;
+    checker->stack[checker->depth].line  = (uint32_t)checker->line;
+    checker->stack[checker->depth].place = (uint32_t)((column << 2) | (unsigned long)kind);
+    checker->depth++;
+    checker->open[kind]++;
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void pop(BrChecker *checker, int kind, size_t offset);                 */
+/*                                                                        */
+/*      This function handles a closer at the current position (see the  */
+/*      top of this file).                                                */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+void pop(BrChecker *checker, int kind, size_t offset)
+  {
+    const BrOpener *top;
+    int             top_kind;
+
+    if (checker->overflow) return;
+    if (checker->open[kind] == 0) {
+      issue(checker, BR_ERROR, NO, offset, extra_text[kind]);
+      return;
+    }
+    loop {
+      top = &checker->stack[--checker->depth];
+      top_kind = (int)(top->place & 3);
+      checker->open[top_kind]--;
+      if (top_kind == kind) break;
+      unclosed(checker, top, NO, offset, closers[kind]);
+    }
+    if (kind == BR_BRACE && checker->open[BR_BRACE] == 0)
+      issue(checker, BR_WARNING, NO, offset, "Brace level now at zero");
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void pass_over(                                                        */
+/*   BrChecker *checker, const char *p, const CmtSpan *span);             */
+/*                                                                        */
+/*      This function moves the position past a comment or literal.       */
+/*      Only the last line of the span matters to the column.             */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+void pass_over(BrChecker *checker, const char *p, const CmtSpan *span)
+  {
+    const char *end = p + span->length;
+    const char *last;
+
+    if (span->newlines == 0) {
+      checker->column += (long)span->length;
+      return;
+    }
+    for (last = end - 1; *last != '\n'; last--) ;
+    checker->line  += span->newlines;
+    checker->column = (long)(end - last);
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void check_code(                                                       */
+/*   BrChecker *checker, const char *block, size_t offset,                */
+/*   size_t length);                                                      */
+/*                                                                        */
+/*      This function applies the rules to a span of code.                */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+void check_code(BrChecker *checker, const char *block, size_t offset, size_t length)
+  {
+    size_t end = offset + length;
+    size_t i;
+
+    for (i = offset; i < end; i++) {
+      switch (block[i]) {
+        case '\n':
+          checker->line++;
+          checker->column = 0;
+          break;
+
+        case '{': push(checker, BR_BRACE,   i); break;
+        case '(': push(checker, BR_PAREN,   i); break;
+        case '[': push(checker, BR_BRACKET, i); break;
+        case '}': pop(checker,  BR_BRACE,   i); break;
+        case ')': pop(checker,  BR_PAREN,   i); break;
+        case ']': pop(checker,  BR_BRACKET, i); break;
+      }
+      checker->column++;
+    }
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* size_t BrCheckBlock(                                                   */
+/*   BrChecker *checker, const char *block, size_t size, boolean at_end); */
+/*                                                                        */
+/*      This function checks a block of the input and returns the         */
+/*      number of characters it used (see the top of this file).          */
+/*------------------------------------------------------------------------*/
+
+PUBLIC
+size_t BrCheckBlock(BrChecker *checker, const char *block, size_t size, boolean at_end)
+  {
+    CmtSpan span;
+    size_t  used = 0;
+    size_t  i;
+
+    while (CmtScanSpan(&checker->scanner, block, size, &used, &span, at_end)) {
+      if (span.kind == CMT_CODE) check_code(checker, block, span.offset, span.length);
+      else {
+        /* A span of the same kind as the last continues it from the last block. */
+        if (span.kind != checker->item_kind) {
+          checker->item_line   = checker->line;
+          checker->item_column = checker->column;
+        }
+        pass_over(checker, block + span.offset, &span);
+      }
+      checker->item_kind = span.kind;
+    }
+
+    if (at_end && used == size) {
+      for (i = 0; i < checker->depth; i++) unclosed(checker, &checker->stack[i], YES, size, 0);
+      if (checker->scanner.OpenCommentError)
+        unclosed_item(checker, size, "Unclosed comments");
+      if (checker->scanner.OpenStringError)
+        unclosed_item(checker, size, "Unclosed string literal");
+      if (checker->scanner.OpenCharError)
+        unclosed_item(checker, size, "Unclosed character literal");
+    }
+    return used;
+  }
+
+/*------------------------------------------------------------------------*/
+/* boolean BrSameState(const BrChecker *a, const BrChecker *b);           */
+/*                                                                        */
+/*      This function returns YES if two checkers would treat the rest of */
+/*      the input in the same way. The stacks must hold the same openers  */
+/*      at the same positions since those positions might be reported    */
+/*      later, and so must the start of a comment or literal that is      */
+/*      still open. The current position and the error count don't       */
+/*      matter.                                                           */
+/*------------------------------------------------------------------------*/
+
+PUBLIC
+boolean BrSameState(const BrChecker *a, const BrChecker *b)
+  {
+    if (a->scanner.state != b->scanner.state) return NO;
+    if (a->item_kind != b->item_kind) return NO;
+    if (a->item_kind != CMT_CODE && a->item_kind != CMT_CPP_COMMENT &&
+        (a->item_line != b->item_line || a->item_column != b->item_column)) return NO;
+    if (a->overflow != b->overflow || a->depth != b->depth) return NO;
+    if (a->depth == 0) return YES;
+    return (memcmp(a->stack, b->stack, a->depth * sizeof(BrOpener)) == 0) ? YES : NO;
+  }
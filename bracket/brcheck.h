@@ -0,0 +1,84 @@
+/*****************************************************************************
+FILE     : brcheck.h
+CONTENTS : Checking of {}, (), and [] in C/C++ source code.
+PROGRAMMER    : Peter Chapin
+
+This file contains the interface to the module that does the real work of
+BRACKET. The caller supplies a BrChecker object, resets it at the start of
+each file, and passes the file through BrCheckBlock() in blocks. Problems
+are reported, as they are found, to a function supplied by the caller. All
+state is in the BrChecker object so any number of files can be checked at
+once (on different threads if desired).
+
+See BRCHECK.C for more information.
+
+*****************************************************************************/
+
+#ifndef BRCHECK_H
+#define BRCHECK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "scanners.h"
+
+/* The severity of a message. */
+#define BR_ERROR   0
+#define BR_WARNING 1   /* Not a problem; "Brace level now at zero" and such. */
+
+/* The kinds of openers. */
+#define BR_BRACE   0
+#define BR_PAREN   1
+#define BR_BRACKET 2
+
+typedef struct {
+  int         severity;       /* BR_ERROR or BR_WARNING.                  */
+  boolean     at_eof;         /* =YES if found at the end of the input.   */
+  size_t      offset;         /* Offset in the block where it was found.  */
+  long        line;           /* Position of the char at fault (1 based). */
+  long        column;         /*   For "Unclosed (" this is the opener.   */
+  const char *text;           /* For example "Extra }".                   */
+  int         closer;         /* The closer that showed an opener was     */
+  long        closer_line;    /*   never closed and its position. Zero    */
+  long        closer_column;  /*   if there isn't one.                    */
+} BrMessage;
+
+typedef void (*BrReport)(void *context, const BrMessage *message);
+
+/* An opener that hasn't been closed. Eight bytes, so millions will fit. */
+typedef struct {
+  uint32_t    line;
+  uint32_t    place;          /* Column * 4 + kind (BR_BRACE, etc).       */
+} BrOpener;
+
+typedef struct {
+  CmtScanner  scanner;        /* Finds the comments and literals.         */
+  long        line;           /* Position of the next char.               */
+  long        column;
+  int         item_kind;      /* Kind of the last span (CMT_xxx).         */
+  long        item_line;      /* Where the last comment or literal began, */
+  long        item_column;    /*   for the end of input messages.         */
+  BrOpener   *stack;          /* Openers not yet closed, outermost first. */
+  size_t      depth;          /* Number of openers on the stack.          */
+  size_t      stack_size;     /* Number of openers there is room for.     */
+  size_t      open[3];        /* Number of each kind on the stack.        */
+  boolean     overflow;       /* =YES if the stack couldn't grow.         */
+  long        error_count;    /* Number of BR_ERROR messages so far.      */
+  BrReport    report;         /* Where messages go.                       */
+  void       *context;        /* Passed to report.                        */
+} BrChecker;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern void    BrReset(BrChecker *, BrReport, void *);
+extern void    BrFree(BrChecker *);
+extern boolean BrCopy(BrChecker *, const BrChecker *);
+extern size_t  BrCheckBlock(BrChecker *, const char *, size_t, boolean);
+extern boolean BrSameState(const BrChecker *, const BrChecker *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
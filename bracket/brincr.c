@@ -0,0 +1,460 @@
+/*****************************************************************************
+FILE          : brincr.c
+LAST REVISION : October 2026
+SUBJECT       : Incremental checking of {}, (), and [] for editors.
+PROGRAMMER    : Peter Chapin
+
+An editor that checks a large file every time it is saved doesn't want to
+read the whole file again when only a line or two has changed. This module
+keeps the results of the last check along with checkpoints: copies of the
+checker's state (the comment scanner's state and the stack of openers) at
+the start of every interval'th line. After an edit the check resumes at
+the last checkpoint before the change. Once it is past the change, each
+time it reaches a line where the last check left a checkpoint it compares
+the states. If they are the same, the rest of the file must produce the
+same results as before, so the check stops there and the old results are
+kept (with their line numbers and offsets moved to allow for lines and
+characters added or removed). Openers in the saved states are moved the
+same way, except that those in the lines that changed can't be trusted and
+are given line zero so that the states never match while they are open.
+
+The module works like this.
+
+1.   BrIncInit() prepares a BrIncremental object. The interval is the
+     number of lines between checkpoints. A smaller interval costs more
+     memory but less time after each edit.
+
+2.   BrIncCheck() checks a whole text. The text is all in memory; the
+     module never copies it and doesn't keep a pointer to it.
+
+3.   After an edit, BrIncUpdate() is given the new text and the range of
+     lines that changed: lines first_line through old_last_line of the
+     old text became lines first_line through new_last_line of the new
+     text. An insertion of whole lines before line n is described with
+     first_line = n and old_last_line = n - 1. The range may be larger
+     than the real change, but it must not be smaller.
+
+4.   The results are in the messages member. Each message has the line,
+     column, and offset (from the start of the text) of the character at
+     fault. Warnings are included.
+
+5.   Both functions return NO if they run out of memory. The results are
+     then incomplete; BrIncCheck() should be used to start over.
+
+The work done by BrIncUpdate() is normally proportional to the size of the
+edit plus one interval, not to the size of the file. Only the bookkeeping
+of the checkpoints and messages after the edit depends on the size of the
+file, and there is just one of those for each interval. Each checkpoint
+holds its own copy of the stack, so the memory used by the checkpoints is
+proportional to how deeply the text is nested as well as to its length.
+
+     Please send comments and bug reports to
+
+     Peter Chapin
+     chapinp@proton.me
+
+*****************************************************************************/
+
+#include "local.h"
+#include <stdlib.h>
+#include <string.h>
+#include "standard.h"
+#include "brcheck.h"
+#include "brincr.h"
+
+/*=================================*/
+/*           Global Data           */
+/*=================================*/
+
+#define DEFAULT_INTERVAL 256
+
+/* Information given to collect() while a check is in progress. */
+typedef struct {
+  BrIncremental *inc;
+  size_t         base;        /* Offset of the block being checked. */
+  boolean        failed;      /* =YES if memory ran out.            */
+} RunContext;
+
+/*==========================================*/
+/*           Function Definitions           */
+/*==========================================*/
+
+/*------------------------------------------------------------------------*/
+/* void *grow(void *array, size_t *size, size_t count, size_t element);    */
+/*                                                                        */
+/*      This function makes sure there is room in an array for one more   */
+/*      element. It returns the (possibly moved) array or NULL if there   */
+/*      is no memory. The size is only changed if the array is.           */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+void *grow(void *array, size_t *size, size_t count, size_t element)
+  {
+    size_t new_size;
+
+    if (count < *size) return array;
+    new_size = (*size == 0) ? 64 : 2 * *size;
+    if ((array = realloc(array, new_size * element)) != NULL) *size = new_size;
+    return array;
+  }
+
+/*------------------------------------------------------------------------*/
+/* boolean add_point(BrIncremental *inc, BrChecker *state, size_t offset, */
+/*   boolean copy);                                                       */
+/*                                                                        */
+/*      This function adds a checkpoint. If copy is YES the checkpoint    */
+/*      gets a copy of the stack; otherwise it takes the one in state,    */
+/*      which is left empty.                                              */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+boolean add_point(BrIncremental *inc, BrChecker *state, size_t offset, boolean copy)
+  {
+    BrCheckpoint *points =
+      (BrCheckpoint *)grow(inc->points, &inc->point_size, inc->point_count, sizeof(BrCheckpoint));
+
+    if (points == NULL) return NO;
+    inc->points = points;
+    if (copy) {
+      if (!BrCopy(&inc->points[inc->point_count].state, state)) return NO;
+    }
+    else {
+      inc->points[inc->point_count].state = *state;
+      state->stack = NULL;
+      state->depth = state->stack_size = 0;
+    }
+    inc->points[inc->point_count].offset = offset;
+    inc->point_count++;
+    return YES;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void drop_points(BrCheckpoint *points, size_t first, size_t last);     */
+/*                                                                        */
+/*      This function frees the stacks of points[first] up to (but not   */
+/*      including) points[last].                                          */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+void drop_points(BrCheckpoint *points, size_t first, size_t last)
+  {
+    while (first < last) BrFree(&points[first++].state);
+    return;
+  }
+
+PRIVATE
+boolean add_message(BrIncremental *inc, const BrMessage *message)
+  {
+    BrMessage *messages =
+      (BrMessage *)grow(inc->messages, &inc->message_size, inc->message_count, sizeof(BrMessage));
+
+    if (messages == NULL) return NO;
+    inc->messages = messages;
+    inc->messages[inc->message_count++] = *message;
+    return YES;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void collect(void *context, const BrMessage *message);                 */
+/*                                                                        */
+/*      This function receives the messages from the checker. Offsets in  */
+/*      the block are changed to offsets in the text.                     */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+void collect(void *context, const BrMessage *message)
+  {
+    RunContext *run = (RunContext *)context;
+    BrMessage   copy = *message;
+
+    copy.offset += run->base;
+    if (!add_message(run->inc, &copy)) run->failed = YES;
+  }
+
+/*------------------------------------------------------------------------*/
+/* size_t line_start(const char *text, size_t pos, size_t size, long n);  */
+/*                                                                        */
+/*      This function returns the offset of the start of the n'th line    */
+/*      after the one containing pos, or size if there is no such line.   */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+size_t line_start(const char *text, size_t pos, size_t size, long n)
+  {
+    const char *p   = text + pos;
+    const char *end = text + size;
+
+    while (n-- > 0) {
+      if ((p = (const char *)memchr(p, '\n', (size_t)(end - p))) == NULL) return size;
+      p++;
+    }
+    return (size_t)(p - text);
+  }
+
+/*------------------------------------------------------------------------*/
+/* long move_line(long line, long first_line, long old_last_line,         */
+/*   long line_delta);                                                    */
+/*                                                                        */
+/*      This function converts a line number from the last check to the   */
+/*      new text. Lines that changed become line zero. move_state() does  */
+/*      the same to a saved state.                                        */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+long move_line(long line, long first_line, long old_last_line, long line_delta)
+  {
+    if (line > old_last_line) return line + line_delta;
+    if (line >= first_line) return 0;
+    return line;
+  }
+
+PRIVATE
+void move_state(BrChecker *state, long first_line, long old_last_line, long line_delta)
+  {
+    size_t i;
+
+    state->line += line_delta;
+    state->item_line = move_line(state->item_line, first_line, old_last_line, line_delta);
+    for (i = 0; i < state->depth; i++) {
+      state->stack[i].line = (uint32_t)move_line(
+        (long)state->stack[i].line, first_line, old_last_line, line_delta);
+    }
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* boolean recheck(                                                       */
+/*   BrIncremental *inc, const char *text, size_t size,                   */
+/*   BrCheckpoint *old_points, size_t old_count,                          */
+/*   const BrMessage *old_messages, size_t old_message_count,             */
+/*   long first_line, long old_last_line, long line_delta,                */
+/*   long byte_delta);                                                    */
+/*                                                                        */
+/*      This function checks the text from the last checkpoint in inc to  */
+/*      the end, or until the state matches one of the old checkpoints   */
+/*      (from the last check, in its coordinates). Then the old points    */
+/*      and messages from there on are moved into the new coordinates and */
+/*      added to inc. The old points that are added give their stacks to  */
+/*      inc; the caller must free the stacks of the others.               */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+boolean recheck(
+  BrIncremental      *inc,
+  const char         *text,
+  size_t              size,
+  BrCheckpoint       *old_points,
+  size_t              old_count,
+  const BrMessage    *old_messages,
+  size_t              old_message_count,
+  long                first_line,
+  long                old_last_line,
+  long                line_delta,
+  long                byte_delta)
+  {
+    BrChecker    checker;
+    size_t       pos = inc->points[inc->point_count - 1].offset;
+    long         first;
+    RunContext   run;
+    BrMessage    message;
+    size_t       next = 0;          /* Next old checkpoint to compare with. */
+    size_t       target;
+    size_t       moved;
+    size_t       i;
+    boolean      candidate;
+    boolean      at_end;
+    boolean      result = NO;
+
+    if (!BrCopy(&checker, &inc->points[inc->point_count - 1].state)) return NO;
+    first      = checker.line;
+    run.inc    = inc;
+    run.failed = NO;
+    checker.report  = collect;
+    checker.context = &run;
+
+    loop {
+      /* Go to the next interval or the next old checkpoint, whichever is first. */
+      target = line_start(text, pos, size, inc->interval);
+      candidate = NO;
+      while (next < old_count && old_points[next].offset + byte_delta < pos) next++;
+      if (next < old_count) {
+        moved = old_points[next].offset + byte_delta;
+        if (moved <= target) {
+          target = moved;
+          candidate = YES;
+        }
+      }
+
+      /* The text before a line start always ends in a new-line, so all of it is used. */
+      at_end   = (target == size) ? YES : NO;
+      run.base = pos;
+      BrCheckBlock(&checker, text + pos, target - pos, at_end);
+      pos = target;
+      if (run.failed) goto done;
+      if (at_end) break;
+
+      if (candidate) {
+        move_state(&old_points[next].state, first_line, old_last_line, line_delta);
+        if (BrSameState(&checker, &old_points[next].state)) break;
+      }
+      if (!add_point(inc, &checker, pos, YES)) goto done;
+      if (candidate) next++;
+    }
+
+    if (!at_end) {
+      /* Caught up. The rest of the old results still hold. */
+      for (i = 0; i < old_message_count; i++) {
+        if (old_messages[i].offset < old_points[next].offset) continue;
+        message = old_messages[i];
+        message.offset += byte_delta;
+        message.line = move_line(message.line, first_line, old_last_line, line_delta);
+        if (message.closer != 0) {
+          message.closer_line =
+            move_line(message.closer_line, first_line, old_last_line, line_delta);
+        }
+        if (!add_message(inc, &message)) goto done;
+      }
+      for (i = next; i < old_count; i++) {
+        if (i != next) move_state(&old_points[i].state, first_line, old_last_line, line_delta);
+        if (!add_point(inc, &old_points[i].state, old_points[i].offset + byte_delta, NO))
+          goto done;
+      }
+    }
+    inc->lines_checked = checker.line - first;
+    inc->size = size;
+    result = YES;
+
+  done:
+    BrFree(&checker);
+    return result;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void BrIncInit(BrIncremental *inc, long interval);                     */
+/*                                                                        */
+/*      This function prepares an object for use. An interval of zero     */
+/*      selects a default.                                                */
+/*------------------------------------------------------------------------*/
+
+PUBLIC
+void BrIncInit(BrIncremental *inc, long interval)
+  {
+    inc->interval      = (interval > 0) ? interval : DEFAULT_INTERVAL;
+    inc->points        = NULL;
+    inc->point_count   = 0;
+    inc->point_size    = 0;
+    inc->messages      = NULL;
+    inc->message_count = 0;
+    inc->message_size  = 0;
+    inc->size          = 0;
+    inc->lines_checked = 0;
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void BrIncFree(BrIncremental *inc);                                    */
+/*                                                                        */
+/*      This function releases the memory used by an object. It can be   */
+/*      used again after another call to BrIncInit().                     */
+/*------------------------------------------------------------------------*/
+
+PUBLIC
+void BrIncFree(BrIncremental *inc)
+  {
+    drop_points(inc->points, 0, inc->point_count);
+    free(inc->points);
+    free(inc->messages);
+    BrIncInit(inc, inc->interval);
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* boolean BrIncCheck(BrIncremental *inc, const char *text, size_t size); */
+/*                                                                        */
+/*      This function checks all of a text.                               */
+/*------------------------------------------------------------------------*/
+
+PUBLIC
+boolean BrIncCheck(BrIncremental *inc, const char *text, size_t size)
+  {
+    BrChecker start;
+
+    drop_points(inc->points, 0, inc->point_count);
+    inc->point_count   = 0;
+    inc->message_count = 0;
+    BrReset(&start, NULL, NULL);
+    if (!add_point(inc, &start, 0, NO)) return NO;
+    return recheck(inc, text, size, NULL, 0, NULL, 0, 0, 0, 0, 0);
+  }
+
+/*------------------------------------------------------------------------*/
+/* boolean BrIncUpdate(                                                   */
+/*   BrIncremental *inc, const char *text, size_t size, long first_line,  */
+/*   long old_last_line, long new_last_line);                             */
+/*                                                                        */
+/*      This function checks a text again after an edit (see the top of   */
+/*      this file).                                                       */
+/*------------------------------------------------------------------------*/
+
+PUBLIC
+boolean BrIncUpdate(
+  BrIncremental *inc,
+  const char    *text,
+  size_t         size,
+  long           first_line,
+  long           old_last_line,
+  long           new_last_line)
+  {
+    BrCheckpoint *old_points;
+    BrMessage    *old_messages;
+    size_t        resume;
+    size_t        after;
+    size_t        kept;
+    size_t        old_count;
+    size_t        old_message_count;
+    boolean       result;
+
+    if (inc->point_count == 0) return BrIncCheck(inc, text, size);
+
+    /* Find the last checkpoint at or before the edit and the first one after it. */
+    for (resume = inc->point_count - 1;
+         resume > 0 && inc->points[resume].state.line > first_line;
+         resume--) ;
+    for (after = resume + 1;
+         after < inc->point_count && inc->points[after].state.line <= old_last_line;
+         after++) ;
+    for (kept = 0;
+         kept < inc->message_count && inc->messages[kept].offset < inc->points[resume].offset;
+         kept++) ;
+
+    /* Set aside the old results from after the edit and drop the rest. The */
+    /* stacks of the old points that are set aside go with them.           */
+    old_count = inc->point_count - after;
+    old_message_count = inc->message_count - kept;
+    old_points = (BrCheckpoint *)malloc((old_count + 1) * sizeof(BrCheckpoint));
+    old_messages = (BrMessage *)malloc((old_message_count + 1) * sizeof(BrMessage));
+    if (old_points == NULL || old_messages == NULL) {
+      free(old_points);
+      free(old_messages);
+      return NO;
+    }
+    /* The arrays are NULL when they are empty, and memcpy() must not be */
+    /* given a null pointer even to copy nothing.                        */
+    if (old_count > 0)
+      memcpy(old_points, inc->points + after, old_count * sizeof(BrCheckpoint));
+    if (old_message_count > 0)
+      memcpy(old_messages, inc->messages + kept, old_message_count * sizeof(BrMessage));
+    drop_points(inc->points, resume + 1, after);
+    inc->point_count = resume + 1;
+    inc->message_count = kept;
+
+    result = recheck(
+      inc, text, size, old_points, old_count, old_messages, old_message_count,
+      first_line, old_last_line, new_last_line - old_last_line, (long)size - (long)inc->size);
+
+    /* The points that were added to inc no longer have stacks. */
+    drop_points(old_points, 0, old_count);
+    free(old_points);
+    free(old_messages);
+    return result;
+  }
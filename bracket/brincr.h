@@ -0,0 +1,52 @@
+/*****************************************************************************
+FILE     : brincr.h
+CONTENTS : Incremental checking of {}, (), and [] for editors.
+PROGRAMMER    : Peter Chapin
+
+This file contains the interface to a module that keeps the results of
+checking a file up to date as the file is edited. The whole text is given
+each time, along with the range of lines that changed. Only the part of
+the file that can be affected by the change is checked again.
+
+See BRINCR.C for more information.
+
+*****************************************************************************/
+
+#ifndef BRINCR_H
+#define BRINCR_H
+
+#include <stddef.h>
+#include "brcheck.h"
+
+/* The state of the checker at the start of a line. */
+typedef struct {
+  BrChecker state;            /* Its line member is the line number.      */
+  size_t    offset;           /* Offset of the start of the line.         */
+} BrCheckpoint;
+
+typedef struct {
+  long          interval;     /* Lines between checkpoints.               */
+  BrCheckpoint *points;       /* Sorted by offset. The first is line 1.   */
+  size_t        point_count;
+  size_t        point_size;
+  BrMessage    *messages;     /* Results of the last check, in order. The */
+  size_t        message_count;  /*   offsets are from the start of text.  */
+  size_t        message_size;
+  size_t        size;         /* Size of the text last checked.           */
+  long          lines_checked;  /* Lines looked at by the last check.     */
+} BrIncremental;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern void    BrIncInit(BrIncremental *, long);
+extern void    BrIncFree(BrIncremental *);
+extern boolean BrIncCheck(BrIncremental *, const char *, size_t);
+extern boolean BrIncUpdate(BrIncremental *, const char *, size_t, long, long, long);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,498 @@
+/*****************************************************************************
+FILE          : cmtbench.c
+LAST REVISION : October 2026
+SUBJECT       : Throughput benchmark for the comment scanner.
+PROGRAMMER    : Peter Chapin
+
+This program measures how fast the comment scanner in cmtscan.c classifies
+source text, and checks that it classifies it correctly. It is built and
+run by "make bench" (see the Makefile).
+
+The input is a corpus of three kinds of text: comment heavy, string heavy,
+and plain code. The corpus is generated from fixed fragments with a fixed
+random number sequence so every run (on every machine) sees exactly the
+same bytes. Files named on the command line are joined together and
+repeated to make a fourth input; the Makefile uses the sources in this
+directory.
+
+Each input is classified by every backend below. The speed is reported in
+MB/s (millions of bytes per second) and, on x86 systems, in cycles per
+byte as counted by the time stamp counter. The best of several runs is
+reported. Each backend must give every byte the same kind as the reference
+state machine, a direct transcription of the switch statement the scanner
+used before it was made table driven. If any backend disagrees the first
+difference is shown and the program exits with status 1.
+
+The vector instructions used by cmtscan.c are chosen when it is compiled,
+so the Makefile builds this program several times with different options.
+
+Usage: cmtbench [-s megabytes] [file ...]
+
+     Please send comments and bug reports to
+
+     Peter Chapin
+     chapinp@proton.me
+
+*****************************************************************************/
+
+#include "local.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "standard.h"
+#include "scanners.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define HAVE_TSC
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define HAVE_TSC
+#endif
+
+/*=================================*/
+/*           Global Data           */
+/*=================================*/
+
+#define BLOCK_SIZE   65536    /* Block size used by the block backends.   */
+#define MIN_SECONDS  0.25     /* Minimum time spent timing each backend.  */
+#define MIN_RUNS     3        /* Minimum number of timed runs.            */
+
+typedef struct {
+  const char *name;
+  void      (*run)(const char *, size_t, unsigned char *);
+  boolean     merged;         /* =YES if both comment styles look alike.  */
+} Backend;
+
+typedef struct {
+  const char  *name;
+  const char **fragments;     /* Pieces of source text to choose from.    */
+  int          count;         /* Number of fragments.                     */
+} CorpusDef;
+
+PRIVATE const char *comment_fragments[] = {
+  "/* This is a comment with a few words in it. */\n",
+  "// A C++ comment that runs to the end of the line.\n",
+  "/*\n * A block comment that has ** stars\n * and / slashes inside it.\n */\n",
+  "x = y / z;  /* A comment after a division. */\n",
+  "int f(void);  // Declaration with a comment.\n",
+  "/**********************************************/\n",
+  "  count++;  /* Comments /* don't nest. */\n"
+  };
+
+PRIVATE const char *string_fragments[] = {
+  "printf(\"Value = %d\\n\", x);\n",
+  "s = \"A string with \\\"escaped\\\" quotes in it.\";\n",
+  "c = '\\'';\n",
+  "c = 'x';  d = '\"';\n",
+  "puts(\"// Not a comment. /* Not one either. */\");\n",
+  "path = \"C:\\\\dir\\\\file.txt\";\n",
+  "message = \"A long string literal that goes on for quite some way.\";\n"
+  };
+
+PRIVATE const char *plain_fragments[] = {
+  "  for (i = 0; i < count; i++) {\n",
+  "    total += values[i] * weight;\n",
+  "  }\n",
+  "  if (total > limit) return limit;\n",
+  "  x = (a + b) / (c - d);\n",
+  "int function_name(int argument, char *pointer)\n  {\n",
+  "    return pointer[argument];\n  }\n\n"
+  };
+
+#define COUNT(a) (int)(sizeof(a)/sizeof(a[0]))
+
+PRIVATE const CorpusDef corpora[] = {
+  { "comment-heavy", comment_fragments, COUNT(comment_fragments) },
+  { "string-heavy",  string_fragments,  COUNT(string_fragments)  },
+  { "plain",         plain_fragments,   COUNT(plain_fragments)   }
+  };
+
+PRIVATE unsigned long seed;          /* State of the random numbers.        */
+PRIVATE const char   *input;         /* Used by the CmtScanGetChar backend. */
+PRIVATE const char   *input_end;
+
+/*==========================================*/
+/*           Function Definitions           */
+/*==========================================*/
+
+/*------------------------------------------------------------------------*/
+/* void reference(const char *text, size_t size, unsigned char *kinds);   */
+/*                                                                        */
+/*      This function is the reference state machine. It follows the      */
+/*      original switch statement in CmtScanGetChar() one character at a  */
+/*      time. A '/' gets the kind of the character after it. The          */
+/*      character after a '/' that doesn't start a comment is always code */
+/*      (the original scanner never looked at it again).                  */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+void reference(const char *text, size_t size, unsigned char *kinds)
+  {
+    enum {
+      Code, Start_Cmt, C_Cmt, Cpp_Cmt, End_Cmt, D_Quote, S_Quote, D_Esc, S_Esc
+    } state = Code;
+    size_t i;
+    int    c;
+
+    for (i = 0; i < size; i++) {
+      c = (unsigned char)text[i];
+      switch (state) {
+        case Code:
+          kinds[i] = CMT_CODE;
+          if (c == '/') state = Start_Cmt;
+          else if (c == '\"') {
+            kinds[i] = CMT_STRING;
+            state = D_Quote;
+          }
+          else if (c == '\'') {
+            kinds[i] = CMT_CHAR;
+            state = S_Quote;
+          }
+          break;
+
+        case Start_Cmt:
+          if (c == '/') {
+            kinds[i - 1] = kinds[i] = CMT_CPP_COMMENT;
+            state = Cpp_Cmt;
+          }
+          else if (c == '*') {
+            kinds[i - 1] = kinds[i] = CMT_C_COMMENT;
+            state = C_Cmt;
+          }
+          else {
+            kinds[i] = CMT_CODE;
+            state = Code;
+          }
+          break;
+
+        case C_Cmt:
+          kinds[i] = CMT_C_COMMENT;
+          if (c == '*') state = End_Cmt;
+          break;
+
+        case Cpp_Cmt:
+          kinds[i] = CMT_CPP_COMMENT;
+          if (c == '\n') state = Code;
+          break;
+
+        case End_Cmt:
+          kinds[i] = CMT_C_COMMENT;
+          if (c == '/') state = Code;
+          else if (c != '*') state = C_Cmt;
+          break;
+
+        case D_Quote:
+          kinds[i] = CMT_STRING;
+          if (c == '\\') state = D_Esc;
+          else if (c == '\"') state = Code;
+          break;
+
+        case S_Quote:
+          kinds[i] = CMT_CHAR;
+          if (c == '\\') state = S_Esc;
+          else if (c == '\'') state = Code;
+          break;
+
+        case D_Esc:
+          kinds[i] = CMT_STRING;
+          state = D_Quote;
+          break;
+
+        case S_Esc:
+          kinds[i] = CMT_CHAR;
+          state = S_Quote;
+          break;
+      }
+    }
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* The backends. Each classifies all of text[] into kinds[] using one of   */
+/* the interfaces to the scanner.                                         */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+int get_input(void)
+  {
+    return (input == input_end) ? EOF : (unsigned char)*input++;
+  }
+
+PRIVATE
+void by_char(const char *text, size_t size, unsigned char *kinds)
+  {
+    size_t i = 0;
+
+    input = text;
+    input_end = text + size;
+    CmtScanInit(get_input);
+    while (CmtScanGetChar() != EOF) {
+      if (Comment)          kinds[i] = CMT_C_COMMENT;
+      else if (DoubleQuote) kinds[i] = CMT_STRING;
+      else if (SingleQuote) kinds[i] = CMT_CHAR;
+      else                  kinds[i] = CMT_CODE;
+      i++;
+    }
+    return;
+  }
+
+PRIVATE
+void by_block(const char *text, size_t size, unsigned char *kinds)
+  {
+    CmtScanner scanner;
+    size_t     done = 0;
+    size_t     count;
+
+    /* The text is all in memory, so a '/' left over at the end of one
+         block is given again simply by starting the next block on it. */
+    CmtScanReset(&scanner);
+    do {
+      count = (size - done < BLOCK_SIZE) ? size - done : BLOCK_SIZE;
+      done += CmtScanBlock(&scanner, text + done, count, kinds + done,
+                (done + count == size) ? YES : NO);
+    } while (done < size);
+    return;
+  }
+
+PRIVATE
+void by_span(const char *text, size_t size, unsigned char *kinds)
+  {
+    CmtScanner scanner;
+    CmtSpan    span;
+    size_t     offset = 0;
+
+    CmtScanReset(&scanner);
+    while (CmtScanSpan(&scanner, text, size, &offset, &span, YES)) {
+      memset(kinds + span.offset, span.kind, span.length);
+    }
+    return;
+  }
+
+PRIVATE const Backend backends[] = {
+  { "reference",      reference, NO  },
+  { "CmtScanGetChar", by_char,   YES },
+  { "CmtScanBlock",   by_block,  NO  },
+  { "CmtScanSpan",    by_span,   NO  }
+  };
+
+/*------------------------------------------------------------------------*/
+/* Building the inputs.                                                   */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+int next_random(void)
+  {
+    seed = (seed * 1103515245UL + 12345UL) & 0xFFFFFFFFUL;
+    return (int)((seed >> 16) & 0x7FFF);
+  }
+
+PRIVATE
+char *make_corpus(const CorpusDef *corpus, size_t size)
+  {
+    char       *text = (char *)malloc(size);
+    const char *fragment;
+    size_t      length;
+    size_t      i = 0;
+
+    if (text == NULL) return NULL;
+    seed = 1;
+    while (i < size) {
+      fragment = corpus->fragments[next_random() % corpus->count];
+      length = strlen(fragment);
+      if (length > size - i) length = size - i;
+      memcpy(text + i, fragment, length);
+      i += length;
+    }
+    return text;
+  }
+
+/*------------------------------------------------------------------------*/
+/* char *load_files(char **names, int count, size_t size);                 */
+/*                                                                        */
+/*      This function joins the named files together and repeats them     */
+/*      until size bytes are filled. It returns NULL if there is an error. */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+char *load_files(char **names, int count, size_t size)
+  {
+    char   *text = (char *)malloc(size);
+    FILE   *file;
+    size_t  used = 0;
+    int     i;
+
+    if (text == NULL) return NULL;
+    for (i = 0; i < count && used < size; i++) {
+      if ((file = fopen(names[i], "rb")) == NULL) {
+        fprintf(stderr, "cmtbench: Can't open %s\n", names[i]);
+        free(text);
+        return NULL;
+      }
+      used += fread(text + used, 1, size - used, file);
+      fclose(file);
+    }
+    if (used == 0) {
+      free(text);
+      return NULL;
+    }
+    for (i = 0; used < size; used++, i++) text[used] = text[i];
+    return text;
+  }
+
+/*------------------------------------------------------------------------*/
+/* boolean check(                                                         */
+/*   const Backend *backend, const char *input_name, const unsigned char  */
+/*   *expected, const unsigned char *kinds, size_t size);                 */
+/*                                                                        */
+/*      This function compares a backend's kinds with the reference and   */
+/*      describes the first difference. It returns NO if there is one.    */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+boolean check(
+  const Backend       *backend,
+  const char          *input_name,
+  const unsigned char *expected,
+  const unsigned char *kinds,
+  size_t               size)
+  {
+    size_t i;
+    int    want;
+
+    for (i = 0; i < size; i++) {
+      want = expected[i];
+      if (backend->merged && want == CMT_CPP_COMMENT) want = CMT_C_COMMENT;
+      if (kinds[i] != want) {
+        printf("MISMATCH: %s on %s at offset %lu: kind %d, expected %d\n",
+          backend->name, input_name, (unsigned long)i, kinds[i], want);
+        return NO;
+      }
+    }
+    return YES;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void measure(                                                          */
+/*   const Backend *backend, const char *text, size_t size,               */
+/*   unsigned char *kinds);                                               */
+/*                                                                        */
+/*      This function times a backend on one input and prints the result. */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+void measure(
+  const Backend *backend, const char *text, size_t size, unsigned char *kinds)
+  {
+    double  best = 0.0;
+    double  total = 0.0;
+    double  seconds;
+    clock_t start;
+    int     runs = 0;
+#ifdef HAVE_TSC
+    unsigned long long cycles;
+    unsigned long long best_cycles = 0;
+#endif
+
+    do {
+#ifdef HAVE_TSC
+      cycles = __rdtsc();
+#endif
+      start = clock();
+      backend->run(text, size, kinds);
+      seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+#ifdef HAVE_TSC
+      cycles = __rdtsc() - cycles;
+      if (runs == 0 || cycles < best_cycles) best_cycles = cycles;
+#endif
+      if (runs == 0 || seconds < best) best = seconds;
+      total += seconds;
+      runs++;
+    } while (runs < MIN_RUNS || total < MIN_SECONDS);
+
+    if (best <= 0.0) best = 1.0 / CLOCKS_PER_SEC;
+    printf("  %-16s %9.1f MB/s", backend->name, (double)size / best / 1.0E6);
+#ifdef HAVE_TSC
+    printf(" %9.2f cycles/byte", (double)best_cycles / (double)size);
+#endif
+    printf("\n");
+    return;
+  }
+
+/*==================================*/
+/*           Main Program           */
+/*==================================*/
+
+int main(int argc, char **argv)
+  {
+    size_t         size = 8;       /* Size of each input (megabytes at first). */
+    char          *text;
+    unsigned char *expected;
+    unsigned char *kinds;
+    const char    *input_name;
+    int            input_count;
+    int            i, j;
+    int            status = 0;
+
+    if (argc > 2 && strcmp(argv[1], "-s") == 0) {
+      size = (size_t)atol(argv[2]);
+      argc -= 2;
+      argv += 2;
+    }
+    if (size == 0) {
+      fprintf(stderr, "Usage: cmtbench [-s megabytes] [file ...]\n");
+      return 2;
+    }
+    size *= 1024UL * 1024UL;
+
+    expected = (unsigned char *)malloc(size);
+    kinds    = (unsigned char *)malloc(size);
+    if (expected == NULL || kinds == NULL) {
+      fprintf(stderr, "cmtbench: Out of memory\n");
+      return 2;
+    }
+
+#if defined(CMT_NO_SIMD)
+    printf("CMTBENCH: cmtscan.c built without vector instructions\n");
+#elif defined(__AVX2__)
+    printf("CMTBENCH: cmtscan.c built with AVX2\n");
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    printf("CMTBENCH: cmtscan.c built with SSE2\n");
+#else
+    printf("CMTBENCH: cmtscan.c built without vector instructions\n");
+#endif
+
+    input_count = COUNT(corpora) + ((argc > 1) ? 1 : 0);
+    for (i = 0; i < input_count; i++) {
+      if (i < COUNT(corpora)) {
+        input_name = corpora[i].name;
+        text = make_corpus(&corpora[i], size);
+      }
+      else {
+        input_name = "files";
+        text = load_files(argv + 1, argc - 1, size);
+      }
+      if (text == NULL) {
+        fprintf(stderr, "cmtbench: Can't build the %s input\n", input_name);
+        return 2;
+      }
+
+      printf("%s (%lu bytes)\n", input_name, (unsigned long)size);
+      reference(text, size, expected);
+      for (j = 0; j < COUNT(backends); j++) {
+        memset(kinds, 0xFF, size);
+        backends[j].run(text, size, kinds);
+        if (!check(&backends[j], input_name, expected, kinds, size)) {
+          status = 1;
+          continue;
+        }
+        measure(&backends[j], text, size, kinds);
+      }
+      free(text);
+    }
+
+    free(expected);
+    free(kinds);
+    return status;
+  }
@@ -0,0 +1,326 @@
+/*****************************************************************************
+FILE          : cmtgen.c
+LAST REVISION : October 2026
+SUBJECT       : Generates the transition tables used by cmtscan.c.
+PROGRAMMER    : Peter Chapin
+
+The comment scanner in cmtscan.c is a table driven finite state machine.
+This program builds the tables from the lists of character classes, states,
+and rules below and writes them as C declarations to its standard output.
+The output is kept in cmttab.h. To change what the scanner recognizes, edit
+the lists here and then run
+
+     cmtgen > cmttab.h
+
+The scanner's loop is written out once for each state, and the compiler
+turns the table entries it uses into constants. The time spent on each
+character does not depend on the number of states or character classes, so
+adding syntax (raw strings, digraphs, line splices, and so forth) doesn't
+slow it down.
+
+How the tables work:
+
+1.   Every character belongs to exactly one class. Characters that are not
+     mentioned in the class list are in class Other. There is also a
+     pseudo class, End, that stands for the end of the input.
+
+2.   Each state has a kind (the CMT_xxx value of characters that leave the
+     state unchanged) and a default next state used for any class that no
+     rule mentions.
+
+3.   A rule gives the next state and the kind of the character for one
+     (state, class) pair.
+
+4.   A look ahead state is never stored. When the scanner enters one, it
+     immediately applies the transition for the following character (or
+     End) and gives both characters the kind of that second transition.
+     This is how a '/' is held until it is known whether a comment starts.
+
+5.   For each state the program also lists the characters whose
+     transition differs from the one for class Other. In most states
+     class Other leaves the state unchanged, so the scanner passes over
+     all other characters without looking at the tables. If there are more
+     than three such characters the count is -1 and every character is
+     looked up.
+
+     Please send comments and bug reports to
+
+     Peter Chapin
+     chapinp@proton.me
+
+*****************************************************************************/
+
+#include "local.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "standard.h"
+#include "scanners.h"
+
+/*=================================*/
+/*           Global Data           */
+/*=================================*/
+
+#define MAX_STOPS 3   /* Size of the stop lists searched by cmtscan.c. */
+
+typedef struct {
+  const char *name;
+  const char *members;      /* Characters in the class. */
+  int         length;       /* Number of members (members might hold \0). */
+} ClassDef;
+
+typedef struct {
+  const char *name;
+  int         kind;         /* Kind of characters that stay in this state. */
+  const char *otherwise;    /* Next state for classes without a rule. */
+  boolean     look_ahead;
+} StateDef;
+
+typedef struct {
+  const char *state;
+  const char *class_name;
+  const char *next;
+  int         kind;
+} RuleDef;
+
+PRIVATE const ClassDef classes[] = {
+  { "Other",     "",     0 },
+  { "Slash",     "/",    1 },
+  { "Star",      "*",    1 },
+  { "DQuote",    "\"",   1 },
+  { "SQuote",    "'",    1 },
+  { "Backslash", "\\",   1 },
+  { "Newline",   "\n",   1 }
+  };
+
+/* The first state is the initial state. */
+PRIVATE const StateDef states[] = {
+  { "Code",    CMT_CODE,        "Code",    NO  },
+  { "Slash",   CMT_CODE,        "Code",    YES },
+  { "C_Cmt",   CMT_C_COMMENT,   "C_Cmt",   NO  },
+  { "End_Cmt", CMT_C_COMMENT,   "C_Cmt",   NO  },
+  { "Cpp_Cmt", CMT_CPP_COMMENT, "Cpp_Cmt", NO  },
+  { "D_Quote", CMT_STRING,      "D_Quote", NO  },
+  { "D_Esc",   CMT_STRING,      "D_Quote", NO  },
+  { "S_Quote", CMT_CHAR,        "S_Quote", NO  },
+  { "S_Esc",   CMT_CHAR,        "S_Quote", NO  }
+  };
+
+/* Note that a '/' followed by anything other than '*' or '/' goes back to
+     Code without looking at the second character. The character after the
+     '/' is always ordinary code; the scanner has always worked this way. */
+PRIVATE const RuleDef rules[] = {
+  { "Code",    "Slash",     "Slash",   CMT_CODE        },
+  { "Code",    "DQuote",    "D_Quote", CMT_STRING      },
+  { "Code",    "SQuote",    "S_Quote", CMT_CHAR        },
+  { "Slash",   "Star",      "C_Cmt",   CMT_C_COMMENT   },
+  { "Slash",   "Slash",     "Cpp_Cmt", CMT_CPP_COMMENT },
+  { "C_Cmt",   "Star",      "End_Cmt", CMT_C_COMMENT   },
+  { "End_Cmt", "Star",      "End_Cmt", CMT_C_COMMENT   },
+  { "End_Cmt", "Slash",     "Code",    CMT_C_COMMENT   },
+  { "Cpp_Cmt", "Newline",   "Code",    CMT_CPP_COMMENT },
+  { "D_Quote", "Backslash", "D_Esc",   CMT_STRING      },
+  { "D_Quote", "DQuote",    "Code",    CMT_STRING      },
+  { "S_Quote", "Backslash", "S_Esc",   CMT_CHAR        },
+  { "S_Quote", "SQuote",    "Code",    CMT_CHAR        }
+  };
+
+#define CLASS_COUNT (int)(sizeof(classes)/sizeof(ClassDef))
+#define STATE_COUNT (int)(sizeof(states)/sizeof(StateDef))
+#define RULE_COUNT  (int)(sizeof(rules)/sizeof(RuleDef))
+#define END_CLASS   CLASS_COUNT
+
+PRIVATE const char *kind_names[] = {
+  "CMT_CODE", "CMT_C_COMMENT", "CMT_CPP_COMMENT", "CMT_STRING", "CMT_CHAR"
+  };
+
+PRIVATE int byte_class[256];
+PRIVATE int next_state[STATE_COUNT][CLASS_COUNT + 1];
+PRIVATE int next_kind[STATE_COUNT][CLASS_COUNT + 1];
+
+/*==========================================*/
+/*           Function Definitions           */
+/*==========================================*/
+
+PRIVATE
+void fail(const char *message, const char *name)
+  {
+    fprintf(stderr, "cmtgen: %s: %s\n", message, name);
+    exit(1);
+  }
+
+PRIVATE
+int find_state(const char *name)
+  {
+    int i;
+
+    for (i = 0; i < STATE_COUNT; i++)
+      if (strcmp(states[i].name, name) == 0) return i;
+    fail("Unknown state", name);
+    return 0;
+  }
+
+PRIVATE
+int find_class(const char *name)
+  {
+    int i;
+
+    if (strcmp(name, "End") == 0) return END_CLASS;
+    for (i = 0; i < CLASS_COUNT; i++)
+      if (strcmp(classes[i].name, name) == 0) return i;
+    fail("Unknown class", name);
+    return 0;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void build(void);                                                      */
+/*                                                                        */
+/*      This function fills in the class and transition tables.           */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+void build(void)
+  {
+    int i, j;
+
+    for (i = 0; i < 256; i++) byte_class[i] = 0;
+    for (i = 1; i < CLASS_COUNT; i++) {
+      for (j = 0; j < classes[i].length; j++) {
+        byte_class[(unsigned char)classes[i].members[j]] = i;
+      }
+    }
+
+    for (i = 0; i < STATE_COUNT; i++) {
+      for (j = 0; j <= CLASS_COUNT; j++) {
+        next_state[i][j] = find_state(states[i].otherwise);
+        next_kind[i][j]  = states[i].kind;
+      }
+    }
+
+    for (i = 0; i < RULE_COUNT; i++) {
+      int state = find_state(rules[i].state);
+      int class = find_class(rules[i].class_name);
+
+      next_state[state][class] = find_state(rules[i].next);
+      next_kind[state][class]  = rules[i].kind;
+    }
+
+    if (states[0].look_ahead) fail("Initial state can't look ahead", states[0].name);
+    if (STATE_COUNT > 256) fail("Too many states", "");
+    for (i = 0; i < STATE_COUNT; i++) {
+      if (!states[i].look_ahead) continue;
+      for (j = 0; j <= CLASS_COUNT; j++) {
+        if (states[next_state[i][j]].look_ahead)
+          fail("Look ahead state leads to another look ahead state", states[i].name);
+      }
+    }
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void write_tables(void);                                               */
+/*                                                                        */
+/*      This function prints the tables as C declarations.                */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+void write_tables(void)
+  {
+    int i, j, count;
+    int stops[256];
+
+    printf("/* cmttab.h: Tables for the comment scanner in cmtscan.c.\n");
+    printf("     Generated by cmtgen.c. Do not edit; change cmtgen.c instead. */\n\n");
+
+    printf("#define CMT_STATE_COUNT %d\n", STATE_COUNT);
+    printf("#define CMT_CLASS_COUNT %d\n", CLASS_COUNT + 1);
+    printf("#define CMT_END_CLASS   %d\n", END_CLASS);
+    printf("#define CMT_MAX_STOPS   %d\n\n", MAX_STOPS);
+
+    printf("/* Lists of the state and class numbers. cmtscan.c uses them to write\n");
+    printf("     out its scanning loop once for each state. */\n");
+    printf("#define CMT_EACH_STATE(X)");
+    for (i = 0; i < STATE_COUNT; i++) printf(" X(%d)", i);
+    printf("\n#define CMT_EACH_CLASS(X)");
+    for (i = 0; i < CLASS_COUNT + 1; i++) printf(" X(%d)", i);
+    printf("\n\n");
+
+    printf("enum state_values {\n ");
+    for (i = 0; i < STATE_COUNT; i++)
+      printf(" %s%s", states[i].name, (i + 1 < STATE_COUNT) ? "," : "\n");
+    printf("  };\n\n");
+
+    printf("/* The class of each character. */\n");
+    printf("PRIVATE const unsigned char byte_class[256] = {\n");
+    for (i = 0; i < 256; i++) {
+      printf("%s%d%s", (i % 16 == 0) ? "  " : "", byte_class[i],
+        (i == 255) ? "\n" : (i % 16 == 15) ? ",\n" : ", ");
+    }
+    printf("  };\n\n");
+
+    printf("/* Next state (low byte) and kind (high byte) for each state and class. */\n");
+    printf("PRIVATE const unsigned short transition[CMT_STATE_COUNT][CMT_CLASS_COUNT] = {\n");
+    for (i = 0; i < STATE_COUNT; i++) {
+      printf("  {");
+      for (j = 0; j <= CLASS_COUNT; j++) {
+        printf(" 0x%04X%s", (next_kind[i][j] << 8) | next_state[i][j],
+          (j < CLASS_COUNT) ? "," : " ");
+      }
+      printf("}%s  /* %s */\n", (i + 1 < STATE_COUNT) ? "," : " ", states[i].name);
+    }
+    printf("  };\n\n");
+
+    printf("/* The kind of the characters that leave each state unchanged. */\n");
+    printf("PRIVATE const unsigned char state_kind[CMT_STATE_COUNT] = {\n");
+    for (i = 0; i < STATE_COUNT; i++) {
+      char entry[32];
+
+      sprintf(entry, "%s%s", kind_names[states[i].kind], (i + 1 < STATE_COUNT) ? "," : "");
+      printf("  %-17s /* %s */\n", entry, states[i].name);
+    }
+    printf("  };\n\n");
+
+    printf("/* =1 for states that are resolved by looking at the next character. */\n");
+    printf("PRIVATE const unsigned char state_look_ahead[CMT_STATE_COUNT] = {\n ");
+    for (i = 0; i < STATE_COUNT; i++)
+      printf(" %d%s", states[i].look_ahead ? 1 : 0, (i + 1 < STATE_COUNT) ? "," : "\n");
+    printf("  };\n\n");
+
+    /* A character is a stop if its transition differs from that of class
+         Other. */
+    printf("/* The characters whose transition differs from that of class Other\n");
+    printf("     (count -1: too many to list). Unused entries repeat the first. */\n");
+    printf("PRIVATE const struct {\n");
+    printf("  int           count;\n");
+    printf("  unsigned char stop[CMT_MAX_STOPS];\n");
+    printf("} state_stops[CMT_STATE_COUNT] = {\n");
+    for (i = 0; i < STATE_COUNT; i++) {
+      count = 0;
+      for (j = 0; j < 256; j++) {
+        int class = byte_class[j];
+        if (next_state[i][class] != next_state[i][0] || next_kind[i][class] != next_kind[i][0]) {
+          stops[count++] = j;
+        }
+      }
+      if (count > MAX_STOPS) count = -1;
+      printf("  { %2d, {", count);
+      for (j = 0; j < MAX_STOPS; j++) {
+        printf(" 0x%02X%s", (count <= 0) ? 0 : stops[(j < count) ? j : 0],
+          (j + 1 < MAX_STOPS) ? "," : " ");
+      }
+      printf("} }%s  /* %s */\n", (i + 1 < STATE_COUNT) ? "," : " ", states[i].name);
+    }
+    printf("  };\n");
+    return;
+  }
+
+/*==================================*/
+/*           Main Program           */
+/*==================================*/
+
+int main(void)
+  {
+    build();
+    write_tables();
+    return 0;
+  }
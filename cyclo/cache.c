@@ -0,0 +1,594 @@
+/*****************************************************************************
+FILE          : cache.c
+LAST REVISION : October 2026
+SUBJECT       : A file of results kept from one run to the next.
+PROGRAMMER    : Peter Chapin
+
+This module keeps the functions found in files in a cache file so that a
+later run doesn't have to scan the files that haven't changed. A file is
+known by a 64 bit FNV-1a hash of its text and by its length, not by its
+name, so a file that is moved or copied is still found, and a file that
+is changed is never mistaken for its old self (unless the hashes collide,
+which is very unlikely at the sizes of real projects).
+
+The cache file is a list of records that only grows at the end:
+
+     magic        "CYCLOC" 0x02 '\n' (the 0x02 is the version)
+     record ...
+
+     record       mark (the 4 bytes 0xFE 'C' 'Y' 0xFE)
+                  hash (8 bytes, least significant first)
+                  name (4 bytes: the low bits of the hash of the file's
+                        name, least significant first)
+                  length, count
+                  function ... (count of them)
+                  check (4 bytes: the low bits of the hash of the record
+                         from the mark on)
+
+     function     name length, name (not '\0' terminated),
+                  first_line, last_line - first_line, cyclomatic,
+                  cases, depth
+
+The numbers are written in 7 bit groups, least significant first, with the
+high bit set on all but the last group, so most take one or two bytes. A
+typical function takes about as many bytes as its name plus 6, and a
+record adds 22 to 26 bytes to that.
+
+The records of a run are added at the end with one write(), and the file
+is only ever opened for adding (or replaced whole, see below), so the
+records already there don't change. A program that reads the file while
+another adds to it may see a record that is cut short. The check catches
+that (and any other damage), and the reader skips to the next mark after a
+bad record, so a record cut short by a program that died doesn't hide the
+ones added after it. Any of that only costs the reader some scanning. If a
+file appears more than once the last record wins. The cache can be deleted
+at any time to start again. When the scanner changes in a way that changes
+the results, the version in the magic must be changed too; an old cache is
+then refused rather than used.
+
+A record that is found again is not added again, so the file doesn't grow
+with runs over files that haven't changed, but the old record of a file
+that has changed stays, and a cache that is used for a long time fills
+with them. A record is stale if a later one has the same name and it
+wasn't found by this run. The name is the one the file was given by, so a
+file named differently by two runs has two records that don't make each
+other stale. When the bytes of stale and damaged records outnumber those
+of the rest, CacheClose() writes the rest and the new records to a file
+with ".new" added to the cache's name and renames that over the cache.
+Records another run adds in between are lost, which only means their files
+are scanned again. If the ".new" file can't be made (another run is doing
+the same, or one died doing it and left the file behind) the new records
+are added to the end as usual; a ".new" file that is left behind may be
+deleted.
+
+The module works like this.
+
+1.   CacheOpen() loads the cache file (creating it if necessary) and
+     builds a hash table of the records in it.
+
+2.   CacheFind() looks for a file and, if it's there, fills in the file's
+     result. It only reads the table, so any number of threads may call
+     it at once. CacheAdd() encodes the results of a file that was
+     scanned; it must be called by one thread at a time.
+
+3.   CacheClose() adds the new records to the end of the file, or writes
+     the file again if it's mostly stale, and releases the memory.
+
+     Please send comments and bug reports to
+
+     Peter Chapin
+     chapinp@proton.me
+
+*****************************************************************************/
+
+#include "local.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "standard.h"
+#include "scanners.h"
+#include "fnscan.h"
+#include "results.h"
+#include "cache.h"
+
+/*=================================*/
+/*           Global Data           */
+/*=================================*/
+
+#define MAGIC_SIZE 8
+PRIVATE const char magic[MAGIC_SIZE] = { 'C', 'Y', 'C', 'L', 'O', 'C', 0x02, '\n' };
+
+#define MARK_SIZE 4
+PRIVATE const unsigned char mark[MARK_SIZE] = { 0xFE, 'C', 'Y', 0xFE };
+
+#define FNV_BASIS 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x00000100000001b3ULL
+
+/* A record in the table. */
+typedef struct {
+  uint64_t             hash;
+  size_t               length;
+  size_t               count;
+  const unsigned char *functions;   /* Where they start in the file's text. */
+  const unsigned char *record;      /* The whole record, from the mark.     */
+  size_t               size;
+  uint32_t             name;
+  boolean              found;       /* =YES if found by this run.           */
+} Entry;
+
+/* The last record of each name, in a table of the same size. */
+typedef struct {
+  uint32_t             name;
+  const unsigned char *record;      /* NULL in an unused slot.              */
+} Latest;
+
+PRIVATE char          *cache_name = NULL;
+PRIVATE unsigned char *loaded = NULL;     /* The text of the cache file.    */
+PRIVATE size_t         loaded_length = 0;
+PRIVATE Entry         *table = NULL;      /* Open addressing; functions is  */
+PRIVATE size_t         table_size = 0;    /*   NULL in an unused slot.      */
+PRIVATE Latest        *latest = NULL;
+
+PRIVATE unsigned char *added = NULL;      /* New records, encoded.          */
+PRIVATE size_t         added_length = 0;
+PRIVATE size_t         added_size = 0;
+PRIVATE boolean        out_of_memory = NO;
+
+/*==========================================*/
+/*           Function Definitions           */
+/*==========================================*/
+
+/*------------------------------------------------------------------------*/
+/* uint64_t CacheHash(const char *text, size_t length);                   */
+/*                                                                        */
+/*      This function returns the hash of a file's text.                  */
+/*------------------------------------------------------------------------*/
+
+PUBLIC
+uint64_t CacheHash(const char *text, size_t length)
+  {
+    const unsigned char *p   = (const unsigned char *)text;
+    const unsigned char *end = p + length;
+    uint64_t             hash = FNV_BASIS;
+
+    while (p < end) {
+      hash ^= *p++;
+      hash *= FNV_PRIME;
+    }
+    return hash;
+  }
+
+/*------------------------------------------------------------------------*/
+/* boolean get_number(const unsigned char **p, const unsigned char *end,  */
+/*   size_t *value);                                                      */
+/*                                                                        */
+/*      This function decodes a number and moves past it. It returns NO   */
+/*      if the number goes past the end.                                  */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+boolean get_number(const unsigned char **p, const unsigned char *end, size_t *value)
+  {
+    int shift = 0;
+
+    *value = 0;
+    while (*p < end && shift < (int)(8 * sizeof(size_t))) {
+      *value |= (size_t)(**p & 0x7F) << shift;
+      if ((*(*p)++ & 0x80) == 0) return YES;
+      shift += 7;
+    }
+    return NO;
+  }
+
+/*------------------------------------------------------------------------*/
+/* const unsigned char *check_record(const unsigned char *p,              */
+/*   const unsigned char *end, Entry *entry);                             */
+/*                                                                        */
+/*      This function checks the record at p and describes it. It         */
+/*      returns the end of the record or NULL if the record is damaged    */
+/*      or cut short.                                                     */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+const unsigned char *check_record(const unsigned char *p, const unsigned char *end, Entry *entry)
+  {
+    const unsigned char *start = p;
+    size_t               value;
+    size_t               i;
+    int                  j;
+    uint32_t             check;
+
+    if (end - p < MARK_SIZE + 8 || memcmp(p, mark, MARK_SIZE) != 0) return NULL;
+    p += MARK_SIZE;
+    entry->hash = 0;
+    for (j = 7; j >= 0; j--) entry->hash = (entry->hash << 8) | p[j];
+    p += 8;
+    if (end - p < 4) return NULL;
+    entry->name = 0;
+    for (j = 3; j >= 0; j--) entry->name = (entry->name << 8) | p[j];
+    p += 4;
+    if (!get_number(&p, end, &entry->length)) return NULL;
+    if (!get_number(&p, end, &entry->count)) return NULL;
+    entry->functions = p;
+    for (i = 0; i < entry->count; i++) {
+      if (!get_number(&p, end, &value) || value > (size_t)(end - p)) return NULL;
+      p += value;
+      for (j = 0; j < 5; j++) {
+        if (!get_number(&p, end, &value)) return NULL;
+      }
+    }
+    if (end - p < 4) return NULL;
+    check = (uint32_t)CacheHash((const char *)start, p - start);
+    for (j = 0; j < 4; j++) {
+      if (p[j] != (unsigned char)(check >> (8 * j))) return NULL;
+    }
+    entry->record = start;
+    entry->size   = (p + 4) - start;
+    entry->found  = NO;
+    return p + 4;
+  }
+
+/*------------------------------------------------------------------------*/
+/* const unsigned char *next_record(const unsigned char *p,               */
+/*   const unsigned char *end, Entry *entry);                             */
+/*                                                                        */
+/*      This function finds the first good record at or after p. It       */
+/*      returns the end of that record or NULL if there are no more.      */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+const unsigned char *next_record(const unsigned char *p, const unsigned char *end, Entry *entry)
+  {
+    const unsigned char *next;
+
+    while (p < end) {
+      if ((next = check_record(p, end, entry)) != NULL) return next;
+      p = (const unsigned char *)memchr(p + 1, mark[0], end - (p + 1));
+      if (p == NULL) break;
+    }
+    return NULL;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void insert(const Entry *entry);                                       */
+/*                                                                        */
+/*      This function puts a record in the table. An older record of the  */
+/*      same file is replaced. The record is also the latest of its name. */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+void insert(const Entry *entry)
+  {
+    size_t i = (size_t)entry->hash & (table_size - 1);
+
+    while (table[i].functions != NULL) {
+      if (table[i].hash == entry->hash && table[i].length == entry->length) break;
+      i = (i + 1) & (table_size - 1);
+    }
+    table[i] = *entry;
+
+    i = (size_t)entry->name & (table_size - 1);
+    while (latest[i].record != NULL && latest[i].name != entry->name) {
+      i = (i + 1) & (table_size - 1);
+    }
+    latest[i].name   = entry->name;
+    latest[i].record = entry->record;
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* Entry *find(uint64_t hash, size_t length);                             */
+/*                                                                        */
+/*      This function returns the table's record of a file or NULL if     */
+/*      there is none.                                                    */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+Entry *find(uint64_t hash, size_t length)
+  {
+    size_t i = (size_t)hash & (table_size - 1);
+
+    while (table[i].functions != NULL) {
+      if (table[i].hash == hash && table[i].length == length) return &table[i];
+      i = (i + 1) & (table_size - 1);
+    }
+    return NULL;
+  }
+
+/*------------------------------------------------------------------------*/
+/* boolean stale(const Entry *entry);                                     */
+/*                                                                        */
+/*      This function returns YES if a later record has the same name and */
+/*      this run didn't find the record.                                  */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+boolean stale(const Entry *entry)
+  {
+    size_t i = (size_t)entry->name & (table_size - 1);
+
+    if (entry->found) return NO;
+    while (latest[i].name != entry->name) i = (i + 1) & (table_size - 1);
+    return (latest[i].record != entry->record) ? YES : NO;
+  }
+
+/*------------------------------------------------------------------------*/
+/* boolean CacheOpen(const char *name);                                   */
+/*                                                                        */
+/*      This function loads the named cache file. If there is no such     */
+/*      file it is created. It returns NO if the file can't be read or    */
+/*      isn't a cache file of the right version.                          */
+/*------------------------------------------------------------------------*/
+
+PUBLIC
+boolean CacheOpen(const char *name)
+  {
+    FILE                *file;
+    const unsigned char *p;
+    const unsigned char *end;
+    unsigned char       *bigger;
+    Entry                entry;
+    size_t               size = 0;
+    size_t               count = 0;
+
+    if ((cache_name = (char *)malloc(strlen(name) + 1)) == NULL) return NO;
+    strcpy(cache_name, name);
+
+    /* Make a new, empty cache unless there is one ("x" fails if so). */
+    if ((file = fopen(name, "wbx")) != NULL) {
+      fwrite(magic, 1, MAGIC_SIZE, file);
+      if (fclose(file) != 0) return NO;
+    }
+    if ((file = fopen(name, "rb")) == NULL) return NO;
+    do {
+      if (loaded_length == size) {
+        size = (size == 0) ? 65536 : 2 * size;
+        if ((bigger = (unsigned char *)realloc(loaded, size)) == NULL) {
+          fclose(file);
+          return NO;
+        }
+        loaded = bigger;
+      }
+      loaded_length += fread(loaded + loaded_length, 1, size - loaded_length, file);
+    } while (!feof(file) && !ferror(file));
+    if (ferror(file)) {
+      fclose(file);
+      return NO;
+    }
+    fclose(file);
+
+    /* An empty file may be one that another run has just made. */
+    if (loaded_length != 0 &&
+        (loaded_length < MAGIC_SIZE || memcmp(loaded, magic, MAGIC_SIZE) != 0)) return NO;
+
+    /* Count the good records, then make a table of about twice that size. */
+    end = loaded + loaded_length;
+    for (p = loaded + MAGIC_SIZE; (p = next_record(p, end, &entry)) != NULL; ) count++;
+    for (table_size = 16; table_size < 2 * count; table_size *= 2) ;
+    if ((table = (Entry *)calloc(table_size, sizeof(Entry))) == NULL) return NO;
+    if ((latest = (Latest *)calloc(table_size, sizeof(Latest))) == NULL) return NO;
+    for (p = loaded + MAGIC_SIZE; (p = next_record(p, end, &entry)) != NULL; ) insert(&entry);
+    return YES;
+  }
+
+/*------------------------------------------------------------------------*/
+/* boolean CacheFind(FileResult *file);                                   */
+/*                                                                        */
+/*      This function looks for a file, by its hash and length, and adds  */
+/*      the functions from the cache to its result. It returns YES if it  */
+/*      found the file.                                                   */
+/*------------------------------------------------------------------------*/
+
+PUBLIC
+boolean CacheFind(FileResult *file)
+  {
+    const Entry         *entry;
+    const unsigned char *p;
+    const unsigned char *end = loaded + loaded_length;
+    FnInfo               info;
+    char                *name;
+    size_t               value[6];
+    size_t               i;
+    int                  j;
+
+    if (table == NULL || !file->hashed) return NO;
+    if ((entry = find(file->hash, file->length)) == NULL) return NO;
+
+    /* The record was checked when it was loaded. */
+    p = entry->functions;
+    for (i = 0; i < entry->count; i++) {
+      for (j = 0; j < 6; j++) {
+        get_number(&p, end, &value[j]);
+        if (j == 0) {
+          if ((name = (char *)malloc(value[0] + 1)) == NULL) {
+            file->error = "Out of memory";
+            return YES;
+          }
+          memcpy(name, p, value[0]);
+          name[value[0]] = '\0';
+          p += value[0];
+        }
+      }
+      info.name       = name;
+      info.first_line = (long)value[1];
+      info.last_line  = (long)(value[1] + value[2]);
+      info.cyclomatic = (long)value[3];
+      info.cases      = (long)value[4];
+      info.depth      = (long)value[5];
+      info.offset     = 0;
+      ResAdd(file, &info);
+      free(name);
+    }
+    file->cached = YES;
+    return YES;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void CacheAdd(const FileResult *file);                                 */
+/*                                                                        */
+/*      This function adds the result of a file that was scanned to the   */
+/*      records to be written. Files that had problems are not added. A   */
+/*      file that was found in the cache keeps its record from going      */
+/*      stale.                                                            */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+void put_bytes(const void *bytes, size_t count)
+  {
+    unsigned char *bigger;
+    size_t         size;
+
+    if (added_length + count > added_size) {
+      size = (added_size == 0) ? 65536 : 2 * added_size;
+      while (size < added_length + count) size *= 2;
+      if ((bigger = (unsigned char *)realloc(added, size)) == NULL) {
+        out_of_memory = YES;
+        return;
+      }
+      added = bigger;
+      added_size = size;
+    }
+    memcpy(added + added_length, bytes, count);
+    added_length += count;
+    return;
+  }
+
+PRIVATE
+void put_number(size_t value)
+  {
+    unsigned char bytes[10];
+    int           count = 0;
+
+    while (value >= 0x80) {
+      bytes[count++] = (unsigned char)(value | 0x80);
+      value >>= 7;
+    }
+    bytes[count++] = (unsigned char)value;
+    put_bytes(bytes, count);
+    return;
+  }
+
+PUBLIC
+void CacheAdd(const FileResult *file)
+  {
+    const FnResult *function;
+    Entry          *entry;
+    unsigned char   bytes[8];
+    size_t          start = added_length;
+    size_t          i;
+    uint32_t        check;
+    uint32_t        name;
+    int             j;
+
+    if (file->cached && (entry = find(file->hash, file->length)) != NULL) entry->found = YES;
+    if (!file->hashed || file->cached || file->error != NULL || out_of_memory) return;
+    put_bytes(mark, MARK_SIZE);
+    for (j = 0; j < 8; j++) bytes[j] = (unsigned char)(file->hash >> (8 * j));
+    put_bytes(bytes, 8);
+    name = (uint32_t)CacheHash(file->name, strlen(file->name));
+    for (j = 0; j < 4; j++) bytes[j] = (unsigned char)(name >> (8 * j));
+    put_bytes(bytes, 4);
+    put_number(file->length);
+    put_number(file->count);
+    for (i = 0; i < file->count; i++) {
+      function = &file->functions[i];
+      put_number(strlen(function->name));
+      put_bytes(function->name, strlen(function->name));
+      put_number((size_t)function->first_line);
+      put_number((size_t)(function->last_line - function->first_line));
+      put_number((size_t)function->cyclomatic);
+      put_number((size_t)function->cases);
+      put_number((size_t)function->depth);
+    }
+    if (out_of_memory) return;
+    check = (uint32_t)CacheHash((const char *)added + start, added_length - start);
+    for (j = 0; j < 4; j++) bytes[j] = (unsigned char)(check >> (8 * j));
+    put_bytes(bytes, 4);
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* boolean compact(void);                                                 */
+/*                                                                        */
+/*      This function writes the records that aren't stale, and the new   */
+/*      ones, to a new cache file and renames it over the old one if the  */
+/*      old one is mostly stale. It returns NO if it didn't, in which     */
+/*      case the old file is as it was.                                   */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+boolean compact(void)
+  {
+    FILE   *file;
+    char   *new_name;
+    size_t  live = 0;
+    size_t  i;
+    boolean result = YES;
+
+    if (table == NULL || loaded_length <= MAGIC_SIZE) return NO;
+    for (i = 0; i < table_size; i++) {
+      if (table[i].functions != NULL && !stale(&table[i])) live += table[i].size;
+    }
+    if (loaded_length - MAGIC_SIZE - live <= live) return NO;
+
+    if ((new_name = (char *)malloc(strlen(cache_name) + 5)) == NULL) return NO;
+    strcpy(new_name, cache_name);
+    strcat(new_name, ".new");
+    if ((file = fopen(new_name, "wbx")) == NULL) {
+      free(new_name);
+      return NO;
+    }
+    if (fwrite(magic, 1, MAGIC_SIZE, file) != MAGIC_SIZE) result = NO;
+    for (i = 0; i < table_size && result; i++) {
+      if (table[i].functions == NULL || stale(&table[i])) continue;
+      if (fwrite(table[i].record, 1, table[i].size, file) != table[i].size) result = NO;
+    }
+    if (result && added_length != 0 && fwrite(added, 1, added_length, file) != added_length) result = NO;
+    if (fclose(file) != 0) result = NO;
+    if (result && rename(new_name, cache_name) != 0) result = NO;
+    if (!result) remove(new_name);
+    free(new_name);
+    return result;
+  }
+
+/*------------------------------------------------------------------------*/
+/* boolean CacheClose(void);                                              */
+/*                                                                        */
+/*      This function adds the new records to the end of the cache file,  */
+/*      in one write so they can't be mixed with those of another run,    */
+/*      or writes the file again if it's mostly stale, and releases the   */
+/*      memory. It returns NO if the new records couldn't be added.       */
+/*------------------------------------------------------------------------*/
+
+PUBLIC
+boolean CacheClose(void)
+  {
+    FILE   *file;
+    boolean result = YES;
+
+    if (!out_of_memory && cache_name != NULL && compact()) added_length = 0;
+    if (added_length != 0 && !out_of_memory && cache_name != NULL) {
+      if ((file = fopen(cache_name, "ab")) == NULL) result = NO;
+      else {
+        setvbuf(file, NULL, _IONBF, 0);
+        fseek(file, 0, SEEK_END);
+        if (ftell(file) == 0) fwrite(magic, 1, MAGIC_SIZE, file);
+        if (added_length != 0 && fwrite(added, 1, added_length, file) != added_length) result = NO;
+        if (fclose(file) != 0) result = NO;
+      }
+    }
+    if (out_of_memory) result = NO;
+
+    free(cache_name);
+    free(loaded);
+    free(table);
+    free(latest);
+    free(added);
+    cache_name = NULL;
+    loaded = added = NULL;
+    table = NULL;
+    latest = NULL;
+    loaded_length = added_length = added_size = table_size = 0;
+    out_of_memory = NO;
+    return result;
+  }
@@ -0,0 +1,37 @@
+/*****************************************************************************
+FILE     : cache.h
+CONTENTS : A file of results kept from one run to the next.
+PROGRAMMER    : Peter Chapin
+
+This file contains the interface to the module that keeps the functions
+found in each file in a cache file, keyed by a hash of the file's text, so
+that files that haven't changed don't have to be scanned again. The cache
+is loaded before the files are scanned and the new results are added to it
+after; in between CacheFind() may be called from any number of threads.
+
+See CACHE.C for more information.
+
+*****************************************************************************/
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "results.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern boolean  CacheOpen(const char *);
+extern uint64_t CacheHash(const char *, size_t);
+extern boolean  CacheFind(FileResult *);
+extern void     CacheAdd(const FileResult *);
+extern boolean  CacheClose(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
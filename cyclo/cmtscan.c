@@ -1,6 +1,6 @@
 /*****************************************************************************
 FILE          : cmtscan.c
-LAST REVISION : December 1990
+LAST REVISION : October 2026
 SUBJECT       : C/C++ comment stripping functions.
 PROGRAMMER    : Peter Chapin
 
@@ -10,8 +10,52 @@ than it sounds because comment delimiters found inside string literals (or
 character literals) must be ignored. Escape sequences inside string
 literals must be noted so that the end of the literal is properly detected.
 
-To see how this module is used, I recommend looking at the file cmttst.c. I
-will note some of the important points below.
+The module has two interfaces. The block interface is the one to use in new
+code. The original character-at-a-time interface is kept for old programs;
+it is now a thin layer over the block interface.
+
+The block interface works like this.
+
+1.   The caller supplies a CmtScanner object and calls CmtScanReset() on
+     it before the start of each file. All the state of the scan lives in
+     that object, so any number of scans can be in progress at once.
+
+2.   CmtScanBlock() is given a block of source text in memory and an
+     array of the same size. It stores the kind of each character (one of
+     the CMT_xxx values in scanners.h) in the array. The / * and * / and
+     // sequences are considered part of a comment, as is the new-line
+     that ends a C++ comment. The " or ' characters are considered part of
+     the literal or constant they delimit.
+
+3.   A '/' at the very end of a block can't be classified until the next
+     character is seen. In that case CmtScanBlock() doesn't consume it; it
+     returns the number of characters it did classify and the caller must
+     present the '/' again at the start of the next block. When the last
+     block of the input is given, the final parameter must be YES. Then
+     every character is consumed and the OpenxxxError members are set to
+     YES if the input ended inside a comment or literal.
+
+4.   CmtScanRun() is the same as CmtScanBlock() except that it consumes
+     only the longest run of characters of a single kind at the start of
+     the block, and returns the kind of the run rather than filling in an
+     array. A program that wants to handle the code between comments in
+     one piece can call CmtScanRun() repeatedly. Long stretches of text
+     that can't change the scanner's state are passed over with vector
+     instructions (SSE2 or AVX2) where those are available.
+
+5.   CmtScanSpan() is a convenient way to walk a buffer a run at a time.
+     It fills in a CmtSpan giving the kind, offset, and length of the next
+     run without copying anything, and advances an offset held by the
+     caller. It also counts lines: the span records the line number of its
+     first character and the number of new-lines it contains, and the
+     line member of the scanner is kept up to date. Only CmtScanSpan()
+     maintains the line number.
+
+The state machine is driven by tables in cmttab.h, indexed by state and
+character class. Those tables are generated by cmtgen.c; see that file to
+change the syntax the scanner recognizes.
+
+The original interface works like this.
 
 1.   CmtScanInit()  must  be  called  before  the module is used. This
      function  registers  the  character  getting  function  with  the
@@ -43,9 +87,9 @@ should already be free of trigraphs and backslash spliced lines. This
 module should be used before any preprocessing actions are done. Also this
 module provides a way to detect unclosed comments in a file (as per ANSI).
 
-This module contains static variables. It is, therefor, not re-entrant and
-cannot be used recursively (ie to process include files). Future versions
-may fix this problem.
+The original interface keeps its state in static variables. It is not
+re-entrant and cannot be used recursively (ie to process include files).
+Use the block interface for that.
 
      Please send comments and bug reports to
 
@@ -57,27 +101,77 @@ may fix this problem.
 
 #include "local.h"
 #include <stdio.h>
+#include <string.h>
 #include "standard.h"
 #include "scanners.h"
 
+/* Select the vector instructions used to compare many characters at once.
+     Compile with CMT_NO_SIMD defined to force the plain C version. */
+#if !defined(CMT_NO_SIMD) && defined(__AVX2__)
+#define CMT_AVX2
+#include <immintrin.h>
+#elif !defined(CMT_NO_SIMD) && \
+    (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define CMT_SSE2
+#include <emmintrin.h>
+#endif
+
+/* VECTOR_COUNT(v, m) is the number of matches in v ahead of the first stop
+     character given by the mask m (all of them when m is zero). */
+#if defined(CMT_AVX2)
+#define VECTOR_SIZE 32
+typedef __m256i Vector;
+#define VECTOR_LOAD(p)      _mm256_loadu_si256((const __m256i *)(p))
+#define VECTOR_STORE(p, v)  _mm256_storeu_si256((__m256i *)(p), v)
+#define VECTOR_SPLAT(c)     _mm256_set1_epi8((char)(c))
+#define VECTOR_EQUAL(v, w)  _mm256_cmpeq_epi8(v, w)
+#define VECTOR_OR(v, w)     _mm256_or_si256(v, w)
+#define VECTOR_MASK(v)      ((unsigned)_mm256_movemask_epi8(v))
+#define VECTOR_COUNT(v, m)  bit_count(VECTOR_MASK(v) & (((m) & (0U - (m))) - 1))
+#elif defined(CMT_SSE2)
+#define VECTOR_SIZE 16
+typedef __m128i Vector;
+#define VECTOR_LOAD(p)      _mm_loadu_si128((const __m128i *)(p))
+#define VECTOR_STORE(p, v)  _mm_storeu_si128((__m128i *)(p), v)
+#define VECTOR_SPLAT(c)     _mm_set1_epi8((char)(c))
+#define VECTOR_EQUAL(v, w)  _mm_cmpeq_epi8(v, w)
+#define VECTOR_OR(v, w)     _mm_or_si128(v, w)
+#define VECTOR_MASK(v)      ((unsigned)_mm_movemask_epi8(v))
+#define VECTOR_COUNT(v, m)  bit_count(VECTOR_MASK(v) & (((m) & (0U - (m))) - 1))
+#else
+/* Without vector instructions a word is treated as a vector of bytes. The
+     result of VECTOR_EQUAL() has the high bit set in each byte that
+     matched, so VECTOR_COUNT() can add up those bytes. A word is only
+     counted when it holds no stop character. */
+#define VECTOR_SIZE ((size_t)sizeof(Vector))
+typedef size_t Vector;
+#define WORD_ONES ((size_t)-1 / 0xFF)
+#define WORD_LOWS (WORD_ONES * 0x7F)
+#define WORD_HIGHS (WORD_ONES * 0x80)
+#define VECTOR_LOAD(p)      word_load(p)
+#define VECTOR_STORE(p, v)  word_store(p, v)
+#define VECTOR_SPLAT(c)     (WORD_ONES * (unsigned char)(c))
+#define VECTOR_EQUAL(v, w)  (~(((((v) ^ (w)) & WORD_LOWS) + WORD_LOWS) | ((v) ^ (w))) & WORD_HIGHS)
+#define VECTOR_OR(v, w)     ((v) | (w))
+#define VECTOR_COUNT(v, m)  (long)((((v) >> 7) * WORD_ONES) >> ((sizeof(Vector) - 1) * 8))
+#endif
+
 /*=================================*/
 /*           Global Data           */
 /*=================================*/
 
-#define BOGUS_VALUE  '\0'
-
-PRIVATE int (*GetChar)(void);   /* Points at function that gets characters. */
+/* The tables that drive the state machine. See cmtgen.c. */
+#include "cmttab.h"
 
-enum state_values {
-  Code, Start_Cmt, C_Cmt, Cpp_Cmt, End_Cmt, D_Quote, S_Quote, D_Esc, S_Esc
-  };
+/* The following are used only by the original interface. */
 
-PRIVATE enum state_values state;
+PRIVATE int (*GetChar)(void);   /* Points at function that gets characters. */
 
-PRIVATE      char         buffer[2];        /* Holds chars when '/' found.  */
-PRIVATE      int          index;            /* Index into buffer[].         */
-PRIVATE      int          buffer_count;     /* Number of characters in buf. */
-PRIVATE      boolean      use_buffer=NO;    /* =YES when buffer active.     */
+PRIVATE      CmtScanner    legacy;          /* State of the original scan.  */
+PRIVATE      char          ready[2];        /* Classified, not returned.    */
+PRIVATE      unsigned char ready_kinds[2];  /* Kinds of chars in ready[].   */
+PRIVATE      int           ready_count=0;   /* Number of chars in ready[].  */
+PRIVATE      int           ready_index=0;   /* Next char to return.         */
 
 PUBLIC       boolean      Comment=NO;       /* =YES when inside comments.   */
 PUBLIC       boolean      DoubleQuote=NO;   /* =YES when inside string.     */
@@ -89,37 +183,491 @@ PUBLIC       boolean      OpenCommentError=NO;  /* =YES if unclosed cmts.   */
 /*==========================================*/
 
 /*------------------------------------------------------------------------*/
-/* int handle_eof(void);                                                  */
+/* void CmtScanReset(CmtScanner *scanner);                                */
 /*                                                                        */
-/*           This function is called when  EOF  is  detected  in the      */
-/*      input  stream.  It  returns  the  character  that is in turn      */
-/*      returned by CmtScanGetChar().                                     */
-/*           The main complication this  function deals  with occurs      */
-/*      when the EOF is immediately after a '/' character. In such a      */
-/*      case, the EOF is placed into the buffer and CmtScanGetChar()      */
-/*      is instructed to take its characters from the buffer.             */
-/*           Note that  repeated calls to CmtScanGetChar() after the      */
-/*      end of the file is reached  will not  cause probles provided      */
-/*      the  low  level  character  producing  function used by this      */
-/*      module returns EOF consistantly.                                  */
+/*      This function prepares a scanner object for a new input file.     */
 /*------------------------------------------------------------------------*/
 
+PUBLIC
+void CmtScanReset(CmtScanner *scanner)
+  {
+    scanner->state = Code;
+    scanner->pending = 0;
+    scanner->pending_kind = CMT_CODE;
+    scanner->line = 1;
+    scanner->OpenCommentError = NO;
+    scanner->OpenStringError = NO;
+    scanner->OpenCharError = NO;
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* int first_bit(unsigned mask);                                          */
+/* int bit_count(unsigned mask);                                          */
+/*                                                                        */
+/*      These functions return the position of the lowest bit set in a    */
+/*      non-zero mask and the number of bits set in a mask.               */
+/*------------------------------------------------------------------------*/
+
+#if defined(CMT_AVX2) || defined(CMT_SSE2)
+
 PRIVATE
-int handle_eof(void)
+int first_bit(unsigned mask)
   {
-    int ret_value=EOF;
-
-    if (state == Start_Cmt) {
-      buffer[index] = EOF;
-      buffer_count++;
-      index = 0;
-      use_buffer = YES;
-      ret_value = BOGUS_VALUE;
+#if defined(__GNUC__)
+    return __builtin_ctz(mask);
+#else
+    int n = 0;
+
+    while ((mask & 1) == 0) {
+      mask >>= 1;
+      n++;
     }
-    else if (state == C_Cmt) {
-      OpenCommentError = YES;
+    return n;
+#endif
+  }
+
+PRIVATE
+int bit_count(unsigned mask)
+  {
+#if defined(__GNUC__) && defined(__POPCNT__)
+    return __builtin_popcount(mask);
+#else
+    /* Add the bits in pairs, then fours, then bytes, without branches. */
+    mask = mask - ((mask >> 1) & 0x55555555U);
+    mask = (mask & 0x33333333U) + ((mask >> 2) & 0x33333333U);
+    mask = (mask + (mask >> 4)) & 0x0F0F0F0FU;
+    return (int)((mask * 0x01010101U) >> 24);
+#endif
+  }
+
+#endif
+
+/*------------------------------------------------------------------------*/
+/* size_t word_load(const unsigned char *p);                              */
+/* void word_store(unsigned char *p, size_t word);                        */
+/*                                                                        */
+/*      These functions move a word to or from memory that might not be   */
+/*      aligned. The compiler turns the memcpy() into a single move.      */
+/*------------------------------------------------------------------------*/
+
+#if !defined(CMT_AVX2) && !defined(CMT_SSE2)
+
+PRIVATE
+size_t word_load(const unsigned char *p)
+  {
+    size_t word;
+
+    memcpy(&word, p, sizeof(word));
+    return word;
+  }
+
+PRIVATE
+void word_store(unsigned char *p, size_t word)
+  {
+    memcpy(p, &word, sizeof(word));
+    return;
+  }
+
+#endif
+
+/*------------------------------------------------------------------------*/
+/* void check_end(CmtScanner *scanner);                                   */
+/*                                                                        */
+/*      This function notes any comment or literal open at end of input.  */
+/*      A C++ comment is closed by the end of the input.                  */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+void check_end(CmtScanner *scanner)
+  {
+    int kind = state_kind[scanner->state];
+
+    scanner->OpenCommentError = (kind == CMT_C_COMMENT);
+    scanner->OpenStringError  = (kind == CMT_STRING);
+    scanner->OpenCharError    = (kind == CMT_CHAR);
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* The scanning loop.                                                     */
+/*                                                                        */
+/*      CmtScanBlock() and CmtScanSpan() below implement a finite state   */
+/*      machine which recognizes C/C++ comments, string literals, and     */
+/*      character constants. All the knowledge of C/C++ is in the tables  */
+/*      from cmttab.h, but the loop is written out once for each state    */
+/*      (with the help of the lists in that file). The state number is a  */
+/*      constant in each copy, so the compiler turns the table entries    */
+/*      it uses into constants: the stop characters are compared with     */
+/*      immediate values, and each transition is a jump straight to the   */
+/*      code for the next state.                                          */
+/*      In most states class Other leaves the state alone. There the run  */
+/*      up to the next stop character is found by comparing a vector of   */
+/*      characters (a word when there are no vector instructions) with    */
+/*      each stop character at once. The last few characters of a block   */
+/*      are stepped over one at a time.                                   */
+/*      The look ahead problem (comments are introduced with two          */
+/*      characters) is handled with a look ahead state. Entering one      */
+/*      holds the character that led there; the code for the look ahead   */
+/*      state then applies the transition for the following character     */
+/*      (or End) and gives both characters the kind of that transition.   */
+/*                                                                        */
+/*      The two functions differ only in what they do with the characters */
+/*      (store their kinds, or check that they continue the run and count */
+/*      new-lines). The SCAN_xxx hooks used below are defined just before */
+/*      each function.                                                    */
+/*------------------------------------------------------------------------*/
+
+/* Does the state "here" leave itself unchanged on class Other? */
+#define SCAN_STAYS \
+  ((transition[here][0] & 0xFF) == here && (transition[here][0] >> 8) == state_kind[here])
+
+/* Is c one of the characters whose transition differs from Other's? */
+#define SCAN_STOP(c) \
+  ((state_stops[here].count < 0) ? \
+     transition[here][byte_class[c]] != transition[here][0] : \
+   ((state_stops[here].count > 0 && (c) == state_stops[here].stop[0]) || \
+    (state_stops[here].count > 1 && (c) == state_stops[here].stop[1]) || \
+    (state_stops[here].count > 2 && (c) == state_stops[here].stop[2])))
+
+/* The transition for c in the state "here", given to action. */
+#define SCAN_CHOOSE(action, class_action) \
+  if (state_stops[here].count < 0) { \
+    switch (byte_class[c]) { \
+      CMT_EACH_CLASS(class_action) \
+    } \
+  } \
+  else if (state_stops[here].count > 0 && c == state_stops[here].stop[0]) \
+    action(transition[here][byte_class[state_stops[here].stop[0]]]) \
+  else if (state_stops[here].count > 1 && c == state_stops[here].stop[1]) \
+    action(transition[here][byte_class[state_stops[here].stop[1]]]) \
+  else if (state_stops[here].count > 2 && c == state_stops[here].stop[2]) \
+    action(transition[here][byte_class[state_stops[here].stop[2]]]) \
+  else \
+    action(transition[here][0])
+
+/* Take the transition given by entry for the character at i. */
+#define SCAN_MOVE(entry) \
+  { \
+    if (state_look_ahead[(entry) & 0xFF]) held = here; \
+    else { \
+      SCAN_TAKE(entry); \
+    } \
+    i++; \
+    next = (entry) & 0xFF; \
+    goto dispatch; \
+  }
+
+#define SCAN_MOVE_CLASS(class) \
+  case class: SCAN_MOVE(transition[here][class])
+
+/* The same in a look ahead state, where the held character is at i-1. */
+#define SCAN_RESOLVE(entry) \
+  { \
+    SCAN_TAKE_HELD(entry); \
+    i++; \
+    next = (entry) & 0xFF; \
+    goto dispatch; \
+  }
+
+#define SCAN_RESOLVE_CLASS(class) \
+  case class: SCAN_RESOLVE(transition[here][class])
+
+/* Pass over the characters before the next stop character a vector at a
+     time. A word only tells whether it holds a stop character, so that
+     word, like the last few characters of the block, is left to the loop
+     in SCAN_STATE() that steps over one character at a time. */
+#if defined(CMT_AVX2) || defined(CMT_SSE2)
+#define SCAN_FOUND(S) \
+  mask = (state_stops[here].count > 0) ? VECTOR_MASK(hits) : 0; \
+  SCAN_PASS_VECTOR(piece, mask); \
+  if (mask != 0) { \
+    i += first_bit(mask); \
+    c = p[i]; \
+    goto stop_##S; \
+  }
+#else
+#define SCAN_FOUND(S) \
+  if (state_stops[here].count > 0 && hits != 0) break; \
+  SCAN_PASS_VECTOR(piece, 0);
+#endif
+
+#define SCAN_VECTORS(S) \
+  if (state_stops[here].count >= 0) { \
+    while (size - i >= VECTOR_SIZE) { \
+      piece = VECTOR_LOAD(p + i); \
+      hits  = VECTOR_EQUAL(piece, VECTOR_SPLAT(state_stops[here].stop[0])); \
+      if (state_stops[here].count > 1) \
+        hits = VECTOR_OR(hits, VECTOR_EQUAL(piece, VECTOR_SPLAT(state_stops[here].stop[1]))); \
+      if (state_stops[here].count > 2) \
+        hits = VECTOR_OR(hits, VECTOR_EQUAL(piece, VECTOR_SPLAT(state_stops[here].stop[2]))); \
+      SCAN_FOUND(S) \
+      i += VECTOR_SIZE; \
+    } \
+  }
+
+#define SCAN_STATE(S) \
+  case S: \
+    { \
+      enum { here = S }; \
+      if (state_look_ahead[here]) { \
+        if (i == size) { \
+          if (!at_end) { \
+            i--; \
+            state = held; \
+            goto done; \
+          } \
+          SCAN_TAKE_END(transition[here][CMT_END_CLASS]); \
+          state = transition[here][CMT_END_CLASS] & 0xFF; \
+          goto done; \
+        } \
+        c = p[i]; \
+        SCAN_CHOOSE(SCAN_RESOLVE, SCAN_RESOLVE_CLASS) \
+      } \
+      else if (SCAN_STAYS) { \
+        SCAN_ENTER(S) \
+        SCAN_VECTORS(S) \
+        while (i < size) { \
+          c = p[i]; \
+          if (SCAN_STOP(c)) goto stop_##S; \
+          SCAN_PASS(c); \
+          i++; \
+        } \
+        state = here; \
+        goto done; \
+      stop_##S: \
+        SCAN_CHOOSE(SCAN_MOVE, SCAN_MOVE_CLASS) \
+      } \
+      else { \
+        if (i == size) { \
+          state = here; \
+          goto done; \
+        } \
+        c = p[i]; \
+        SCAN_CHOOSE(SCAN_MOVE, SCAN_MOVE_CLASS) \
+      } \
+    }
+
+/*------------------------------------------------------------------------*/
+/* size_t CmtScanBlock(                                                   */
+/*   CmtScanner *scanner, const char *block, size_t size,                 */
+/*   unsigned char *kinds, boolean at_end);                               */
+/*                                                                        */
+/*      This function classifies the characters of block[] into kinds[]   */
+/*      and returns the number of characters classified (see the top of   */
+/*      this file). A whole vector of kinds is stored at a time; those    */
+/*      past the end of the run are stored again by the next state.       */
+/*------------------------------------------------------------------------*/
+
+#define SCAN_ENTER(S)
+#define SCAN_PASS(c)             kinds[i] = state_kind[here]
+#define SCAN_PASS_VECTOR(v, m)   VECTOR_STORE(kinds + i, VECTOR_SPLAT(state_kind[here]))
+#define SCAN_TAKE(entry)         kinds[i] = (unsigned char)((entry) >> 8)
+#define SCAN_TAKE_HELD(entry)    kinds[i - 1] = kinds[i] = (unsigned char)((entry) >> 8)
+#define SCAN_TAKE_END(entry)     kinds[i - 1] = (unsigned char)((entry) >> 8)
+
+PUBLIC
+size_t CmtScanBlock(
+  CmtScanner    *scanner,
+  const char    *block,
+  size_t         size,
+  unsigned char *kinds,
+  boolean        at_end)
+  {
+    const unsigned char *p = (const unsigned char *)block;
+    int      state = scanner->state;
+    int      next  = state;
+    int      held  = state;
+    int      c;
+    size_t   i = 0;
+    Vector   piece, hits;
+#if defined(CMT_AVX2) || defined(CMT_SSE2)
+    unsigned mask;
+#endif
+
+    if (scanner->pending != 0) {
+      if (size < (size_t)scanner->pending) return 0;
+      i = (size_t)scanner->pending;
+      memset(kinds, scanner->pending_kind, i);
+      scanner->pending = 0;
+    }
+
+  dispatch:
+    switch (next) {
+      CMT_EACH_STATE(SCAN_STATE)
+    }
+  done:
+    scanner->state = state;
+    if (at_end && i == size) check_end(scanner);
+    return i;
+  }
+
+#undef SCAN_ENTER
+#undef SCAN_PASS
+#undef SCAN_PASS_VECTOR
+#undef SCAN_TAKE
+#undef SCAN_TAKE_HELD
+#undef SCAN_TAKE_END
+
+/*------------------------------------------------------------------------*/
+/* boolean CmtScanSpan(                                                   */
+/*   CmtScanner *scanner, const char *block, size_t size, size_t *offset, */
+/*   CmtSpan *span, boolean at_end);                                      */
+/*                                                                        */
+/*      This function describes the run of characters in block[] that     */
+/*      starts at *offset and then advances *offset past it. It returns   */
+/*      NO when there is no run to describe: either the block is used up  */
+/*      or all that is left is a '/' that must be given again with the    */
+/*      next block. In both cases block[*offset..size-1] is the part of   */
+/*      the block that was not consumed.                                  */
+/*      The transition that ends a run has already been taken when the    */
+/*      run is reported. The characters it covered are left pending in    */
+/*      the scanner and start the next run, so they are not looked at     */
+/*      twice.                                                            */
+/*------------------------------------------------------------------------*/
+
+/* A state whose own kind is not that of the run ends it, unless the next
+     character changes the state. The first character fixes the run's kind. */
+#define SCAN_ENTER(S) \
+  if (state_kind[here] != run_kind) { \
+    if (i < size && SCAN_STOP(p[i])) { \
+      c = p[i]; \
+      goto stop_##S; \
+    } \
+    if (run_kind >= 0 || i == size) { \
+      state = here; \
+      goto done; \
+    } \
+    run_kind = state_kind[here]; \
+  }
+
+#define SCAN_PASS(c)       count += ((c) == '\n')
+
+/* Count the new-lines in the vector ahead of the first stop character. */
+#define SCAN_PASS_VECTOR(v, m) \
+  count += VECTOR_COUNT(VECTOR_EQUAL(v, VECTOR_SPLAT('\n')), m)
+
+/* End the run before the last n characters, which were given entry. */
+#define SCAN_PEND(n, entry) \
+  { \
+    i -= (n) - 1; \
+    scanner->pending      = (n); \
+    scanner->pending_kind = (int)((entry) >> 8); \
+    state = (entry) & 0xFF; \
+    goto done; \
+  }
+
+#define SCAN_TAKE(entry) \
+  if ((int)((entry) >> 8) != run_kind) { \
+    if (run_kind >= 0) SCAN_PEND(1, entry) \
+    run_kind = (int)((entry) >> 8); \
+  } \
+  count += (c == '\n')
+
+#define SCAN_TAKE_HELD(entry) \
+  if ((int)((entry) >> 8) != run_kind) { \
+    if (run_kind >= 0) SCAN_PEND(2, entry) \
+    run_kind = (int)((entry) >> 8); \
+  } \
+  count += (p[i - 1] == '\n') + (c == '\n')
+
+#define SCAN_TAKE_END(entry) \
+  if ((int)((entry) >> 8) != run_kind) { \
+    if (run_kind >= 0) { \
+      i--; \
+      SCAN_PEND(1, entry) \
+    } \
+    run_kind = (int)((entry) >> 8); \
+  } \
+  count += (p[i - 1] == '\n')
+
+PUBLIC
+boolean CmtScanSpan(
+  CmtScanner *scanner,
+  const char *block,
+  size_t      size,
+  size_t     *offset,
+  CmtSpan    *span,
+  boolean     at_end)
+  {
+    const unsigned char *p = (const unsigned char *)block + *offset;
+    int      state    = scanner->state;
+    int      next     = state;
+    int      held     = state;
+    int      run_kind = -1;
+    int      c;
+    long     count = 0;
+    size_t   i = 0;
+    Vector   piece, hits;
+#if defined(CMT_AVX2) || defined(CMT_SSE2)
+    unsigned mask;
+#endif
+
+    size -= *offset;
+    if (scanner->pending != 0) {
+      if (size < (size_t)scanner->pending) return NO;
+      i = (size_t)scanner->pending;
+      run_kind = scanner->pending_kind;
+      count = (p[0] == '\n') + (i > 1 && p[1] == '\n');
+      scanner->pending = 0;
     }
-    return ret_value;
+
+  dispatch:
+    switch (next) {
+      CMT_EACH_STATE(SCAN_STATE)
+    }
+  done:
+    scanner->state = state;
+    if (at_end && i == size) check_end(scanner);
+    if (i == 0) return NO;
+
+    span->kind     = run_kind;
+    span->offset   = *offset;
+    span->length   = i;
+    span->line     = scanner->line;
+    span->newlines = count;
+    scanner->line += count;
+    *offset       += i;
+    return YES;
+  }
+
+#undef SCAN_ENTER
+#undef SCAN_PASS
+#undef SCAN_PASS_VECTOR
+#undef SCAN_PEND
+#undef SCAN_TAKE
+#undef SCAN_TAKE_HELD
+#undef SCAN_TAKE_END
+
+/*------------------------------------------------------------------------*/
+/* size_t CmtScanRun(                                                     */
+/*   CmtScanner *scanner, const char *block, size_t size, int *kind,      */
+/*   boolean at_end);                                                     */
+/*                                                                        */
+/*      This function consumes the longest run of characters at the       */
+/*      start of block[] that are all of the same kind. It returns the    */
+/*      length of the run and stores its kind through the kind parameter. */
+/*      A return of zero means more input is needed (or size was zero).   */
+/*      It is CmtScanSpan() without the line count.                       */
+/*------------------------------------------------------------------------*/
+
+PUBLIC
+size_t CmtScanRun(
+  CmtScanner *scanner,
+  const char *block,
+  size_t      size,
+  int        *kind,
+  boolean     at_end)
+  {
+    CmtSpan span;
+    size_t  offset = 0;
+    long    line   = scanner->line;
+
+    *kind = CMT_CODE;
+    if (!CmtScanSpan(scanner, block, size, &offset, &span, at_end)) return 0;
+    scanner->line = line;
+    *kind = span.kind;
+    return span.length;
   }
 
 /*------------------------------------------------------------------------*/
@@ -133,127 +681,48 @@ PUBLIC
 void CmtScanInit(int (*input_fun)(void))
   {
     GetChar = input_fun;
+    CmtScanReset(&legacy);
+    ready_count = ready_index = 0;
+    OpenCommentError = NO;
     return;
   }
 
 /*------------------------------------------------------------------------*/
 /* int CmtScanGetChar(void);                                              */
 /*                                                                        */
-/*           This function  implements a  finite state machine which      */
-/*      recognizes C/C++ comments,  string  literals,  and character      */
-/*      constants. The states are enumerated in enum state_values. A      */
-/*      switch statement is used in connection with a state variable      */
-/*      to control the transitions of the FSM.                            */
-/*           The look  ahead problem  (due to the fact that comments      */
-/*      are introduced  and closed  with two  characters) is handled      */
-/*      with a  buffer. When  a potential  opening comment is found,      */
-/*      this function loops again to try the next  character. If the      */
-/*      slash is not due to a comment, characters are extracted from      */
-/*      the buffer until the  buffer  is  exhausted.  Note  that the      */
-/*      buffer will  never be  more than  two characters deep (first      */
-/*      character always a '/'). This technique allows the EOF to be      */
-/*      handled more gracefully if it arrives at an unexpected time.      */
+/*      This function returns the next character of the input and sets    */
+/*      the global flags to describe it. Characters are pulled from the   */
+/*      input one at a time and given to CmtScanBlock(). Normally each    */
+/*      character is classified at once. A '/' is held until the next     */
+/*      character arrives, and then both are returned in turn.            */
+/*      Note that repeated calls to CmtScanGetChar() after the end of the */
+/*      file is reached will not cause problems provided the low level    */
+/*      character producing function used by this module returns EOF      */
+/*      consistantly.                                                     */
 /*------------------------------------------------------------------------*/
 
 PUBLIC
 int CmtScanGetChar(void)
   {
     int c;
-    int ret_value=BOGUS_VALUE;
-
-    do {
-      if (use_buffer) {
-        ret_value = buffer[index++];
-        if (--buffer_count == 0) use_buffer = NO;
-      }
-      else if ((c=GetChar()) == EOF) {
-        ret_value = handle_eof();
-      }
-      else switch (state) {
-        case Code:              /* 'Normal' state. */
-          Comment = NO;
-          DoubleQuote = NO;
-          SingleQuote = NO;
-          if (c == '/') {
-            index = buffer_count = 0;
-            buffer[index++] = c;
-            buffer_count++;
-            state = Start_Cmt;
-          }
-          else if (c == '\"') {
-            DoubleQuote = YES;
-            ret_value = c;
-            state = D_Quote;
-          }
-          else if (c == '\'') {
-            SingleQuote = YES;
-            ret_value = c;
-            state = S_Quote;
-          }
-          else ret_value = c;
-          break;
-
-        case Start_Cmt:         /* A '/' has already been found. */
-          Comment = YES;
-          if (c == '/') state = Cpp_Cmt;
-          else if (c == '*') state = C_Cmt;
-          else {
-            state = Code;
-            Comment = NO;
-          }
-          buffer[index] = c;
-          buffer_count++;
-          index = 0;
-          use_buffer = YES;
-          break;
-
-        case C_Cmt:             /* A '/*' has been found. */
-          ret_value = c;
-          if (c == '*') state = End_Cmt;
-          break;
-
-        case Cpp_Cmt:           /* A '//' has been found. */
-          ret_value = c;
-          if (c == '\n') state = Code;
-          break;
-
-        case End_Cmt:           /* A '*' has been found inside a C_Cmt. */
-          ret_value = c;
-          if (c == '/') state = Code;
-            else if (c != '*') state = C_Cmt;
-          break;
-
-        case D_Quote:           /* A '"' has been found. */
-          ret_value = c;
-          if (c == '\\') state = D_Esc;
-          else if (c == '\"') state = Code;
-          break;
-
-        case S_Quote:           /* A '\'' has been found. */
-          ret_value = c;
-          if (c == '\\') state = S_Esc;
-          else if (c == '\'') state = Code;
-          break;
-
-        case D_Esc:             /* A '\\' has been found inside a string. */
-          ret_value = c;
-          state = D_Quote;
-          break;
-
-        case S_Esc:             /* A '\\' has been found inside char const. */
-          ret_value = c;
-          state = S_Quote;
+    int kind;
+
+    if (ready_index == ready_count) {
+      ready_count = ready_index = 0;
+      do {
+        if ((c = GetChar()) == EOF) {
+          ready_count = (int)CmtScanBlock(&legacy, ready, ready_count, ready_kinds, YES);
+          OpenCommentError = legacy.OpenCommentError;
+          if (ready_count == 0) return EOF;
           break;
+        }
+        ready[ready_count++] = (char)c;
+      } while (CmtScanBlock(&legacy, ready, ready_count, ready_kinds, NO) == 0);
+    }
 
-        default:                /* Something went wrong. */
-          fprintf(stderr,
-            "\n\nINTERNAL ERROR: Bad state in CmtScanGetChar(): %d\n\n",
-            (int) state
-          );
-          state = Code;
-          ret_value = c;
-          break;
-      }
-    } while (ret_value == BOGUS_VALUE);
-    return ret_value;
+    kind = ready_kinds[ready_index];
+    Comment     = (kind == CMT_C_COMMENT || kind == CMT_CPP_COMMENT);
+    DoubleQuote = (kind == CMT_STRING);
+    SingleQuote = (kind == CMT_CHAR);
+    return (unsigned char)ready[ready_index++];
   }
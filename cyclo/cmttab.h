@@ -0,0 +1,84 @@
+/* cmttab.h: Tables for the comment scanner in cmtscan.c.
+     Generated by cmtgen.c. Do not edit; change cmtgen.c instead. */
+
+#define CMT_STATE_COUNT 9
+#define CMT_CLASS_COUNT 8
+#define CMT_END_CLASS   7
+#define CMT_MAX_STOPS   3
+
+/* Lists of the state and class numbers. cmtscan.c uses them to write
+     out its scanning loop once for each state. */
+#define CMT_EACH_STATE(X) X(0) X(1) X(2) X(3) X(4) X(5) X(6) X(7) X(8)
+#define CMT_EACH_CLASS(X) X(0) X(1) X(2) X(3) X(4) X(5) X(6) X(7)
+
+enum state_values {
+  Code, Slash, C_Cmt, End_Cmt, Cpp_Cmt, D_Quote, D_Esc, S_Quote, S_Esc
+  };
+
+/* The class of each character. */
+PRIVATE const unsigned char byte_class[256] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 6, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 3, 0, 0, 0, 0, 4, 0, 0, 2, 0, 0, 0, 0, 1,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 5, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+  };
+
+/* Next state (low byte) and kind (high byte) for each state and class. */
+PRIVATE const unsigned short transition[CMT_STATE_COUNT][CMT_CLASS_COUNT] = {
+  { 0x0000, 0x0001, 0x0000, 0x0305, 0x0407, 0x0000, 0x0000, 0x0000 },  /* Code */
+  { 0x0000, 0x0204, 0x0102, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000 },  /* Slash */
+  { 0x0102, 0x0102, 0x0103, 0x0102, 0x0102, 0x0102, 0x0102, 0x0102 },  /* C_Cmt */
+  { 0x0102, 0x0100, 0x0103, 0x0102, 0x0102, 0x0102, 0x0102, 0x0102 },  /* End_Cmt */
+  { 0x0204, 0x0204, 0x0204, 0x0204, 0x0204, 0x0204, 0x0200, 0x0204 },  /* Cpp_Cmt */
+  { 0x0305, 0x0305, 0x0305, 0x0300, 0x0305, 0x0306, 0x0305, 0x0305 },  /* D_Quote */
+  { 0x0305, 0x0305, 0x0305, 0x0305, 0x0305, 0x0305, 0x0305, 0x0305 },  /* D_Esc */
+  { 0x0407, 0x0407, 0x0407, 0x0407, 0x0400, 0x0408, 0x0407, 0x0407 },  /* S_Quote */
+  { 0x0407, 0x0407, 0x0407, 0x0407, 0x0407, 0x0407, 0x0407, 0x0407 }   /* S_Esc */
+  };
+
+/* The kind of the characters that leave each state unchanged. */
+PRIVATE const unsigned char state_kind[CMT_STATE_COUNT] = {
+  CMT_CODE,         /* Code */
+  CMT_CODE,         /* Slash */
+  CMT_C_COMMENT,    /* C_Cmt */
+  CMT_C_COMMENT,    /* End_Cmt */
+  CMT_CPP_COMMENT,  /* Cpp_Cmt */
+  CMT_STRING,       /* D_Quote */
+  CMT_STRING,       /* D_Esc */
+  CMT_CHAR,         /* S_Quote */
+  CMT_CHAR          /* S_Esc */
+  };
+
+/* =1 for states that are resolved by looking at the next character. */
+PRIVATE const unsigned char state_look_ahead[CMT_STATE_COUNT] = {
+  0, 1, 0, 0, 0, 0, 0, 0, 0
+  };
+
+/* The characters whose transition differs from that of class Other
+     (count -1: too many to list). Unused entries repeat the first. */
+PRIVATE const struct {
+  int           count;
+  unsigned char stop[CMT_MAX_STOPS];
+} state_stops[CMT_STATE_COUNT] = {
+  {  3, { 0x22, 0x27, 0x2F } },  /* Code */
+  {  2, { 0x2A, 0x2F, 0x2A } },  /* Slash */
+  {  1, { 0x2A, 0x2A, 0x2A } },  /* C_Cmt */
+  {  2, { 0x2A, 0x2F, 0x2A } },  /* End_Cmt */
+  {  1, { 0x0A, 0x0A, 0x0A } },  /* Cpp_Cmt */
+  {  2, { 0x22, 0x5C, 0x22 } },  /* D_Quote */
+  {  0, { 0x00, 0x00, 0x00 } },  /* D_Esc */
+  {  2, { 0x27, 0x5C, 0x27 } },  /* S_Quote */
+  {  0, { 0x00, 0x00, 0x00 } }   /* S_Esc */
+  };
@@ -2,6 +2,19 @@
 /* cyclo.c                                                      */
 /*                                                              */
 /* Program to measure the cyclomatic complexity of a C program. */
+/* The functions (and C++ methods, operators, etc) are found by */
+/* FNSCAN.C.                                                    */
+/*                                                              */
+/* With -e the program copies one file to its output with the   */
+/* description of each function after its closing brace.       */
+/* Otherwise it scans all the files (and directories) it is     */
+/* given, several at a time, and writes one report for all of   */
+/* them in JSON or CSV (see RESULTS.C). With -g or -d it only  */
+/* reports the functions changed between two versions (see      */
+/* DELTA.C). Build it with threads, for example:                */
+/*                                                              */
+/*   gcc -O2 -pthread cyclo.c fnscan.c keyscan.c cmtscan.c      */
+/*       results.c delta.c cache.c standard.c                   */
 /*==============================================================*/
 
 #include <stdio.h>
@@ -10,157 +23,425 @@
 
 #include "standard.h"
 #include "scanners.h"
+#include "keyscan.h"
+#include "fnscan.h"
+#include "results.h"
+#include "delta.h"
+#include "cache.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define HAVE_DIRENT
+#endif
+
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L && !defined(__STDC_NO_THREADS__)
+#include <threads.h>
+#define HAVE_THREADS
+#endif
 
 /*=================================*/
 /*	     Global Data	   */
 /*=================================*/
 
+#define BLOCK_SIZE 65536
+
 FILE	*infile;
-boolean  in_funct;
-int	 lines_in_funct=0;
+
+char	 buffer[BLOCK_SIZE];   /* Holds a block of the input. */
+size_t	 shown;		       /* Amount of the block printed so far. */
+
+/* The following are used when making a report. */
+
+FileResult *files = NULL;      /* The files to scan, in order. */
+size_t	    file_count = 0;
+size_t	    file_size = 0;
+size_t	    next_file = 0;     /* The next one for a worker to take. */
+boolean	    use_cache = NO;    /* =YES if there is a cache file (-k). */
+
+#ifdef HAVE_THREADS
+mtx_t	    file_lock;	       /* Protects next_file. */
+#endif
 
 /*==========================================*/
 /*	     Function Definitions	    */
 /*==========================================*/
 
-int scanstr(char *buffer, char *search)
+/* Prints the block up to the end of a function and then the description. */
+
+void show_function(void *context, const FnInfo *info)
+  {
+    (void)context;
+    fwrite(buffer + shown, 1, info->offset + 1 - shown, stdout);
+    shown = info->offset + 1;
+
+    printf("\n\n/********** End of Function **********\n");
+    printf("\nFunction name = %s.", info->name);
+    printf("\nFunction contains %ld lines (%ld to %ld).",
+      info->last_line - info->first_line + 1, info->first_line, info->last_line);
+    printf("\nTotal cyclomatic number = %ld.", info->cyclomatic);
+    printf("\nNumber of \"case\" statements = %ld.", info->cases);
+    printf("\nMaximum nesting depth = %ld.\n", info->depth);
+    printf("\n*************************************/\n");
+    return;
+  }
+
+/*--------------------------*/
+
+int scan_file(void)
   {
-    char *buf_ptr=buffer;
-    int  n_times=0;
+    FnScanner scanner;
+    size_t    held=0;
+    size_t    count;
+    size_t    used;
+    boolean   at_end;
+    int       exit_code=0;
+
+    FnScanReset(&scanner, show_function, NULL);
+    do {
+      count  = held + fread(buffer + held, 1, BLOCK_SIZE - held, infile);
+      at_end = (feof(infile) || ferror(infile)) ? YES : NO;
+      shown  = 0;
+      used   = FnScanBlock(&scanner, buffer, count, at_end);
+      fwrite(buffer + shown, 1, used - shown, stdout);
+
+      /* A '/' at the end of the block is given again with the next one. */
+      held = count - used;
+      if (held != 0) buffer[0] = buffer[used];
+    } while (!at_end);
+
+    if (scanner.out_of_memory) {
+      fprintf(stderr, "ERROR: Out of memory. Some function names are incomplete.\n");
+      exit_code = 1;
+    }
+    FnScanFree(&scanner);
+    return exit_code;
+  }
 
-    while ((buf_ptr=strstr(buf_ptr, search)) != NULL) {
-      n_times++;
-      buf_ptr++;   /* Bump up so the next match is different. */
+/*--------------------------*/
+
+/* realloc() that gives up on the program if it fails. */
+
+void *get_memory(void *old, size_t size)
+  {
+    void *p = realloc(old, size);
+
+    if (p == NULL) {
+      fprintf(stderr, "CYCLO: Out of memory\n");
+      exit(2);
+    }
+    return p;
+  }
+
+/*--------------------------*/
+
+/* Adds a file to the list of files to scan. */
+
+void add_file(const char *name)
+  {
+    if (file_count == file_size) {
+      file_size = (file_size == 0) ? 64 : 2 * file_size;
+      files = (FileResult *)get_memory(files, file_size * sizeof(FileResult));
+    }
+    ResInit(&files[file_count++], name);
+    return;
+  }
+
+/*--------------------------*/
+
+/* Adds the C/C++ source files in a directory, and in the directories */
+/* below it. Symbolic links to directories are not followed.          */
+
+#ifdef HAVE_DIRENT
+
+void add_directory(const char *path)
+  {
+    DIR	   *directory;
+    struct dirent *entry;
+    struct stat	   info;
+    char   *name;
+
+    if ((directory = opendir(path)) == NULL) {
+      fprintf(stderr, "CYCLO: Can't open directory %s\n", path);
+      return;
+    }
+    while ((entry = readdir(directory)) != NULL) {
+      if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+      name = (char *)get_memory(NULL, strlen(path) + strlen(entry->d_name) + 2);
+      sprintf(name, "%s/%s", path, entry->d_name);
+      if (lstat(name, &info) == 0) {
+	if (S_ISDIR(info.st_mode)) add_directory(name);
+	else if (ResIsSource(entry->d_name) && stat(name, &info) == 0 && S_ISREG(info.st_mode))
+	  add_file(name);
+      }
+      free(name);
     }
-    return (n_times);
+    closedir(directory);
+    return;
   }
 
+#endif
+
 /*--------------------------*/
 
-#define DUMP_STATS   257  /* Outside the range of anybody's character */
-#define MAX_BUF_SIZE 256
+/* Adds a name from the command line or a list. Directories are searched. */
 
-void compile_stats(int ch)
+void add_name(const char *name)
   {
-    static char buffer[MAX_BUF_SIZE+1];
-    static char *buf_ptr=buffer;
-    static int  buf_length=0;
-    static int	cyclo_number=1;
-    static int	n_cases=0;
-    
-    switch(ch) {
-      case DUMP_STATS:
-	printf("\n\n/********** End of Function **********\n");
-	printf("\nFunction contains %d lines.", lines_in_funct);
-	printf("\nTotal cyclomatic number = %d.", cyclo_number);
-	printf("\nNumber of \"case\" statements = %d.\n", n_cases);
-	printf("\n*************************************/\n");
-	lines_in_funct = 0;
-	cyclo_number = 1;
-	n_cases = 0;
-        break;
-        
-      default:
-        if (ch != '\n') {
-          if (buf_length < MAX_BUF_SIZE) {
-            *buf_ptr++ = ch;
-            buf_length++;
-          }
-        }
-        else {
-          *buf_ptr = '\0';
-	  cyclo_number += scanstr(buffer, "if ");
-	  cyclo_number += scanstr(buffer, "if(");
-	  cyclo_number += scanstr(buffer, "for ");
-	  cyclo_number += scanstr(buffer, "for(");
-	  cyclo_number += scanstr(buffer, "while ");
-	  cyclo_number += scanstr(buffer, "while(");
-	  cyclo_number += scanstr(buffer, "case ");
-	  n_cases      += scanstr(buffer, "case ");
-	  cyclo_number += scanstr(buffer, "&&");
-	  cyclo_number += scanstr(buffer, "||");
-	  buf_ptr = buffer;
-	  buf_length = 0;
-        }
-        break;
+#ifdef HAVE_DIRENT
+    struct stat info;
+
+    if (stat(name, &info) == 0 && S_ISDIR(info.st_mode)) {
+      add_directory(name);
+      return;
     }
+#endif
+    add_file(name);
     return;
   }
-  
+
 /*--------------------------*/
 
-void find_funct(int ch)
+/* Adds the names in a list file, one per line. "-" is the standard input. */
+
+boolean add_list(const char *list_name)
   {
-    static int bracket_level=0;
-    static int looking_for_semi=NO;
-    static char s[]="struct";
-    static char *sptr=s;
+    FILE  *list;
+    char   line[1024];
+    size_t length;
 
-    if (bracket_level == 0  &&	ch == *sptr) {
-      sptr++;
-      if (*sptr == '\0') looking_for_semi = YES;
+    list = (strcmp(list_name, "-") == 0) ? stdin : fopen(list_name, "r");
+    if (list == NULL) {
+      fprintf(stderr, "CYCLO: Can't open list %s\n", list_name);
+      return NO;
     }
-    else if (bracket_level == 0 && ch != *sptr) sptr = s;
+    while (fgets(line, sizeof(line), list) != NULL) {
+      length = strlen(line);
+      while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')) length--;
+      line[length] = '\0';
+      if (length > 0) add_name(line);
+    }
+    if (list != stdin) fclose(list);
+    return YES;
+  }
+
+/*--------------------------*/
+
+/* Reads all of a file into a buffer that grows as needed. Returns NO */
+/* if the file can't be read.					    */
+
+boolean read_all(FILE *input, char **text, size_t *size, size_t *length)
+  {
+    *length = 0;
+    do {
+      if (*length == *size) {
+	*size = (*size == 0) ? RES_BLOCK_SIZE : 2 * *size;
+	*text = (char *)get_memory(*text, *size);
+      }
+      *length += fread(*text + *length, 1, *size - *length, input);
+    } while (!feof(input) && !ferror(input));
+    return ferror(input) ? NO : YES;
+  }
+
+/*--------------------------*/
+
+/* Each worker takes files from the list until there are none left. */
+/* With a cache, the files are read whole so they can be hashed,    */
+/* and only scanned if they aren't in the cache.		    */
 
-    if (bracket_level == 0  &&	ch == '=') looking_for_semi = YES;
-    if (bracket_level == 0  &&	ch == ';') looking_for_semi = NO;
+int worker(void *unused)
+  {
+    char   *block = (char *)get_memory(NULL, RES_BLOCK_SIZE);
+    char   *text = NULL;
+    size_t  text_size = 0;
+    size_t  length;
+    FILE   *input;
+    size_t  i;
 
-    if (bracket_level >= 1  &&	looking_for_semi == NO) {
-      in_funct = YES;
-      compile_stats(ch);
+    (void)unused;
+    for (;;) {
+#ifdef HAVE_THREADS
+      mtx_lock(&file_lock);
+#endif
+      i = next_file++;
+#ifdef HAVE_THREADS
+      mtx_unlock(&file_lock);
+#endif
+      if (i >= file_count) break;
+      if (files[i].error != NULL) continue;
+      if ((input = fopen(files[i].name, "rb")) == NULL) {
+	files[i].error = "Can't open file";
+	continue;
+      }
+      if (!use_cache) ResScan(&files[i], input, block);
+      else if (!read_all(input, &text, &text_size, &length)) files[i].error = "Error reading file";
+      else {
+	files[i].hash   = CacheHash(text, length);
+	files[i].length = length;
+	files[i].hashed = YES;
+	if (!CacheFind(&files[i])) ResScanText(&files[i], text, length);
+      }
+      fclose(input);
     }
-        
-    if (ch == '{') {
-      bracket_level++;
+    free(text);
+    free(block);
+    return 0;
+  }
+
+/*--------------------------*/
+
+/* Scans all the files on the list and writes the report. Returns the */
+/* exit status.                                                       */
+
+int scan_files(int thread_count, int format, size_t top)
+  {
+    KeyScanner keys;
+    size_t     i;
+    int	       status = 0;
+
+    KeyScanReset(&keys);    /* Builds its tables before the threads start. */
+
+#ifdef HAVE_THREADS
+    thrd_t *threads;
+    int	    started;
+
+    mtx_init(&file_lock, mtx_plain);
+    if (thread_count > 1 && file_count > 1) {
+      if ((size_t)thread_count > file_count) thread_count = (int)file_count;
+      threads = (thrd_t *)get_memory(NULL, thread_count * sizeof(thrd_t));
+      for (started = 0; started < thread_count; started++) {
+	if (thrd_create(&threads[started], worker, NULL) != thrd_success) break;
+      }
+      if (started == 0) worker(NULL);
+      for (i = 0; i < (size_t)started; i++) thrd_join(threads[i], NULL);
+      free(threads);
     }
-    else if (ch == '}') {
-      bracket_level--;
-      if (bracket_level == 0  &&  looking_for_semi == NO) {
-	in_funct = NO;
-	compile_stats(DUMP_STATS);
+    else worker(NULL);
+    mtx_destroy(&file_lock);
+#else
+    (void)thread_count;
+    worker(NULL);
+#endif
+
+    ResWrite(stdout, files, file_count, format, top);
+    if (use_cache) {
+      for (i = 0; i < file_count; i++) CacheAdd(&files[i]);
+      if (!CacheClose()) {
+	fprintf(stderr, "CYCLO: Can't add to the cache\n");
+	status = 1;
       }
     }
-    return;
+    for (i = 0; i < file_count; i++) {
+      if (files[i].error != NULL) {
+	fprintf(stderr, "CYCLO: %s: %s\n", files[i].name, files[i].error);
+	status = 1;
+      }
+      ResFree(&files[i]);
+    }
+    free(files);
+    return status;
   }
 
 /*--------------------------*/
 
-int grab_char(void)
+/* Returns the number of processors, if that can be found. */
+
+int default_threads(void)
   {
-    int ch;
+#if defined(HAVE_DIRENT) && defined(_SC_NPROCESSORS_ONLN)
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
 
-    ch = getc(infile);
-    if (ch == '\n'  &&	in_funct) lines_in_funct++;
-    if (ch != EOF) putchar(ch);
-    return ch;
+    if (count > 0) return (int)count;
+#endif
+    return 4;
   }
 
 /*==================================*/
 /*	     Main Program	    */
 /*==================================*/
 
-main(int argc, char *argv[])
+/* The switches are						*/
+/*								*/
+/*   -e	      Copy one file to the output with the descriptions.	*/
+/*   -g	      Report the functions changed between two git	*/
+/*	      revisions (see DELTA.C).				*/
+/*   -d	      Report the functions changed between two trees.	*/
+/*   -c	      Write the report as CSV (default: JSON).		*/
+/*   -fname   Read the names of files (or directories) from a file. */
+/*   -jn      Use n threads (default: one per processor).	*/
+/*   -tn      List the n worst functions (default: 10).		*/
+/*   -kname   Keep results in a cache file (see CACHE.C).		*/
+
+#define REPORT 0
+#define ECHO   1
+#define GIT    2
+#define TREES  3
+
+int main(int argc, char *argv[])
   {
-    int   inchar;
-    int   exit_code=0;
-
-    fprintf(stderr, "CYCLO  Version 1.0  (%s)\n", __DATE__);
-    fprintf(stderr, "Public Domain software by Peter Chapin\n\n");
-    
-    if (argc != 2) {
-      fprintf(stderr, "Measures the cyclomatic complexity of C programs.\n");
-      fprintf(stderr, "Usage: CYCLO infile.c [>outfile.txt]\n");
+    int	     exit_code=0;
+    int	     thread_count = default_threads();
+    int	     format = RES_JSON;
+    long     top = 10;
+    int	     mode = REPORT;
+    char    *names[2];	       /* The names given with -e, -g, or -d. */
+    int	     name_count = 0;
+    boolean  usage = NO;
+    int	     i;
+
+    for (i = 1; i < argc && !usage; i++) {
+      if (argv[i][0] != '-' || argv[i][1] == '\0') {
+	if (mode == REPORT) add_name(argv[i]);
+	else if (name_count < 2) names[name_count++] = argv[i];
+	else usage = YES;
+      }
+      else if (argv[i][2] != '\0' && strchr("egdc", argv[i][1]) != NULL) usage = YES;
+      else if (argv[i][1] == 'e' && mode == REPORT && file_count == 0) mode = ECHO;
+      else if (argv[i][1] == 'g' && mode == REPORT && file_count == 0) mode = GIT;
+      else if (argv[i][1] == 'd' && mode == REPORT && file_count == 0) mode = TREES;
+      else if (argv[i][1] == 'c') format = RES_CSV;
+      else if (argv[i][1] == 'f' && mode == REPORT) {
+	if (!add_list(argv[i] + 2)) return 2;
+      }
+      else if (argv[i][1] == 'j' && atoi(argv[i] + 2) > 0) thread_count = atoi(argv[i] + 2);
+      else if (argv[i][1] == 'k' && argv[i][2] != '\0' && mode == REPORT && !use_cache) {
+	if (!CacheOpen(argv[i] + 2)) {
+	  fprintf(stderr, "CYCLO: %s is not a cache file this version can use\n", argv[i] + 2);
+	  return 2;
+	}
+	use_cache = YES;
+      }
+      else if (argv[i][1] == 't' && argv[i][2] != '\0' && atol(argv[i] + 2) >= 0) top = atol(argv[i] + 2);
+      else usage = YES;
+    }
+    if (mode == REPORT && file_count == 0) usage = YES;
+    if (mode == ECHO && name_count != 1) usage = YES;
+    if ((mode == GIT || mode == TREES) && name_count != 2) usage = YES;
+
+    if (usage) {
+      fprintf(stderr, "CYCLO  Version 1.1  (%s)\n", __DATE__);
+      fprintf(stderr, "Public Domain software by Peter Chapin\n\n");
+      fprintf(stderr, "Measures the cyclomatic complexity of C/C++ programs.\n");
+      fprintf(stderr, "Usage: CYCLO -e infile.c|infile.cpp [>outfile.txt]\n");
+      fprintf(stderr, "       CYCLO [-c] [-fname] [-jn] [-tn] [-kcache] file_or_directory ... [>report]\n");
+      fprintf(stderr, "       CYCLO -g [-c] old_revision new_revision [>report]\n");
+      fprintf(stderr, "       CYCLO -d [-c] old_directory new_directory [>report]\n");
       exit_code = 2;
     }
-    else if ((infile=fopen(argv[1], "r")) == NULL) {
-      fprintf(stderr, "ERROR: Can't open %s for input.\n", argv[1]);
+    else if (mode == REPORT) {
+      exit_code = scan_files(thread_count, format, (size_t)top);
+    }
+    else if (mode != ECHO) {
+      exit_code = DeltaReport(names[0], names[1], (mode == GIT) ? DELTA_GIT : DELTA_TREES, format);
+    }
+    else if ((infile=fopen(names[0], "r")) == NULL) {
+      fprintf(stderr, "ERROR: Can't open %s for input.\n", names[0]);
       exit_code = 1;
     }
     else {
-      CmtScanInit(grab_char);
-      while ((inchar=CmtScanGetChar()) != EOF) {
-	if (!DoubleQuote && !SingleQuote) find_funct(inchar);
-      }
+      exit_code = scan_file();
+      fclose(infile);
     }
     return exit_code;
   }
@@ -0,0 +1,674 @@
+/*****************************************************************************
+FILE          : delta.c
+LAST REVISION : October 2026
+SUBJECT       : Measuring the functions changed between two versions.
+PROGRAMMER    : Peter Chapin
+
+This module reports the cyclomatic numbers, before and after, of the
+functions that were changed between two versions of a program. The work
+done depends on the size of the change and not on the size of the
+program: only the files that changed are scanned, and only the functions
+that overlap the changed lines are reported.
+
+The versions can be two revisions in the git repository that holds the
+current directory, or two directory trees. In both cases git finds the
+changes. The module reads the output of
+
+     git diff -U0 old new              (revisions)
+     git diff --no-index -U0 old new   (trees)
+
+to learn which source files changed and which lines of them changed. It
+then scans the old and new versions of each of those files; for revisions
+the text comes from "git show rev:path". Any git at all will do, and the
+directories don't have to be in a repository.
+
+A function is changed if a changed line is inside it, in either version.
+Lines that were only inserted count as changed if they went between two
+lines of the function. The old and new versions of a function are paired
+by name (the first f in the old version with the first f in the new
+version, and so on, so overloads pair up in order). A function with no
+partner is "added" or "removed".
+
+The report is in the same forms as the one in RESULTS.C.
+
+1.   JSON. The object names the two versions and has "files", an array
+     with an object for each changed source file: its "old_name" and
+     "new_name" (null if the file didn't exist in that version) and its
+     "functions". Each function has its "name", its "status" (changed,
+     added, or removed), its "old" and "new" numbers (first_line,
+     last_line, cyclomatic, cases, depth; null if it didn't exist), and
+     the "delta" of its cyclomatic number. The "totals" member gives the
+     number of files and functions and the sums of the numbers.
+
+2.   CSV. One row for each function with the columns
+
+          file,function,status,old_first_line,old_last_line,
+          old_cyclomatic,old_cases,old_depth,new_first_line,new_last_line,
+          new_cyclomatic,new_cases,new_depth,delta
+
+     (on one line), followed by a row with "total" in the status column.
+
+     Please send comments and bug reports to
+
+     Peter Chapin
+     chapinp@proton.me
+
+*****************************************************************************/
+
+#include "local.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "standard.h"
+#include "scanners.h"
+#include "fnscan.h"
+#include "results.h"
+#include "delta.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/wait.h>
+#define HAVE_POPEN
+#endif
+
+/*=================================*/
+/*           Global Data           */
+/*=================================*/
+
+/* Lines changed in one version of a file. A count of zero means lines */
+/* were inserted after the first line (in the other version).          */
+typedef struct {
+  long    first;
+  long    count;
+} Range;
+
+/* A changed source file. */
+typedef struct {
+  char   *name[2];            /* Old and new names. NULL if not there.    */
+  Range  *ranges[2];          /* Old and new changed lines.               */
+  size_t  range_count[2];
+  size_t  range_size[2];
+} Change;
+
+#define OLD 0
+#define NEW 1
+
+PRIVATE Change *changes = NULL;
+PRIVATE size_t  change_count = 0;
+PRIVATE size_t  change_size = 0;
+
+/* Totals for the report. */
+PRIVATE long    total_functions;
+PRIVATE long    total_old;
+PRIVATE long    total_new;
+PRIVATE long    failed;
+
+/*==========================================*/
+/*           Function Definitions           */
+/*==========================================*/
+
+/*------------------------------------------------------------------------*/
+/* void *get_memory(void *old, size_t size);                              */
+/*                                                                        */
+/*      This function is realloc() that gives up on the program if it     */
+/*      fails.                                                            */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+void *get_memory(void *old, size_t size)
+  {
+    void *p = realloc(old, size);
+
+    if (p == NULL) {
+      fprintf(stderr, "CYCLO: Out of memory\n");
+      exit(2);
+    }
+    return p;
+  }
+
+PRIVATE
+char *copy_of(const char *text)
+  {
+    return strcpy((char *)get_memory(NULL, strlen(text) + 1), text);
+  }
+
+/*------------------------------------------------------------------------*/
+/* void add_quoted(char **command, size_t *length, const char *text);     */
+/*                                                                        */
+/*      This function adds text to a shell command, quoted so the shell   */
+/*      takes it as it is.                                                */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+void add_quoted(char **command, size_t *length, const char *text)
+  {
+    char *p;
+
+    *command = (char *)get_memory(*command, *length + 4 * strlen(text) + 4);
+    p = *command + *length;
+    *p++ = ' ';
+    *p++ = '\'';
+    for ( ; *text != '\0'; text++) {
+      if (*text == '\'') {
+        memcpy(p, "'\\''", 4);
+        p += 4;
+      }
+      else *p++ = *text;
+    }
+    *p++ = '\'';
+    *p = '\0';
+    *length = p - *command;
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* boolean read_line(FILE *input, char **line, size_t *size);             */
+/*                                                                        */
+/*      This function reads a line of any length into a buffer that grows */
+/*      as needed. The '\n' is removed. It returns NO at the end.         */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+boolean read_line(FILE *input, char **line, size_t *size)
+  {
+    size_t length = 0;
+
+    if (*size == 0) {
+      *size = 256;
+      *line = (char *)get_memory(NULL, *size);
+    }
+    while (fgets(*line + length, (int)(*size - length), input) != NULL) {
+      length += strlen(*line + length);
+      if (length > 0 && (*line)[length - 1] == '\n') {
+        (*line)[length - 1] = '\0';
+        return YES;
+      }
+      if (length + 1 == *size) {
+        *size *= 2;
+        *line = (char *)get_memory(*line, *size);
+      }
+    }
+    return (length > 0) ? YES : NO;
+  }
+
+/*------------------------------------------------------------------------*/
+/* char *file_name(char *text, const char *root);                         */
+/*                                                                        */
+/*      This function takes the name from a "---" or "+++" line of a      */
+/*      diff. It returns a copy of the name or NULL for /dev/null. Names  */
+/*      that git put in quotes are unquoted. For trees the root given on  */
+/*      the command line decides if the name is absolute (git drops the   */
+/*      leading '/').                                                     */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+char *file_name(char *text, const char *root)
+  {
+    char  *in = text;
+    char  *out = text;
+    char  *name;
+    size_t length;
+    int    value;
+    int    i;
+
+    if (strcmp(text, "/dev/null") == 0) return NULL;
+
+    /* Git adds a tab after names with spaces in them. */
+    length = strlen(text);
+    if (length > 0 && text[length - 1] == '\t') text[length - 1] = '\0';
+
+    if (*in == '"') {
+      for (in++; *in != '\0' && *in != '"'; in++) {
+        if (*in != '\\' || in[1] == '\0') {
+          *out++ = *in;
+          continue;
+        }
+        switch (*++in) {
+          case 'a': *out++ = '\a'; break;
+          case 'b': *out++ = '\b'; break;
+          case 'f': *out++ = '\f'; break;
+          case 'n': *out++ = '\n'; break;
+          case 'r': *out++ = '\r'; break;
+          case 't': *out++ = '\t'; break;
+          case 'v': *out++ = '\v'; break;
+          default:
+            if (*in >= '0' && *in <= '7') {
+              for (value = 0, i = 0; i < 3 && *in >= '0' && *in <= '7'; i++, in++)
+                value = 8 * value + (*in - '0');
+              in--;
+              *out++ = (char)value;
+            }
+            else *out++ = *in;
+            break;
+        }
+      }
+      *out = '\0';
+    }
+
+    /* Drop the a/ or b/ in front of the name. */
+    if (text[0] != '\0' && text[1] == '/') text += 2;
+
+    if (root != NULL && root[0] == '/' && text[0] != '/') {
+      name = (char *)get_memory(NULL, strlen(text) + 2);
+      sprintf(name, "/%s", text);
+      return name;
+    }
+    return copy_of(text);
+  }
+
+/*------------------------------------------------------------------------*/
+/* void add_range(Change *change, int side, long first, long count);      */
+/*                                                                        */
+/*      This function records lines changed in one version of a file.     */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+void add_range(Change *change, int side, long first, long count)
+  {
+    if (change->range_count[side] == change->range_size[side]) {
+      change->range_size[side] = (change->range_size[side] == 0) ? 8 : 2 * change->range_size[side];
+      change->ranges[side] = (Range *)get_memory(
+        change->ranges[side], change->range_size[side] * sizeof(Range));
+    }
+    change->ranges[side][change->range_count[side]].first = first;
+    change->ranges[side][change->range_count[side]].count = count;
+    change->range_count[side]++;
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void read_diff(FILE *diff, const char *old_root, const char *new_root);*/
+/*                                                                        */
+/*      This function reads the output of git diff -U0 and makes a Change */
+/*      for each source file in it. The roots are NULL for revisions.     */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+void read_diff(FILE *diff, const char *old_root, const char *new_root)
+  {
+    char   *line = NULL;
+    size_t  size = 0;
+    Change *change = NULL;
+    char   *rest;
+    long    first[2];
+    long    count[2];
+    long    left[2] = { 0, 0 };   /* Lines of the hunk still to come. */
+    int     side;
+
+    while (read_line(diff, &line, &size)) {
+
+      /* Inside a hunk only the lines are counted. */
+      if (left[OLD] > 0 || left[NEW] > 0) {
+        if (line[0] == '-' && left[OLD] > 0) left[OLD]--;
+        else if (line[0] == '+' && left[NEW] > 0) left[NEW]--;
+        else if (line[0] == ' ') { left[OLD]--; left[NEW]--; }
+        continue;
+      }
+
+      if (strncmp(line, "diff ", 5) == 0) {
+        if (change_count == change_size) {
+          change_size = (change_size == 0) ? 16 : 2 * change_size;
+          changes = (Change *)get_memory(changes, change_size * sizeof(Change));
+        }
+        change = &changes[change_count++];
+        memset(change, 0, sizeof(Change));
+      }
+      else if (change == NULL) continue;
+      else if (strncmp(line, "--- ", 4) == 0) change->name[OLD] = file_name(line + 4, old_root);
+      else if (strncmp(line, "+++ ", 4) == 0) change->name[NEW] = file_name(line + 4, new_root);
+      else if (strncmp(line, "@@ -", 4) == 0) {
+        rest = line + 3;
+        for (side = OLD; side <= NEW; side++) {
+          first[side] = strtol(rest + 1, &rest, 10);
+          count[side] = (*rest == ',') ? strtol(rest + 1, &rest, 10) : 1;
+          while (*rest == ' ') rest++;
+          add_range(change, side, first[side], count[side]);
+          left[side] = count[side];
+        }
+      }
+    }
+    free(line);
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* boolean touched(const Change *change, int side, const FnResult *f);    */
+/*                                                                        */
+/*      This function returns YES if a function in one version of a file  */
+/*      has changed lines in it.                                          */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+boolean touched(const Change *change, int side, const FnResult *function)
+  {
+    const Range *range;
+    size_t       i;
+
+    for (i = 0; i < change->range_count[side]; i++) {
+      range = &change->ranges[side][i];
+      if (range->count == 0) {
+        if (range->first >= function->first_line && range->first < function->last_line) return YES;
+      }
+      else if (range->first <= function->last_line &&
+               range->first + range->count - 1 >= function->first_line) return YES;
+    }
+    return NO;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void scan_version(FileResult *result, const char *name,                */
+/*   const char *revision, char *block);                                  */
+/*                                                                        */
+/*      This function scans one version of a file. The revision is NULL   */
+/*      if the file is in a tree.                                         */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+void scan_version(FileResult *result, const char *name, const char *revision, char *block)
+  {
+    FILE  *input;
+    char  *command = NULL;
+    char  *object;
+    size_t length = 0;
+
+    ResInit(result, name);
+    if (revision == NULL) {
+      if ((input = fopen(name, "rb")) == NULL) {
+        result->error = "Can't open file";
+        return;
+      }
+      ResScan(result, input, block);
+      fclose(input);
+      return;
+    }
+
+    object = (char *)get_memory(NULL, strlen(revision) + strlen(name) + 2);
+    sprintf(object, "%s:%s", revision, name);
+    command = copy_of("git show");
+    length = strlen(command);
+    add_quoted(&command, &length, object);
+    free(object);
+
+    if ((input = popen(command, "r")) == NULL) result->error = "Can't run git show";
+    else {
+      ResScan(result, input, block);
+      if (pclose(input) != 0 && result->error == NULL) result->error = "git show failed";
+    }
+    free(command);
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void put_numbers(FILE *out, int format, const FnResult *function);     */
+/*                                                                        */
+/*      This function writes the numbers for one version of a function.  */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+void put_numbers(FILE *out, int format, const FnResult *function)
+  {
+    if (format == RES_CSV) {
+      if (function == NULL) fprintf(out, ",,,,,");
+      else fprintf(out, "%ld,%ld,%ld,%ld,%ld,",
+        function->first_line, function->last_line, function->cyclomatic,
+        function->cases, function->depth);
+    }
+    else {
+      if (function == NULL) fprintf(out, "null");
+      else fprintf(out,
+        "{\"first_line\": %ld, \"last_line\": %ld, \"cyclomatic\": %ld,"
+        " \"cases\": %ld, \"depth\": %ld}",
+        function->first_line, function->last_line, function->cyclomatic,
+        function->cases, function->depth);
+    }
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void put_function(FILE *out, int format, boolean first,                */
+/*   const char *file, const FnResult *old, const FnResult *new);         */
+/*                                                                        */
+/*      This function writes the line for a changed function. The first   */
+/*      flag is YES for the first function of a file.                     */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+void put_function(
+  FILE *out, int format, boolean first,
+  const char *file, const FnResult *old, const FnResult *new)
+  {
+    const char *name   = (new != NULL) ? new->name : old->name;
+    const char *status = (old == NULL) ? "added" : (new == NULL) ? "removed" : "changed";
+    long        before = (old != NULL) ? old->cyclomatic : 0;
+    long        after  = (new != NULL) ? new->cyclomatic : 0;
+
+    if (format == RES_CSV) {
+      ResPutCsv(out, file);
+      putc(',', out);
+      ResPutCsv(out, name);
+      fprintf(out, ",%s,", status);
+      put_numbers(out, format, old);
+      put_numbers(out, format, new);
+      fprintf(out, "%ld\n", after - before);
+    }
+    else {
+      fprintf(out, "%s\n      {\"name\": ", first ? "" : ",");
+      ResPutJson(out, name);
+      fprintf(out, ", \"status\": \"%s\", \"old\": ", status);
+      put_numbers(out, format, old);
+      fprintf(out, ", \"new\": ");
+      put_numbers(out, format, new);
+      fprintf(out, ", \"delta\": %ld}", after - before);
+    }
+    total_functions++;
+    total_old += before;
+    total_new += after;
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void report_change(FILE *out, int format, const Change *change,        */
+/*   const char *old_revision, const char *new_revision, char *block);    */
+/*                                                                        */
+/*      This function scans both versions of a changed file, pairs up     */
+/*      their functions, and reports the ones that changed.               */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+void report_change(
+  FILE *out, int format, const Change *change,
+  const char *old_revision, const char *new_revision, char *block)
+  {
+    FileResult  version[2];
+    const char *file = (change->name[NEW] != NULL) ? change->name[NEW] : change->name[OLD];
+    const char *error = NULL;
+    size_t     *partner;          /* For each new function, the old one. */
+    boolean    *paired;           /* For each old function.              */
+    boolean     first = YES;
+    size_t      i, j;
+    int         side;
+
+    /* Scan the versions that exist. */
+    for (side = OLD; side <= NEW; side++) {
+      if (change->name[side] != NULL) {
+        scan_version(&version[side], change->name[side],
+          (side == OLD) ? old_revision : new_revision, block);
+        if (version[side].error != NULL) error = version[side].error;
+      }
+      else ResInit(&version[side], "");
+    }
+
+    /* Pair the functions by name, in order. */
+    partner = (size_t *)get_memory(NULL, (version[NEW].count + 1) * sizeof(size_t));
+    paired  = (boolean *)get_memory(NULL, (version[OLD].count + 1) * sizeof(boolean));
+    for (i = 0; i < version[OLD].count; i++) paired[i] = NO;
+    for (j = 0; j < version[NEW].count; j++) {
+      partner[j] = version[OLD].count;
+      for (i = 0; i < version[OLD].count; i++) {
+        if (!paired[i] && strcmp(version[OLD].functions[i].name, version[NEW].functions[j].name) == 0) {
+          partner[j] = i;
+          paired[i] = YES;
+          break;
+        }
+      }
+    }
+
+    if (format == RES_JSON) {
+      fprintf(out, "%s\n    {\"old_name\": ", (change == changes) ? "" : ",");
+      if (change->name[OLD] == NULL) fprintf(out, "null");
+      else ResPutJson(out, change->name[OLD]);
+      fprintf(out, ", \"new_name\": ");
+      if (change->name[NEW] == NULL) fprintf(out, "null");
+      else ResPutJson(out, change->name[NEW]);
+      if (error != NULL) {
+        fprintf(out, ", \"error\": ");
+        ResPutJson(out, error);
+      }
+      fprintf(out, ", \"functions\": [");
+    }
+
+    /* The new functions, in order, then the ones that were removed. */
+    for (j = 0; j < version[NEW].count; j++) {
+      i = partner[j];
+      if (i < version[OLD].count) {
+        if (touched(change, NEW, &version[NEW].functions[j]) ||
+            touched(change, OLD, &version[OLD].functions[i])) {
+          put_function(out, format, first, file, &version[OLD].functions[i], &version[NEW].functions[j]);
+          first = NO;
+        }
+      }
+      else if (touched(change, NEW, &version[NEW].functions[j])) {
+        put_function(out, format, first, file, NULL, &version[NEW].functions[j]);
+        first = NO;
+      }
+    }
+    for (i = 0; i < version[OLD].count; i++) {
+      if (!paired[i] && touched(change, OLD, &version[OLD].functions[i])) {
+        put_function(out, format, first, file, &version[OLD].functions[i], NULL);
+        first = NO;
+      }
+    }
+    if (format == RES_JSON) fprintf(out, "%s]}", first ? "" : "\n     ");
+
+    if (error != NULL) {
+      fprintf(stderr, "CYCLO: %s: %s\n", file, error);
+      failed++;
+    }
+    free(partner);
+    free(paired);
+    ResFree(&version[OLD]);
+    ResFree(&version[NEW]);
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* int DeltaReport(const char *old, const char *new, int kind,            */
+/*   int format);                                                         */
+/*                                                                        */
+/*      This function writes the report of the functions that changed     */
+/*      between two versions to the standard output. The kind says what   */
+/*      the versions are (DELTA_GIT or DELTA_TREES) and the format is     */
+/*      RES_JSON or RES_CSV. It returns the exit status for the program.  */
+/*------------------------------------------------------------------------*/
+
+PUBLIC
+int DeltaReport(const char *old, const char *new, int kind, int format)
+  {
+#ifdef HAVE_POPEN
+    FILE  *diff;
+    char  *command;
+    char  *block;
+    size_t length;
+    size_t i;
+    int    status;
+
+    command = copy_of(
+      "git -c core.quotePath=false diff --no-color --no-ext-diff --no-textconv"
+      " --src-prefix=a/ --dst-prefix=b/ -U0");
+    length = strlen(command);
+    if (kind == DELTA_TREES) {
+      command = (char *)get_memory(command, length + 16);
+      strcpy(command + length, " --no-index --");
+      length += strlen(" --no-index --");
+    }
+    add_quoted(&command, &length, old);
+    add_quoted(&command, &length, new);
+    if (kind == DELTA_GIT) {
+      command = (char *)get_memory(command, length + 4);
+      strcpy(command + length, " --");
+    }
+
+    if ((diff = popen(command, "r")) == NULL) {
+      fprintf(stderr, "CYCLO: Can't run git\n");
+      free(command);
+      return 2;
+    }
+    read_diff(diff, (kind == DELTA_TREES) ? old : NULL, (kind == DELTA_TREES) ? new : NULL);
+    status = pclose(diff);
+    free(command);
+
+    /* git diff --no-index says 1 when there are differences. */
+    if (status == -1 || !WIFEXITED(status) ||
+        WEXITSTATUS(status) > ((kind == DELTA_TREES) ? 1 : 0)) {
+      fprintf(stderr, "CYCLO: git diff failed\n");
+      return 2;
+    }
+
+    total_functions = total_old = total_new = failed = 0;
+    block = (char *)get_memory(NULL, RES_BLOCK_SIZE);
+    if (format == RES_CSV) {
+      printf("file,function,status,old_first_line,old_last_line,old_cyclomatic,old_cases,"
+             "old_depth,new_first_line,new_last_line,new_cyclomatic,new_cases,new_depth,delta\n");
+    }
+    else {
+      printf("{\n  \"old\": ");
+      ResPutJson(stdout, old);
+      printf(",\n  \"new\": ");
+      ResPutJson(stdout, new);
+      printf(",\n  \"files\": [");
+    }
+
+    /* Only the source files are scanned. The others are dropped. */
+    length = 0;
+    for (i = 0; i < change_count; i++) {
+      if ((changes[i].name[OLD] != NULL && ResIsSource(changes[i].name[OLD])) ||
+          (changes[i].name[NEW] != NULL && ResIsSource(changes[i].name[NEW]))) {
+        changes[length++] = changes[i];
+      }
+      else {
+        free(changes[i].name[OLD]);  free(changes[i].name[NEW]);
+        free(changes[i].ranges[OLD]); free(changes[i].ranges[NEW]);
+      }
+    }
+    change_count = length;
+
+    for (i = 0; i < change_count; i++) {
+      report_change(stdout, format, &changes[i],
+        (kind == DELTA_GIT) ? old : NULL, (kind == DELTA_GIT) ? new : NULL, block);
+    }
+
+    if (format == RES_CSV) {
+      printf(",,total,,,%ld,,,,,%ld,,,%ld\n", total_old, total_new, total_new - total_old);
+    }
+    else {
+      printf("%s],\n", (change_count == 0) ? "" : "\n  ");
+      printf("  \"totals\": {\"files\": %lu, \"failed\": %ld, \"functions\": %ld,"
+             " \"old_cyclomatic\": %ld, \"new_cyclomatic\": %ld, \"delta\": %ld}\n}\n",
+             (unsigned long)change_count, failed, total_functions,
+             total_old, total_new, total_new - total_old);
+    }
+
+    for (i = 0; i < change_count; i++) {
+      free(changes[i].name[OLD]);  free(changes[i].name[NEW]);
+      free(changes[i].ranges[OLD]); free(changes[i].ranges[NEW]);
+    }
+    free(changes);
+    changes = NULL;
+    change_count = change_size = 0;
+    free(block);
+    return (failed != 0) ? 1 : 0;
+#else
+    (void)old; (void)new; (void)kind; (void)format;
+    fprintf(stderr, "CYCLO: Comparing versions needs popen()\n");
+    return 2;
+#endif
+  }
@@ -0,0 +1,30 @@
+/*****************************************************************************
+FILE     : delta.h
+CONTENTS : Measuring the functions changed between two versions.
+PROGRAMMER    : Peter Chapin
+
+This file contains the interface to the module that compares two versions
+of a program (two git revisions or two directory trees) and reports the
+cyclomatic numbers of the functions that changed, before and after.
+
+See DELTA.C for more information.
+
+*****************************************************************************/
+
+#ifndef DELTA_H
+#define DELTA_H
+
+#define DELTA_GIT   0         /* The versions are git revisions.          */
+#define DELTA_TREES 1         /* The versions are directories.            */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern int DeltaReport(const char *, const char *, int, int);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
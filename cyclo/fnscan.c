@@ -0,0 +1,846 @@
+/*****************************************************************************
+FILE          : fnscan.c
+LAST REVISION : October 2026
+SUBJECT       : Finding the functions in C/C++ source code.
+PROGRAMMER    : Peter Chapin
+
+This module finds the function bodies in C/C++ source text and measures
+each one. It uses the comment scanner to find the code between the
+comments and literals and a light tokenizer to follow the declarations in
+the code. It doesn't parse C++; it only knows enough to tell a function
+body from the other things that are written between braces.
+
+Outside of function bodies the text is read a token at a time. A stack
+holds the namespaces and classes that enclose the current point, and the
+declaration being read is described by a few flags and names:
+
+1.   The last name. Names joined by :: are kept together, and template
+     arguments are passed over, so "A<T>::f" becomes "A::f". The special
+     names "operator+", "operator()", "~A", and so on are understood.
+
+2.   The candidate. When a '(' follows a name at the outer level of a
+     declaration, that name is the function's name if the declaration
+     turns out to be a function. A later '(' after another name replaces
+     it, so macros in front of a declaration don't matter, but names such
+     as noexcept, throw, and decltype are not names for this purpose.
+
+3.   What has been seen at the outer level: namespace, class (or struct
+     or union), enum, extern, '=', a constructor's ':' initializer list,
+     and the parameter list of the candidate.
+
+When a '{' is found the flags decide what it opens. A namespace or class
+is pushed on the stack with its name, so the names of the functions in it
+can be qualified. A '{' after a parameter list (and perhaps const,
+override, a trailing return type, or an initializer list) starts a
+function body. A lambda given as the initial value of a variable is a
+function named after the variable. Anything else (an initializer, an enum,
+the body of something unknown) is passed over. A ';' or the end of a
+scope ends the declaration.
+
+Inside a function body only the braces matter. The text between them is
+given to the keyword scanner in whole runs, so most of a file is not
+looked at a character at a time. Lambdas and local classes in a body are
+part of the function. When the body ends its description is sent to the
+caller: the qualified name, the lines it covers (from its name to the
+closing brace), its cyclomatic number, the number of case labels, and the
+deepest nesting of braces in it.
+
+Preprocessor lines are passed over in all places. The module doesn't
+evaluate #if, so braces that are unbalanced between the arms of an #if
+will confuse it, as they do most tools of this kind.
+
+The module works like this.
+
+1.   FnScanReset() prepares an FnScanner for a new file and records the
+     function to which descriptions are to be sent. FnScanFree() releases
+     the memory it uses when it is no longer needed.
+
+2.   FnScanBlock() is given a block of the file. Like CmtScanBlock() it
+     might not consume a '/' at the very end of a block; it returns the
+     number of characters it used and the rest must be presented again
+     at the start of the next block. The last block must be passed with
+     the final parameter YES.
+
+3.   Each description gives the offset of the closing '}' in the current
+     block. That allows a caller that copies the input to its output to
+     put the description right after the function.
+
+     Please send comments and bug reports to
+
+     Peter Chapin
+     chapinp@proton.me
+
+*****************************************************************************/
+
+#include "local.h"
+#include <stdlib.h>
+#include <string.h>
+#include "standard.h"
+#include "scanners.h"
+#include "keyscan.h"
+#include "fnscan.h"
+
+/*=================================*/
+/*           Global Data           */
+/*=================================*/
+
+/* Kinds of scopes. */
+#define NAMESPACE   0
+#define CLASS       1
+#define LINKAGE     2         /* extern "C" { ... }                       */
+
+/* Kinds of tokens (for the last member). */
+#define T_NONE      0         /* Nothing yet in this declaration.         */
+#define T_NAME      1
+#define T_SCOPE     2         /* :: or ~, which continue a name.          */
+#define T_ANGLE     3         /* The '>' at the end of template arguments. */
+#define T_TEMPLATE  4
+#define T_ACCESS    5         /* public, private, or protected.           */
+#define T_KEYWORD   6         /* Another keyword that isn't a name.       */
+#define T_OTHER     7
+
+/* What has been seen in the declaration (for the flags member). */
+#define FN_NAMESPACE   0x0001
+#define FN_CLASS       0x0002
+#define FN_ENUM        0x0004
+#define FN_EXTERN      0x0008
+#define FN_EQUALS      0x0010
+#define FN_LAMBDA      0x0020   /* A '[' after the '='.                   */
+#define FN_PARAMS_OPEN 0x0040   /* In the candidate's parameters.         */
+#define FN_PARAMS      0x0080   /* After the candidate's parameters.      */
+#define FN_NAME_AFTER  0x0100   /* A name after the parameters.           */
+#define FN_INIT_LIST   0x0200   /* In a constructor's initializer list.   */
+#define FN_CLASS_NAMED 0x0400   /* The class's name is known.             */
+#define FN_SKIP_ENDS   0x0800   /* The block passed over ends it.         */
+
+/* Where we are in a preprocessor line (for the directive member). */
+#define NO_DIRECTIVE   0
+#define IN_DIRECTIVE   1
+#define AFTER_ESCAPE   2        /* After a '\' in a directive.            */
+
+/* Keywords that are followed by '(' but are not names of functions, and */
+/* others that must not be taken as names.                               */
+PRIVATE const char *not_names[] = {
+  "__attribute__", "__declspec", "alignas", "alignof", "catch", "const",
+  "decltype", "delete", "do", "else", "final", "for", "if", "mutable",
+  "new", "noexcept", "override", "requires", "return", "sizeof",
+  "static_assert", "switch", "throw", "try", "volatile", "while", NULL
+  };
+
+/*==========================================*/
+/*           Function Definitions           */
+/*==========================================*/
+
+/*------------------------------------------------------------------------*/
+/* void append(FnScanner *scanner, FnText *text, const char *p,          */
+/*   size_t n);                                                           */
+/*                                                                        */
+/*      This function adds n characters to a string. If there is no      */
+/*      memory the string is left as it is.                               */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+void append(FnScanner *scanner, FnText *text, const char *p, size_t n)
+  {
+    char  *bigger;
+    size_t size;
+
+    if (text->length + n + 1 > text->size) {
+      size = (text->size == 0) ? 64 : 2 * text->size;
+      while (size < text->length + n + 1) size *= 2;
+      if ((bigger = (char *)realloc(text->text, size)) == NULL) {
+        scanner->out_of_memory = YES;
+        return;
+      }
+      text->text = bigger;
+      text->size = size;
+    }
+    if (n != 0) memcpy(text->text + text->length, p, n);
+    text->length += n;
+    text->text[text->length] = '\0';
+    return;
+  }
+
+PRIVATE
+void set_text(FnScanner *scanner, FnText *text, const char *p, size_t n)
+  {
+    text->length = 0;
+    if (text->text != NULL) text->text[0] = '\0';
+    append(scanner, text, p, n);
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void reset_declaration(FnScanner *scanner);                            */
+/*                                                                        */
+/*      This function forgets the declaration being read.                 */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+void reset_declaration(FnScanner *scanner)
+  {
+    scanner->last           = T_NONE;
+    scanner->name.length    = 0;
+    scanner->name_open      = NO;
+    scanner->candidate.length  = 0;
+    scanner->class_name.length = 0;
+    scanner->flags          = 0;
+    scanner->paren          = 0;
+    scanner->angle          = 0;
+    scanner->operator_state = 0;
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void FnScanReset(FnScanner *scanner, FnReport report, void *context);  */
+/*                                                                        */
+/*      This function prepares a scanner for a new input file. If the     */
+/*      scanner was used before, FnScanFree() must be called first.       */
+/*------------------------------------------------------------------------*/
+
+PUBLIC
+void FnScanReset(FnScanner *scanner, FnReport report, void *context)
+  {
+    memset(scanner, 0, sizeof(FnScanner));
+    CmtScanReset(&scanner->scanner);
+    KeyScanReset(&scanner->keys);
+    scanner->line       = 1;
+    scanner->line_start = YES;
+    scanner->directive  = NO_DIRECTIVE;
+    scanner->in_body    = NO;
+    scanner->report     = report;
+    scanner->context    = context;
+    scanner->out_of_memory = NO;
+    reset_declaration(scanner);
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void FnScanFree(FnScanner *scanner);                                   */
+/*                                                                        */
+/*      This function releases the memory used by a scanner.              */
+/*------------------------------------------------------------------------*/
+
+PUBLIC
+void FnScanFree(FnScanner *scanner)
+  {
+    free(scanner->scopes);
+    free(scanner->prefix.text);
+    free(scanner->token.text);
+    free(scanner->name.text);
+    free(scanner->candidate.text);
+    free(scanner->class_name.text);
+    scanner->scopes = NULL;
+    scanner->scope_count = scanner->scope_size = 0;
+    memset(&scanner->prefix, 0, sizeof(FnText));
+    memset(&scanner->token, 0, sizeof(FnText));
+    memset(&scanner->name, 0, sizeof(FnText));
+    memset(&scanner->candidate, 0, sizeof(FnText));
+    memset(&scanner->class_name, 0, sizeof(FnText));
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void push_scope(FnScanner *scanner, int kind, const FnText *name);     */
+/*                                                                        */
+/*      This function enters a namespace, class, or extern "C" block. The */
+/*      name (which may be empty) is added to the prefix.                 */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+void push_scope(FnScanner *scanner, int kind, const FnText *name)
+  {
+    FnScope *scopes;
+    size_t   size;
+
+    if (scanner->scope_count == scanner->scope_size) {
+      size = (scanner->scope_size == 0) ? 16 : 2 * scanner->scope_size;
+      if ((scopes = (FnScope *)realloc(scanner->scopes, size * sizeof(FnScope))) == NULL) {
+        scanner->out_of_memory = YES;
+        return;
+      }
+      scanner->scopes = scopes;
+      scanner->scope_size = size;
+    }
+    scanner->scopes[scanner->scope_count].kind = kind;
+    scanner->scopes[scanner->scope_count].prefix_length = scanner->prefix.length;
+    scanner->scope_count++;
+    if (name != NULL && name->length != 0) {
+      append(scanner, &scanner->prefix, name->text, name->length);
+      append(scanner, &scanner->prefix, "::", 2);
+    }
+    return;
+  }
+
+PRIVATE
+void pop_scope(FnScanner *scanner)
+  {
+    if (scanner->scope_count == 0) return;
+    scanner->scope_count--;
+    scanner->prefix.length = scanner->scopes[scanner->scope_count].prefix_length;
+    if (scanner->prefix.text != NULL) scanner->prefix.text[scanner->prefix.length] = '\0';
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void start_body(FnScanner *scanner);                                   */
+/*                                                                        */
+/*      This function starts a function body. The name member is used to */
+/*      hold the function's qualified name until the body ends.           */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+void start_body(FnScanner *scanner)
+  {
+    set_text(scanner, &scanner->name, scanner->prefix.text, scanner->prefix.length);
+    append(scanner, &scanner->name, scanner->candidate.text, scanner->candidate.length);
+    scanner->body_line  = scanner->candidate_line;
+    scanner->in_body    = YES;
+    scanner->body_depth = 0;
+    scanner->max_depth  = 0;
+    KeyScanBreak(&scanner->keys);
+    memset(scanner->keys.counts, 0, sizeof(scanner->keys.counts));
+    return;
+  }
+
+PRIVATE
+void end_body(FnScanner *scanner, size_t offset)
+  {
+    FnInfo info;
+
+    info.name       = (scanner->name.text != NULL) ? scanner->name.text : "";
+    info.first_line = scanner->body_line;
+    info.last_line  = scanner->line;
+    info.cyclomatic = 1 + KeyScanDecisions(&scanner->keys);
+    info.cases      = scanner->keys.counts[KEY_CASE];
+    info.depth      = scanner->max_depth;
+    info.offset     = offset;
+    scanner->in_body = NO;
+    if (scanner->report != NULL) scanner->report(scanner->context, &info);
+    reset_declaration(scanner);
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void open_brace(FnScanner *scanner);                                   */
+/*                                                                        */
+/*      This function decides what a '{' in a declaration opens (see the  */
+/*      top of this file).                                                */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+void open_brace(FnScanner *scanner)
+  {
+    int flags = scanner->flags;
+
+    if (scanner->paren > 0 ||
+        ((flags & FN_INIT_LIST) && (scanner->last == T_NAME || scanner->last == T_ANGLE))) {
+      /* Something like f({1, 2}) or a member initialized as x{1}. */
+      scanner->skip_depth = 1;
+      return;
+    }
+    if (flags & FN_NAMESPACE) {
+      push_scope(scanner, NAMESPACE, &scanner->name);
+      reset_declaration(scanner);
+    }
+    else if (flags & FN_ENUM) {
+      scanner->skip_depth = 1;
+      scanner->flags |= FN_SKIP_ENDS;
+    }
+    else if ((flags & FN_CLASS) && !(flags & FN_EQUALS) &&
+             (!(flags & FN_PARAMS) || (flags & FN_NAME_AFTER))) {
+      push_scope(scanner, CLASS,
+        (flags & FN_CLASS_NAMED) ? &scanner->class_name : &scanner->name);
+      reset_declaration(scanner);
+    }
+    else if ((flags & FN_PARAMS) && !(flags & FN_EQUALS)) start_body(scanner);
+    else if ((flags & FN_EXTERN) && !(flags & FN_PARAMS)) {
+      push_scope(scanner, LINKAGE, NULL);
+      reset_declaration(scanner);
+    }
+    else if ((flags & FN_EQUALS) && (flags & FN_LAMBDA) && scanner->candidate.length != 0)
+      start_body(scanner);
+    else {
+      /* An initializer (after '=') is part of the declaration. */
+      scanner->skip_depth = 1;
+      if (!(flags & FN_EQUALS)) scanner->flags |= FN_SKIP_ENDS;
+    }
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void end_token(FnScanner *scanner);                                    */
+/*                                                                        */
+/*      This function handles the identifier (or number) in the token     */
+/*      member.                                                           */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+void end_token(FnScanner *scanner)
+  {
+    const char  *token = scanner->token.text;
+    size_t       length = scanner->token.length;
+    const char **p;
+
+    scanner->token.length = 0;
+    if (token == NULL || scanner->angle > 0) return;
+    if (scanner->operator_state != 0) {
+      /* Part of a name such as "operator new" or "operator bool". */
+      append(scanner, &scanner->name, " ", 1);
+      append(scanner, &scanner->name, token, length);
+      scanner->operator_state = 3;
+      return;
+    }
+    if (token[0] >= '0' && token[0] <= '9') {
+      scanner->last = T_OTHER;
+      return;
+    }
+    if (scanner->paren > 0) {
+      scanner->last = T_NAME;
+      return;
+    }
+
+    if (strcmp(token, "namespace") == 0 || strcmp(token, "class") == 0 ||
+        strcmp(token, "struct") == 0 || strcmp(token, "union") == 0) {
+      /* The name that follows is the one that matters. */
+      scanner->flags |= (token[0] == 'n') ? FN_NAMESPACE : FN_CLASS;
+      scanner->name.length = 0;
+      scanner->name_open = NO;
+    }
+    else if (strcmp(token, "enum") == 0) scanner->flags |= FN_ENUM;
+    else if (strcmp(token, "extern") == 0) scanner->flags |= FN_EXTERN;
+    else if (strcmp(token, "template") == 0) {
+      scanner->last = T_TEMPLATE;
+      return;
+    }
+    else if (strcmp(token, "public") == 0 || strcmp(token, "private") == 0 ||
+             strcmp(token, "protected") == 0) {
+      scanner->last = T_ACCESS;
+      return;
+    }
+    else if (strcmp(token, "operator") == 0) {
+      if (scanner->name_open) append(scanner, &scanner->name, token, length);
+      else {
+        set_text(scanner, &scanner->name, token, length);
+        scanner->name_line = scanner->token_line;
+      }
+      scanner->name_open = NO;
+      scanner->operator_state = 1;
+      scanner->last = T_NAME;
+      return;
+    }
+    else {
+      for (p = not_names; *p != NULL; p++) {
+        if (strcmp(token, *p) == 0) {
+          scanner->last = T_KEYWORD;
+          return;
+        }
+      }
+
+      /* An ordinary name. */
+      if (scanner->name_open) append(scanner, &scanner->name, token, length);
+      else {
+        set_text(scanner, &scanner->name, token, length);
+        scanner->name_line = scanner->token_line;
+      }
+      scanner->name_open = NO;
+      scanner->last = T_NAME;
+      if (scanner->flags & FN_PARAMS) scanner->flags |= FN_NAME_AFTER;
+      return;
+    }
+    scanner->last = T_KEYWORD;
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void punctuation(FnScanner *scanner, int ch);                          */
+/*                                                                        */
+/*      This function handles a character that isn't part of a name in a */
+/*      declaration. The :: token is given as ch = 0.                     */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+void punctuation(FnScanner *scanner, int ch)
+  {
+    char c = (char)ch;
+
+    /* The rest of a name such as "operator+" or "operator()". */
+    if (scanner->operator_state != 0) {
+      if (scanner->operator_state == 1 && ch == '(') {
+        append(scanner, &scanner->name, "()", 2);
+        scanner->operator_state = 2;
+        return;
+      }
+      if (scanner->operator_state == 2 && ch == ')') {
+        scanner->operator_state = 3;
+        return;
+      }
+      if (ch != '(' && ch != ';' && ch != '{' && ch != '}') {
+        if (ch == 0) append(scanner, &scanner->name, "::", 2);
+        else append(scanner, &scanner->name, &c, 1);
+        scanner->operator_state = 3;
+        return;
+      }
+      scanner->operator_state = 0;
+      scanner->last = T_NAME;
+    }
+
+    /* Template arguments are passed over. */
+    if (scanner->angle > 0) {
+      if (ch == '<') scanner->angle++;
+      else if (ch == '>') {
+        if (--scanner->angle == 0) scanner->last = T_ANGLE;
+        return;
+      }
+      if (ch != ';' && ch != '{' && ch != '}') return;
+      scanner->angle = 0;
+    }
+
+    switch (ch) {
+      case '{':
+        open_brace(scanner);
+        return;
+
+      case '}':
+        pop_scope(scanner);
+        reset_declaration(scanner);
+        return;
+
+      case '(':
+        if (scanner->paren == 0 && !(scanner->flags & (FN_EQUALS | FN_INIT_LIST)) &&
+            (scanner->last == T_NAME || scanner->last == T_ANGLE) &&
+            !scanner->name_open && scanner->name.length != 0) {
+          set_text(scanner, &scanner->candidate, scanner->name.text, scanner->name.length);
+          scanner->candidate_line = scanner->name_line;
+          scanner->flags = (scanner->flags | FN_PARAMS_OPEN) & ~(FN_PARAMS | FN_NAME_AFTER);
+        }
+        scanner->paren++;
+        break;
+
+      case ')':
+        if (scanner->paren > 0) scanner->paren--;
+        if (scanner->paren == 0 && (scanner->flags & FN_PARAMS_OPEN))
+          scanner->flags = (scanner->flags & ~FN_PARAMS_OPEN) | FN_PARAMS;
+        break;
+
+      case '[':
+        if (scanner->paren++ == 0 && (scanner->flags & FN_EQUALS))
+          scanner->flags |= FN_LAMBDA;
+        break;
+
+      case ']':
+        if (scanner->paren > 0) scanner->paren--;
+        break;
+
+      default:
+        if (scanner->paren > 0) break;
+        switch (ch) {
+          case ';':
+            reset_declaration(scanner);
+            return;
+
+          case '<':
+            if (scanner->last == T_NAME || scanner->last == T_ANGLE ||
+                scanner->last == T_TEMPLATE) {
+              scanner->angle = 1;
+              return;
+            }
+            break;
+
+          case 0:
+            /* :: joins names. A :: at the start means the global scope. */
+            if (scanner->last != T_NAME && scanner->last != T_ANGLE)
+              scanner->name.length = 0;
+            else append(scanner, &scanner->name, "::", 2);
+            scanner->name_open = YES;
+            scanner->last = T_SCOPE;
+            return;
+
+          case '~':
+            if (scanner->last == T_SCOPE) append(scanner, &scanner->name, "~", 1);
+            else {
+              set_text(scanner, &scanner->name, "~", 1);
+              scanner->name_line = scanner->line;
+            }
+            scanner->name_open = YES;
+            scanner->last = T_SCOPE;
+            return;
+
+          case '=':
+            if (!(scanner->flags & FN_EQUALS) && scanner->candidate.length == 0 &&
+                scanner->name.length != 0) {
+              /* In case the value is a lambda. */
+              set_text(scanner, &scanner->candidate, scanner->name.text, scanner->name.length);
+              scanner->candidate_line = scanner->name_line;
+            }
+            scanner->flags |= FN_EQUALS;
+            break;
+
+          case ':':
+            if (scanner->last == T_ACCESS) {
+              reset_declaration(scanner);
+              return;
+            }
+            if ((scanner->flags & FN_CLASS) && !(scanner->flags & FN_CLASS_NAMED)) {
+              set_text(scanner, &scanner->class_name, scanner->name.text, scanner->name.length);
+              scanner->flags |= FN_CLASS_NAMED;
+            }
+            else if (scanner->flags & FN_PARAMS) scanner->flags |= FN_INIT_LIST;
+            break;
+        }
+        break;
+    }
+    scanner->last = T_OTHER;
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void declaration(FnScanner *scanner, int ch);                          */
+/*                                                                        */
+/*      This function reads one character of a declaration.               */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+void declaration(FnScanner *scanner, int ch)
+  {
+    char c = (char)ch;
+
+    if ((ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') ||
+        (ch >= '0' && ch <= '9') || ch == '_' || ch >= 0x80) {
+      if (scanner->colon) {
+        scanner->colon = NO;
+        punctuation(scanner, ':');
+      }
+      if (scanner->token.length == 0) scanner->token_line = scanner->line;
+      append(scanner, &scanner->token, &c, 1);
+      return;
+    }
+    if (scanner->token.length != 0) end_token(scanner);
+    if (ch == ':') {
+      if (scanner->colon) {
+        scanner->colon = NO;
+        punctuation(scanner, 0);
+      }
+      else scanner->colon = YES;
+      return;
+    }
+    if (scanner->colon) {
+      scanner->colon = NO;
+      punctuation(scanner, ':');
+    }
+    if (ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r' || ch == '\f' || ch == '\v')
+      return;
+    punctuation(scanner, ch);
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void end_word(FnScanner *scanner);                                     */
+/*                                                                        */
+/*      This function ends the current token in a declaration. It is      */
+/*      called when a comment or literal is found.                        */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+void end_word(FnScanner *scanner)
+  {
+    if (scanner->token.length != 0) end_token(scanner);
+    if (scanner->colon) {
+      scanner->colon = NO;
+      punctuation(scanner, ':');
+    }
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* boolean blank_line(const char *block, size_t start, size_t i,          */
+/*   boolean before);                                                     */
+/*                                                                        */
+/*      This function returns YES if there is nothing but blanks in front */
+/*      of block[i] on its line. The text before start isn't looked at;   */
+/*      before says if the line was blank up to there.                    */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+boolean blank_line(const char *block, size_t start, size_t i, boolean before)
+  {
+    while (i > start) {
+      i--;
+      if (block[i] == '\n') return YES;
+      if (block[i] != ' ' && block[i] != '\t' && block[i] != '\r' && block[i] != '\f')
+        return NO;
+    }
+    return before;
+  }
+
+PRIVATE
+long count_lines(const char *p, size_t n)
+  {
+    long   count = 0;
+    size_t i;
+
+    for (i = 0; i < n; i++) count += (p[i] == '\n');
+    return count;
+  }
+
+/*------------------------------------------------------------------------*/
+/* size_t pass_directive(FnScanner *scanner, const char *block,           */
+/*   size_t i, size_t end);                                               */
+/*                                                                        */
+/*      This function passes over a preprocessor line, or as much of it   */
+/*      as there is before end. It returns the offset after what it used. */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+size_t pass_directive(FnScanner *scanner, const char *block, size_t i, size_t end)
+  {
+    for ( ; i < end; i++) {
+      if (block[i] == '\n') {
+        scanner->line++;
+        if (scanner->directive != AFTER_ESCAPE) {
+          scanner->directive  = NO_DIRECTIVE;
+          scanner->line_start = YES;
+          return i + 1;
+        }
+        scanner->directive = IN_DIRECTIVE;
+      }
+      else if (block[i] == '\\') scanner->directive = AFTER_ESCAPE;
+      else if (block[i] != '\r') scanner->directive = IN_DIRECTIVE;
+    }
+    return i;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void scan_code(FnScanner *scanner, const char *block, size_t i,        */
+/*   size_t end);                                                         */
+/*                                                                        */
+/*      This function scans a span of code.                               */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+void scan_code(FnScanner *scanner, const char *block, size_t i, size_t end)
+  {
+    size_t start = i;
+    size_t stop;
+    int    ch;
+
+    while (i < end) {
+      if (scanner->directive != NO_DIRECTIVE) {
+        start = i = pass_directive(scanner, block, i, end);
+        continue;
+      }
+
+      if (scanner->in_body || scanner->skip_depth > 0) {
+        /* Only braces and preprocessor lines matter here. */
+        for (stop = i; stop < end; stop++) {
+          ch = block[stop];
+          if (ch == '{' || ch == '}' || ch == '#') break;
+        }
+        scanner->line += count_lines(block + i, stop - i);
+        if (stop == end) {
+          if (scanner->in_body) KeyScanText(&scanner->keys, block + i, stop - i);
+          scanner->line_start = blank_line(block, start, stop, scanner->line_start);
+          return;
+        }
+        if (block[stop] == '#') {
+          if (scanner->in_body) {
+            KeyScanText(&scanner->keys, block + i, stop - i);
+            KeyScanBreak(&scanner->keys);
+          }
+          if (blank_line(block, start, stop, scanner->line_start))
+            scanner->directive = IN_DIRECTIVE;
+          i = stop + 1;
+          continue;
+        }
+        if (scanner->in_body) KeyScanText(&scanner->keys, block + i, stop + 1 - i);
+        scanner->line_start = NO;
+        i = stop + 1;
+        if (block[stop] == '{') {
+          if (scanner->in_body) {
+            if (++scanner->body_depth > scanner->max_depth)
+              scanner->max_depth = scanner->body_depth;
+          }
+          else scanner->skip_depth++;
+        }
+        else if (scanner->skip_depth > 0) {
+          if (--scanner->skip_depth == 0) {
+            /* After x_{0} in an initializer list the next '{' is the body. */
+            if (scanner->flags & FN_SKIP_ENDS) reset_declaration(scanner);
+            else scanner->last = T_OTHER;
+          }
+        }
+        else if (scanner->body_depth > 0) scanner->body_depth--;
+        else end_body(scanner, stop);
+        continue;
+      }
+
+      /* In a declaration. */
+      ch = (unsigned char)block[i];
+      if (ch == '#' && scanner->line_start) {
+        end_word(scanner);
+        scanner->directive = IN_DIRECTIVE;
+        i++;
+        continue;
+      }
+      declaration(scanner, ch);
+      if (ch == '\n') {
+        scanner->line++;
+        scanner->line_start = YES;
+      }
+      else if (ch != ' ' && ch != '\t' && ch != '\r' && ch != '\f')
+        scanner->line_start = NO;
+      i++;
+    }
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void pass_over(FnScanner *scanner, const CmtSpan *span);               */
+/*                                                                        */
+/*      This function handles a comment or literal.                       */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+void pass_over(FnScanner *scanner, const CmtSpan *span)
+  {
+    scanner->line += span->newlines;
+    if (scanner->in_body) KeyScanBreak(&scanner->keys);
+    else if (scanner->skip_depth == 0 && scanner->directive == NO_DIRECTIVE) {
+      end_word(scanner);
+      if (span->kind == CMT_STRING || span->kind == CMT_CHAR) {
+        if (scanner->paren == 0 && scanner->angle == 0 && scanner->operator_state == 0)
+          scanner->last = T_OTHER;
+      }
+    }
+
+    /* A // comment ends with the new-line that ends a preprocessor line. */
+    if (span->kind == CMT_CPP_COMMENT && span->newlines != 0) {
+      if (scanner->directive != AFTER_ESCAPE) scanner->directive = NO_DIRECTIVE;
+      scanner->line_start = YES;
+    }
+    else if (span->kind != CMT_C_COMMENT) scanner->line_start = NO;
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* size_t FnScanBlock(                                                    */
+/*   FnScanner *scanner, const char *block, size_t size, boolean at_end); */
+/*                                                                        */
+/*      This function scans a block of the input and returns the number   */
+/*      of characters it used (see the top of this file).                 */
+/*------------------------------------------------------------------------*/
+
+PUBLIC
+size_t FnScanBlock(FnScanner *scanner, const char *block, size_t size, boolean at_end)
+  {
+    CmtSpan span;
+    size_t  used = 0;
+
+    while (CmtScanSpan(&scanner->scanner, block, size, &used, &span, at_end)) {
+      if (span.kind == CMT_CODE) scan_code(scanner, block, span.offset, span.offset + span.length);
+      else pass_over(scanner, &span);
+    }
+    if (at_end && used == size && !scanner->in_body && scanner->skip_depth == 0)
+      end_word(scanner);
+    return used;
+  }
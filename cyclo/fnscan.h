@@ -0,0 +1,103 @@
+/*****************************************************************************
+FILE     : fnscan.h
+CONTENTS : Finding the functions in C/C++ source code.
+PROGRAMMER    : Peter Chapin
+
+This file contains the interface to the module that does the real work of
+CYCLO. The caller supplies an FnScanner object, resets it at the start of
+each file, and passes the file through FnScanBlock() in blocks. Each time
+the end of a function body is found a description of the function is sent
+to a function supplied by the caller. All state is in the FnScanner object
+so any number of files can be scanned at once (on different threads if
+desired).
+
+See FNSCAN.C for more information.
+
+*****************************************************************************/
+
+#ifndef FNSCAN_H
+#define FNSCAN_H
+
+#include <stddef.h>
+#include "scanners.h"
+#include "keyscan.h"
+
+/* A function that has been found. */
+typedef struct {
+  const char *name;           /* Qualified name, for example "ns::A::f".  */
+  long        first_line;     /* Line of the name.                        */
+  long        last_line;      /* Line of the closing '}'.                 */
+  long        cyclomatic;     /* One plus the number of decision points.  */
+  long        cases;          /* Number of case labels.                   */
+  long        depth;          /* Deepest nesting of {} inside the body.   */
+  size_t      offset;         /* Offset of the closing '}' in the block.  */
+} FnInfo;
+
+typedef void (*FnReport)(void *context, const FnInfo *info);
+
+/* A growing string. Private to FNSCAN.C. */
+typedef struct {
+  char       *text;
+  size_t      length;
+  size_t      size;
+} FnText;
+
+/* A scope that encloses the current point. Private to FNSCAN.C. */
+typedef struct {
+  int         kind;
+  size_t      prefix_length;  /* Length of the prefix outside the scope.  */
+} FnScope;
+
+typedef struct {
+  CmtScanner  scanner;        /* Finds the comments and literals.         */
+  KeyScanner  keys;           /* Counts the decision points.              */
+  long        line;           /* Line of the next char.                   */
+  boolean     line_start;     /* =YES if only blanks so far on the line.  */
+  int         directive;      /* Where we are in a preprocessor line.     */
+
+  FnScope    *scopes;         /* Namespaces, classes, etc, outermost      */
+  size_t      scope_count;    /*   first.                                 */
+  size_t      scope_size;
+  FnText      prefix;         /* Their names, for example "ns::A::".      */
+
+  /* The function body being scanned, if any. */
+  boolean     in_body;
+  long        body_depth;     /* Depth of {} in the body.                 */
+  long        max_depth;
+  long        body_line;      /* Line of the function's name.             */
+  long        skip_depth;     /* Depth of {} in an initializer, etc.      */
+
+  /* The declaration being scanned (see FNSCAN.C). */
+  FnText      token;          /* Identifier being read.                   */
+  long        token_line;
+  int         last;           /* Kind of the last token.                  */
+  boolean     colon;          /* =YES if the last char was a ':'.         */
+  FnText      name;           /* Last (qualified) name.                   */
+  long        name_line;
+  boolean     name_open;      /* =YES if the name is followed by ::.      */
+  FnText      candidate;      /* Name of the function, if this is one.    */
+  long        candidate_line;
+  FnText      class_name;
+  int         flags;          /* What has been seen (FN_xxx in FNSCAN.C). */
+  long        paren;          /* Depth of () and [].                      */
+  long        angle;          /* Depth of <> being passed over.           */
+  int         operator_state; /* Where we are in an "operator" name.      */
+
+  FnReport    report;         /* Where functions go.                      */
+  void       *context;        /* Passed to report.                        */
+  boolean     out_of_memory;  /* =YES if names couldn't be stored.        */
+} FnScanner;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern void   FnScanReset(FnScanner *, FnReport, void *);
+extern void   FnScanFree(FnScanner *);
+extern size_t FnScanBlock(FnScanner *, const char *, size_t, boolean);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
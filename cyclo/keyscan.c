@@ -0,0 +1,418 @@
+/*****************************************************************************
+FILE          : keyscan.c
+LAST REVISION : October 2026
+SUBJECT       : Counting of decision points in C/C++ code.
+PROGRAMMER    : Peter Chapin
+
+This module counts the keywords (if, for, while, case) and operators (&&,
+||) that each add one to the cyclomatic number of a function. It makes one
+pass over the code and counts all of them at once.
+
+The counting is done by an Aho-Corasick automaton built from the list of
+keywords. Keywords only count when they are whole tokens, so "elif_x" and
+"format" don't count as "if" or "for". A keyword can therefore only start
+at the start of a token, and the failure function of the automaton always
+leads back to the root (for a character that can't be part of an
+identifier) or to a state that waits for the end of the identifier (for
+one that can). A keyword is counted when the character after it shows
+that the identifier has ended. An operator is counted as soon as it is
+complete, and the automaton starts again after it, so "|||" is one "||".
+
+The characters are first mapped to classes: one for each character that
+appears in a keyword, one for the other identifier characters, and one for
+everything else. The table of transitions is small enough to stay in the
+cache. Each entry holds the next state and the keyword (if any) that the
+transition completes.
+
+Stepping the automaton costs several cycles for each character, and most
+characters can't start a keyword. When vector instructions are available
+the scanner looks at 16 characters at a time while it is between keywords.
+It stops only at an operator character or at the start of an identifier
+whose first two characters match the start of a keyword, and steps the
+automaton from there until it is between keywords again. (Every keyword
+is at least two characters long.) Most blocks of code are passed over
+without being stepped through at all.
+
+The module works like this.
+
+1.   KeyScanReset() prepares a KeyScanner for a new file. The first call
+     builds the tables, so it should be made before any threads that use
+     the module are started.
+
+2.   KeyScanText() is given a run of code. Runs may be any length and may
+     split tokens; the state is carried from one to the next.
+
+3.   KeyScanBreak() tells the scanner that something other than code (a
+     comment or a literal) came next. That ends the current token.
+
+4.   The counts are in the KeyScanner. A keyword at the very end of a run
+     isn't counted until the next run or break shows where it ends.
+     KeyScanDecisions() adds up the counts of everything that adds to the
+     cyclomatic number.
+
+     Please send comments and bug reports to
+
+     Peter Chapin
+     chapinp@proton.me
+
+*****************************************************************************/
+
+#include "local.h"
+#include <ctype.h>
+#include <string.h>
+#include "standard.h"
+#include "keyscan.h"
+
+/* Select the vector instructions used to skip over uninteresting text.
+     Compile with KEY_NO_SIMD defined to force the plain C version. */
+#if !defined(KEY_NO_SIMD) && defined(__AVX2__)
+#define KEY_AVX2
+#include <immintrin.h>
+#endif
+#if !defined(KEY_NO_SIMD) && \
+    (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define KEY_SSE2
+#include <emmintrin.h>
+#endif
+
+/*=================================*/
+/*           Global Data           */
+/*=================================*/
+
+#define MAX_STATES  64
+#define MAX_CLASSES 32
+
+#define ROOT        0         /* At the start of a token.                 */
+#define IN_WORD     1         /* In an identifier that isn't a keyword.   */
+
+#define OTHER       0         /* Class of chars not in identifiers.       */
+#define IDENT       1         /* Class of other identifier chars.         */
+
+/* What is counted. The order must match the KEY_xxx values, and the */
+/* number of words and operators must match the counts below.        */
+PRIVATE const char *keywords[KEY_COUNT] = {
+  NULL, "if", "for", "while", "case", "&&", "||"
+  };
+
+#define WORD_KEYS     4
+#define OPERATOR_KEYS 2
+
+PRIVATE boolean        ready = NO;
+PRIVATE unsigned char  char_class[256];
+PRIVATE boolean        is_ident[MAX_CLASSES];   /* =YES for identifier classes. */
+PRIVATE int            class_count;
+PRIVATE int            state_count;
+
+/* The trie. child[s][c] is zero where there is no child. */
+PRIVATE unsigned char  child[MAX_STATES][MAX_CLASSES];
+PRIVATE unsigned char  finished[MAX_STATES];    /* Keyword spelled by the state. */
+PRIVATE boolean        in_name[MAX_STATES];     /* =YES if part of an identifier. */
+
+/* The automaton. Each entry is (keyword << 8) | next state. */
+PRIVATE unsigned short table[MAX_STATES][MAX_CLASSES];
+
+#if defined(KEY_SSE2)
+/* The first two chars of each word keyword and the first char of each */
+/* operator, in every position of a vector.                             */
+PRIVATE __m128i word_first[WORD_KEYS];
+PRIVATE __m128i word_second[WORD_KEYS];
+PRIVATE __m128i operator_first[OPERATOR_KEYS];
+#endif
+#if defined(KEY_AVX2)
+PRIVATE __m256i wide_first[WORD_KEYS];
+PRIVATE __m256i wide_second[WORD_KEYS];
+PRIVATE __m256i wide_operator[OPERATOR_KEYS];
+#endif
+
+/*==========================================*/
+/*           Function Definitions           */
+/*==========================================*/
+
+/*------------------------------------------------------------------------*/
+/* unsigned short from_root(int c);                                       */
+/*                                                                        */
+/*      This function returns the transition from the start of a token    */
+/*      on a character of class c. Operators are counted when they are    */
+/*      complete; see build().                                            */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+unsigned short from_root(int c)
+  {
+    if (child[ROOT][c] != 0) return table[ROOT][c];
+    return is_ident[c] ? IN_WORD : ROOT;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void build(void);                                                      */
+/*                                                                        */
+/*      This function builds the classes, the trie, and the automaton.    */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+void build(void)
+  {
+    const char *p;
+    int         ch, k, s, c, next;
+
+    /* Classes. Chars that are in keywords get their own. */
+    for (ch = 0; ch < 256; ch++)
+      char_class[ch] = (isalnum(ch) || ch == '_' || ch >= 0x80) ? IDENT : OTHER;
+    is_ident[OTHER] = NO;
+    is_ident[IDENT] = YES;
+    class_count = 2;
+    for (k = 1; k < KEY_COUNT; k++) {
+      for (p = keywords[k]; *p != '\0'; p++) {
+        ch = (unsigned char)*p;
+        if (char_class[ch] >= 2) continue;
+        is_ident[class_count] = (char_class[ch] == IDENT) ? YES : NO;
+        char_class[ch] = (unsigned char)class_count++;
+      }
+    }
+
+    /* The trie. States 0 and 1 are ROOT and IN_WORD. */
+    memset(child, 0, sizeof(child));
+    memset(finished, 0, sizeof(finished));
+    memset(in_name, 0, sizeof(in_name));
+    state_count = 2;
+    for (k = 1; k < KEY_COUNT; k++) {
+      for (s = ROOT, p = keywords[k]; *p != '\0'; p++) {
+        c = char_class[(unsigned char)*p];
+        if (child[s][c] == 0) {
+          child[s][c] = (unsigned char)state_count++;
+          in_name[child[s][c]] = is_ident[c];
+        }
+        s = child[s][c];
+      }
+      finished[s] = (unsigned char)k;
+    }
+
+    /* The automaton. The states are numbered so each child comes after  */
+    /* its parent, which means the root's transitions are done first.     */
+    for (s = 0; s < state_count; s++) {
+      if (s == IN_WORD) continue;
+      for (c = 0; c < class_count; c++) {
+        if ((next = child[s][c]) != 0) {
+          /* An operator is counted as soon as it is complete. */
+          if (finished[next] != 0 && !is_ident[c])
+            table[s][c] = (unsigned short)((finished[next] << 8) | ROOT);
+          else
+            table[s][c] = (unsigned short)next;
+        }
+        else if (s == ROOT) table[s][c] = is_ident[c] ? IN_WORD : ROOT;
+        else if (!in_name[s]) table[s][c] = from_root(c);
+        else if (is_ident[c]) table[s][c] = IN_WORD;
+        else table[s][c] = (unsigned short)((finished[s] << 8) | from_root(c));
+      }
+    }
+    for (c = 0; c < class_count; c++)
+      table[IN_WORD][c] = is_ident[c] ? IN_WORD : from_root(c);
+
+#if defined(KEY_SSE2)
+    for (s = 0, c = 0, k = 1; k < KEY_COUNT; k++) {
+      if (is_ident[char_class[(unsigned char)keywords[k][0]]]) {
+        word_first[s]  = _mm_set1_epi8(keywords[k][0]);
+        word_second[s] = _mm_set1_epi8(keywords[k][1]);
+#if defined(KEY_AVX2)
+        wide_first[s]  = _mm256_set1_epi8(keywords[k][0]);
+        wide_second[s] = _mm256_set1_epi8(keywords[k][1]);
+#endif
+        s++;
+      }
+      else {
+#if defined(KEY_AVX2)
+        wide_operator[c] = _mm256_set1_epi8(keywords[k][0]);
+#endif
+        operator_first[c++] = _mm_set1_epi8(keywords[k][0]);
+      }
+    }
+#endif
+    ready = YES;
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* const unsigned char *skip(                                             */
+/*   const unsigned char *p, const unsigned char *end, unsigned *state);  */
+/*                                                                        */
+/*      This function passes over text while the automaton is between     */
+/*      keywords (in ROOT or IN_WORD). It returns a pointer to the first  */
+/*      character that might start a keyword, or to near the end of the   */
+/*      text, and sets the state to the one for that point. It looks at   */
+/*      32 or 16 characters at a time.                                    */
+/*------------------------------------------------------------------------*/
+
+#if defined(KEY_AVX2) || defined(KEY_SSE2)
+
+PRIVATE
+int first_bit(unsigned mask)
+  {
+#if defined(__GNUC__)
+    return __builtin_ctz(mask);
+#else
+    int n = 0;
+
+    while ((mask & 1) == 0) {
+      mask >>= 1;
+      n++;
+    }
+    return n;
+#endif
+  }
+
+PRIVATE
+const unsigned char *skip(const unsigned char *p, const unsigned char *end, unsigned *state)
+  {
+    const __m128i zero     = _mm_setzero_si128();
+    const __m128i case_bit = _mm_set1_epi8(0x20);
+    __m128i  here, next, lower, ident, found;
+    unsigned ident_bits, bits;
+    unsigned carry = (*state == IN_WORD) ? 1 : 0;   /* =1 if in an identifier. */
+    int      i;
+
+#if defined(KEY_AVX2)
+    {
+      __m256i  wide_here, wide_next, wide_found;
+
+      /* Pass over 32 chars at a time. Anything found is looked at below. */
+      while (end - p >= 33) {
+        wide_here  = _mm256_loadu_si256((const __m256i *)p);
+        wide_next  = _mm256_loadu_si256((const __m256i *)(p + 1));
+        wide_found = _mm256_setzero_si256();
+        for (i = 0; i < WORD_KEYS; i++) {
+          wide_found = _mm256_or_si256(wide_found,
+            _mm256_and_si256(_mm256_cmpeq_epi8(wide_here, wide_first[i]),
+                             _mm256_cmpeq_epi8(wide_next, wide_second[i])));
+        }
+        for (i = 0; i < OPERATOR_KEYS; i++)
+          wide_found = _mm256_or_si256(wide_found, _mm256_cmpeq_epi8(wide_here, wide_operator[i]));
+        if (_mm256_movemask_epi8(wide_found) != 0) break;
+        carry = is_ident[char_class[p[31]]] ? 1 : 0;
+        p += 32;
+      }
+    }
+#endif
+
+    /* The next character is needed too, so stop 17 short of the end. */
+    while (end - p >= 17) {
+      here  = _mm_loadu_si128((const __m128i *)p);
+      next  = _mm_loadu_si128((const __m128i *)(p + 1));
+      found = zero;
+      for (i = 0; i < WORD_KEYS; i++) {
+        found = _mm_or_si128(found,
+          _mm_and_si128(_mm_cmpeq_epi8(here, word_first[i]),
+                        _mm_cmpeq_epi8(next, word_second[i])));
+      }
+      for (i = 0; i < OPERATOR_KEYS; i++)
+        found = _mm_or_si128(found, _mm_cmpeq_epi8(here, operator_first[i]));
+
+      /* Usually there is nothing; only the last char matters then. */
+      if (_mm_movemask_epi8(found) == 0) {
+        carry = is_ident[char_class[p[15]]] ? 1 : 0;
+        p += 16;
+        continue;
+      }
+
+      /* Letters, digits, '_', and anything that isn't ASCII. */
+      lower = _mm_or_si128(here, case_bit);
+      ident = _mm_or_si128(
+        _mm_or_si128(
+          _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                        _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1))),
+          _mm_and_si128(_mm_cmpgt_epi8(here, _mm_set1_epi8('0' - 1)),
+                        _mm_cmplt_epi8(here, _mm_set1_epi8('9' + 1)))),
+        _mm_or_si128(_mm_cmpeq_epi8(here, _mm_set1_epi8('_')),
+                     _mm_cmplt_epi8(here, zero)));
+      ident_bits = (unsigned)_mm_movemask_epi8(ident);
+
+      /* Word keywords only count at the start of an identifier. */
+      bits  = (unsigned)_mm_movemask_epi8(found);
+      bits &= ~(ident_bits & ((ident_bits << 1) | carry));
+      if (bits != 0) {
+        i = first_bit(bits);
+        if (i > 0) carry = (ident_bits >> (i - 1)) & 1;
+        *state = carry ? IN_WORD : ROOT;
+        return p + i;
+      }
+      carry = (ident_bits >> 15) & 1;
+      p += 16;
+    }
+    *state = carry ? IN_WORD : ROOT;
+    return p;
+  }
+
+#endif
+
+/*------------------------------------------------------------------------*/
+/* void KeyScanReset(KeyScanner *scanner);                                */
+/*                                                                        */
+/*      This function prepares a scanner for a new file.                  */
+/*------------------------------------------------------------------------*/
+
+PUBLIC
+void KeyScanReset(KeyScanner *scanner)
+  {
+    if (!ready) build();
+    scanner->state = ROOT;
+    memset(scanner->counts, 0, sizeof(scanner->counts));
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void KeyScanText(KeyScanner *scanner, const char *text, size_t length);*/
+/*                                                                        */
+/*      This function counts the keywords in a run of code.               */
+/*------------------------------------------------------------------------*/
+
+PUBLIC
+void KeyScanText(KeyScanner *scanner, const char *text, size_t length)
+  {
+    const unsigned char *p   = (const unsigned char *)text;
+    const unsigned char *end = p + length;
+    long          *counts = scanner->counts;
+    unsigned       state  = (unsigned)scanner->state;
+    unsigned short entry;
+
+    while (p < end) {
+#if defined(KEY_SSE2)
+      if (state <= IN_WORD && (p = skip(p, end, &state)) == end) break;
+#endif
+      entry = table[state][char_class[*p++]];
+      if (entry > 0xFF) counts[entry >> 8]++;
+      state = entry & 0xFF;
+    }
+    scanner->state = (int)state;
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void KeyScanBreak(KeyScanner *scanner);                                */
+/*                                                                        */
+/*      This function ends the current token.                             */
+/*------------------------------------------------------------------------*/
+
+PUBLIC
+void KeyScanBreak(KeyScanner *scanner)
+  {
+    unsigned short entry = table[scanner->state][OTHER];
+
+    scanner->counts[entry >> 8]++;
+    scanner->state = entry & 0xFF;
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* long KeyScanDecisions(const KeyScanner *scanner);                      */
+/*                                                                        */
+/*      This function returns the number of decision points counted.      */
+/*------------------------------------------------------------------------*/
+
+PUBLIC
+long KeyScanDecisions(const KeyScanner *scanner)
+  {
+    int  k;
+    long total = 0;
+
+    for (k = 1; k < KEY_COUNT; k++) total += scanner->counts[k];
+    return total;
+  }
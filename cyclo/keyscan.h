@@ -0,0 +1,49 @@
+/*****************************************************************************
+FILE     : keyscan.h
+CONTENTS : Counting of decision points in C/C++ code.
+PROGRAMMER    : Peter Chapin
+
+This file contains the interface to a module that counts the keywords and
+operators that add to the cyclomatic number of a function. The caller
+gives it the code (not the comments or literals) a run at a time and reads
+the counts when it likes. All state is in a KeyScanner object so any number
+of files can be scanned at once (on different threads if desired).
+
+See KEYSCAN.C for more information.
+
+*****************************************************************************/
+
+#ifndef KEYSCAN_H
+#define KEYSCAN_H
+
+#include <stddef.h>
+
+/* The things that are counted. counts[KEY_NONE] is not meaningful. */
+#define KEY_NONE   0
+#define KEY_IF     1
+#define KEY_FOR    2
+#define KEY_WHILE  3
+#define KEY_CASE   4
+#define KEY_AND    5          /* && */
+#define KEY_OR     6          /* || */
+#define KEY_COUNT  7
+
+typedef struct {
+  int   state;                /* Where the automaton is. Private.         */
+  long  counts[KEY_COUNT];    /* Number of each found. The caller may     */
+} KeyScanner;                 /*   clear these at any time.               */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern void KeyScanReset(KeyScanner *);
+extern void KeyScanText(KeyScanner *, const char *, size_t);
+extern void KeyScanBreak(KeyScanner *);
+extern long KeyScanDecisions(const KeyScanner *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,501 @@
+/*****************************************************************************
+FILE          : results.c
+LAST REVISION : October 2026
+SUBJECT       : Collecting and reporting the functions of many files.
+PROGRAMMER    : Peter Chapin
+
+This module keeps the functions found in each file of a project and writes
+one report that covers all of them. The report is meant to be read by
+other programs. It can be written in two forms.
+
+1.   JSON. The top level object has four members:
+
+          "files"      An array with an object for each file, in the
+                       order the files were named. Each has the file's
+                       "name", its "functions" (name, first_line,
+                       last_line, cyclomatic, cases, depth), and its
+                       "totals" (functions, cyclomatic, max_cyclomatic).
+                       A file that couldn't be read has an "error".
+          "totals"     The number of files, failed files, functions, and
+                       the sum of the cyclomatic numbers.
+          "histogram"  The number of functions with cyclomatic numbers in
+                       the usual bands: 1-5, 6-10, 11-20, 21-50, and 51 up.
+          "hotspots"   The functions with the largest cyclomatic numbers,
+                       largest first.
+
+2.   CSV. A single table with the columns
+
+          kind,file,function,first_line,last_line,cyclomatic,cases,depth,count
+
+     The kind is one of "function", "file", "histogram", "hotspot", or
+     "total" and says how to read the other columns. A file row has the
+     file's total cyclomatic number and its number of functions (count). A
+     file that couldn't be read has the problem in the function column. A
+     histogram row names the band in the function column. A hotspot row
+     has its rank in the count column. The total row has the number of
+     functions in count.
+
+The hotspots are chosen in one pass over the functions with a short sorted
+list, so the size of the report doesn't depend on how the list is built.
+Functions with the same cyclomatic number are listed in the order they were
+found.
+
+     Please send comments and bug reports to
+
+     Peter Chapin
+     chapinp@proton.me
+
+*****************************************************************************/
+
+#include "local.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "standard.h"
+#include "scanners.h"
+#include "fnscan.h"
+#include "results.h"
+
+/*=================================*/
+/*           Global Data           */
+/*=================================*/
+
+/* The bands of the histogram. The last has no upper limit. */
+#define BAND_COUNT 5
+
+PRIVATE const long  band_low[BAND_COUNT]  = { 1, 6, 11, 21, 51 };
+PRIVATE const char *band_name[BAND_COUNT] = { "1-5", "6-10", "11-20", "21-50", "51+" };
+
+/* Files with these extensions are C/C++ source files. */
+PRIVATE const char *source_types[] = {
+  ".c", ".h", ".cpp", ".hpp", ".cc", ".hh", ".cxx", ".hxx", NULL
+  };
+
+/* The name of a file whose name couldn't be stored. */
+PRIVATE char no_name[] = "";
+
+/* A function in the list of hotspots. */
+typedef struct {
+  const FileResult *file;
+  const FnResult   *function;
+} Hotspot;
+
+/*==========================================*/
+/*           Function Definitions           */
+/*==========================================*/
+
+/*------------------------------------------------------------------------*/
+/* void ResInit(FileResult *file, const char *name);                      */
+/*                                                                        */
+/*      This function prepares a result for the named file. The name is   */
+/*      copied. If there is no memory for it the result is marked as      */
+/*      failed.                                                           */
+/*------------------------------------------------------------------------*/
+
+PUBLIC
+void ResInit(FileResult *file, const char *name)
+  {
+    file->functions = NULL;
+    file->count = file->size = 0;
+    file->error = NULL;
+    file->hash = 0;
+    file->length = 0;
+    file->hashed = NO;
+    file->cached = NO;
+    if ((file->name = (char *)malloc(strlen(name) + 1)) == NULL) {
+      file->name  = no_name;
+      file->error = "Out of memory";
+      return;
+    }
+    strcpy(file->name, name);
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* boolean ResAdd(FileResult *file, const FnInfo *info);                  */
+/*                                                                        */
+/*      This function adds a function to a file's result. It returns NO   */
+/*      (and marks the result as failed) if there is no memory.           */
+/*------------------------------------------------------------------------*/
+
+PUBLIC
+boolean ResAdd(FileResult *file, const FnInfo *info)
+  {
+    FnResult *bigger;
+    FnResult *function;
+    size_t    size;
+
+    if (file->count == file->size) {
+      size = (file->size == 0) ? 16 : 2 * file->size;
+      if ((bigger = (FnResult *)realloc(file->functions, size * sizeof(FnResult))) == NULL) {
+        file->error = "Out of memory";
+        return NO;
+      }
+      file->functions = bigger;
+      file->size = size;
+    }
+    function = &file->functions[file->count];
+    if ((function->name = (char *)malloc(strlen(info->name) + 1)) == NULL) {
+      file->error = "Out of memory";
+      return NO;
+    }
+    strcpy(function->name, info->name);
+    function->first_line = info->first_line;
+    function->last_line  = info->last_line;
+    function->cyclomatic = info->cyclomatic;
+    function->cases      = info->cases;
+    function->depth      = info->depth;
+    file->count++;
+    return YES;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void ResScan(FileResult *file, FILE *input, char *block);              */
+/*                                                                        */
+/*      This function scans an open file and adds its functions to the    */
+/*      result. The block is a work area of RES_BLOCK_SIZE characters.    */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+void record_function(void *context, const FnInfo *info)
+  {
+    FileResult *file = (FileResult *)context;
+
+    if (file->error == NULL) ResAdd(file, info);
+    return;
+  }
+
+PUBLIC
+void ResScan(FileResult *file, FILE *input, char *block)
+  {
+    FnScanner scanner;
+    size_t    held = 0;
+    size_t    count;
+    size_t    used;
+    boolean   at_end;
+
+    FnScanReset(&scanner, record_function, file);
+    do {
+      count  = held + fread(block + held, 1, RES_BLOCK_SIZE - held, input);
+      at_end = (feof(input) || ferror(input)) ? YES : NO;
+      used   = FnScanBlock(&scanner, block, count, at_end);
+      held   = count - used;
+      if (held != 0) block[0] = block[used];
+    } while (!at_end && file->error == NULL);
+
+    if (scanner.out_of_memory && file->error == NULL) file->error = "Out of memory";
+    if (ferror(input) && file->error == NULL) file->error = "Error reading file";
+    FnScanFree(&scanner);
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void ResScanText(FileResult *file, const char *text, size_t length);   */
+/*                                                                        */
+/*      This function scans the whole text of a file that is in memory    */
+/*      and adds its functions to the result.                             */
+/*------------------------------------------------------------------------*/
+
+PUBLIC
+void ResScanText(FileResult *file, const char *text, size_t length)
+  {
+    FnScanner scanner;
+
+    FnScanReset(&scanner, record_function, file);
+    FnScanBlock(&scanner, text, length, YES);
+    if (scanner.out_of_memory && file->error == NULL) file->error = "Out of memory";
+    FnScanFree(&scanner);
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void ResFree(FileResult *file);                                        */
+/*                                                                        */
+/*      This function releases the memory used by a result.               */
+/*------------------------------------------------------------------------*/
+
+PUBLIC
+void ResFree(FileResult *file)
+  {
+    size_t i;
+
+    for (i = 0; i < file->count; i++) free(file->functions[i].name);
+    free(file->functions);
+    if (file->name != no_name) free(file->name);
+    file->functions = NULL;
+    file->count = file->size = 0;
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* boolean ResIsSource(const char *name);                                 */
+/*                                                                        */
+/*      This function returns YES if a file's name has the extension of   */
+/*      a C/C++ source file.                                              */
+/*------------------------------------------------------------------------*/
+
+PUBLIC
+boolean ResIsSource(const char *name)
+  {
+    const char  *dot = strrchr(name, '.');
+    const char **type;
+
+    if (dot == NULL || strchr(dot, '/') != NULL) return NO;
+    for (type = source_types; *type != NULL; type++) {
+      if (strcmp(dot, *type) == 0) return YES;
+    }
+    return NO;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void ResPutJson(FILE *out, const char *text);                          */
+/* void ResPutCsv(FILE *out, const char *text);                           */
+/*                                                                        */
+/*      These functions write a string in the form each format needs.     */
+/*------------------------------------------------------------------------*/
+
+PUBLIC
+void ResPutJson(FILE *out, const char *text)
+  {
+    int ch;
+
+    putc('"', out);
+    for ( ; *text != '\0'; text++) {
+      ch = (unsigned char)*text;
+      if (ch == '"' || ch == '\\') fprintf(out, "\\%c", ch);
+      else if (ch < ' ') fprintf(out, "\\u%04x", ch);
+      else putc(ch, out);
+    }
+    putc('"', out);
+    return;
+  }
+
+PUBLIC
+void ResPutCsv(FILE *out, const char *text)
+  {
+    if (strpbrk(text, ",\"\r\n") == NULL) {
+      fputs(text, out);
+      return;
+    }
+    putc('"', out);
+    for ( ; *text != '\0'; text++) {
+      if (*text == '"') putc('"', out);
+      putc(*text, out);
+    }
+    putc('"', out);
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* int band(long cyclomatic);                                             */
+/*                                                                        */
+/*      This function returns the histogram band of a cyclomatic number.  */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+int band(long cyclomatic)
+  {
+    int i = BAND_COUNT - 1;
+
+    while (i > 0 && cyclomatic < band_low[i]) i--;
+    return i;
+  }
+
+/*------------------------------------------------------------------------*/
+/* size_t find_hotspots(const FileResult *files, size_t count,            */
+/*   Hotspot *hotspots, size_t top);                                      */
+/*                                                                        */
+/*      This function puts the (at most) top functions with the largest   */
+/*      cyclomatic numbers into hotspots, largest first. It returns the   */
+/*      number found.                                                     */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+size_t find_hotspots(const FileResult *files, size_t count, Hotspot *hotspots, size_t top)
+  {
+    size_t          found = 0;
+    size_t          i, j, k;
+    const FnResult *function;
+
+    if (top == 0) return 0;
+    for (i = 0; i < count; i++) {
+      for (j = 0; j < files[i].count; j++) {
+        function = &files[i].functions[j];
+        if (found == top && function->cyclomatic <= hotspots[top - 1].function->cyclomatic)
+          continue;
+
+        /* Find its place and move the smaller ones down. */
+        k = (found < top) ? found++ : top - 1;
+        while (k > 0 && hotspots[k - 1].function->cyclomatic < function->cyclomatic) {
+          hotspots[k] = hotspots[k - 1];
+          k--;
+        }
+        hotspots[k].file = &files[i];
+        hotspots[k].function = function;
+      }
+    }
+    return found;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void write_json(FILE *out, const FileResult *files, size_t count,      */
+/*   const long *histogram, const Hotspot *hotspots, size_t hotspot_count); */
+/*                                                                        */
+/*      This function writes the report as a JSON object.                 */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+void write_json(
+  FILE *out, const FileResult *files, size_t count,
+  const long *histogram, const Hotspot *hotspots, size_t hotspot_count)
+  {
+    const FnResult *function;
+    size_t i, j;
+    long   failed = 0;
+    long   functions = 0;
+    long   total = 0;
+    long   file_total;
+    long   file_max;
+
+    fprintf(out, "{\n  \"files\": [");
+    for (i = 0; i < count; i++) {
+      fprintf(out, "%s\n    {\"name\": ", (i == 0) ? "" : ",");
+      ResPutJson(out, files[i].name);
+      if (files[i].error != NULL) {
+        fprintf(out, ", \"error\": ");
+        ResPutJson(out, files[i].error);
+        failed++;
+      }
+      fprintf(out, ", \"functions\": [");
+      file_total = file_max = 0;
+      for (j = 0; j < files[i].count; j++) {
+        function = &files[i].functions[j];
+        fprintf(out, "%s\n      {\"name\": ", (j == 0) ? "" : ",");
+        ResPutJson(out, function->name);
+        fprintf(out,
+          ", \"first_line\": %ld, \"last_line\": %ld, \"cyclomatic\": %ld,"
+          " \"cases\": %ld, \"depth\": %ld}",
+          function->first_line, function->last_line, function->cyclomatic,
+          function->cases, function->depth);
+        file_total += function->cyclomatic;
+        if (function->cyclomatic > file_max) file_max = function->cyclomatic;
+      }
+      fprintf(out, "%s],\n     \"totals\": {\"functions\": %lu, \"cyclomatic\": %ld, \"max_cyclomatic\": %ld}}",
+        (files[i].count == 0) ? "" : "\n     ",
+        (unsigned long)files[i].count, file_total, file_max);
+      functions += (long)files[i].count;
+      total += file_total;
+    }
+    fprintf(out, "%s],\n", (count == 0) ? "" : "\n  ");
+
+    fprintf(out,
+      "  \"totals\": {\"files\": %lu, \"failed\": %ld, \"functions\": %ld, \"cyclomatic\": %ld},\n",
+      (unsigned long)count, failed, functions, total);
+
+    fprintf(out, "  \"histogram\": [");
+    for (i = 0; i < BAND_COUNT; i++) {
+      fprintf(out, "%s\n    {\"band\": \"%s\", \"min\": %ld, ", (i == 0) ? "" : ",",
+        band_name[i], band_low[i]);
+      if (i + 1 < BAND_COUNT) fprintf(out, "\"max\": %ld, ", band_low[i + 1] - 1);
+      fprintf(out, "\"functions\": %ld}", histogram[i]);
+    }
+    fprintf(out, "\n  ],\n");
+
+    fprintf(out, "  \"hotspots\": [");
+    for (i = 0; i < hotspot_count; i++) {
+      fprintf(out, "%s\n    {\"file\": ", (i == 0) ? "" : ",");
+      ResPutJson(out, hotspots[i].file->name);
+      fprintf(out, ", \"name\": ");
+      ResPutJson(out, hotspots[i].function->name);
+      fprintf(out, ", \"first_line\": %ld, \"last_line\": %ld, \"cyclomatic\": %ld}",
+        hotspots[i].function->first_line, hotspots[i].function->last_line,
+        hotspots[i].function->cyclomatic);
+    }
+    fprintf(out, "%s]\n}\n", (hotspot_count == 0) ? "" : "\n  ");
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void write_csv(FILE *out, const FileResult *files, size_t count,       */
+/*   const long *histogram, const Hotspot *hotspots, size_t hotspot_count); */
+/*                                                                        */
+/*      This function writes the report as a CSV table.                   */
+/*------------------------------------------------------------------------*/
+
+PRIVATE
+void write_csv(
+  FILE *out, const FileResult *files, size_t count,
+  const long *histogram, const Hotspot *hotspots, size_t hotspot_count)
+  {
+    const FnResult *function;
+    size_t i, j;
+    long   functions = 0;
+    long   total = 0;
+    long   file_total;
+
+    fprintf(out, "kind,file,function,first_line,last_line,cyclomatic,cases,depth,count\n");
+    for (i = 0; i < count; i++) {
+      file_total = 0;
+      for (j = 0; j < files[i].count; j++) {
+        function = &files[i].functions[j];
+        fprintf(out, "function,");
+        ResPutCsv(out, files[i].name);
+        putc(',', out);
+        ResPutCsv(out, function->name);
+        fprintf(out, ",%ld,%ld,%ld,%ld,%ld,\n",
+          function->first_line, function->last_line, function->cyclomatic,
+          function->cases, function->depth);
+        file_total += function->cyclomatic;
+      }
+      fprintf(out, "file,");
+      ResPutCsv(out, files[i].name);
+      putc(',', out);
+      if (files[i].error != NULL) ResPutCsv(out, files[i].error);
+      fprintf(out, ",,,%ld,,,%lu\n", file_total, (unsigned long)files[i].count);
+      functions += (long)files[i].count;
+      total += file_total;
+    }
+    for (i = 0; i < BAND_COUNT; i++)
+      fprintf(out, "histogram,,%s,,,,,,%ld\n", band_name[i], histogram[i]);
+    for (i = 0; i < hotspot_count; i++) {
+      fprintf(out, "hotspot,");
+      ResPutCsv(out, hotspots[i].file->name);
+      putc(',', out);
+      ResPutCsv(out, hotspots[i].function->name);
+      fprintf(out, ",%ld,%ld,%ld,%ld,%ld,%lu\n",
+        hotspots[i].function->first_line, hotspots[i].function->last_line,
+        hotspots[i].function->cyclomatic, hotspots[i].function->cases,
+        hotspots[i].function->depth, (unsigned long)(i + 1));
+    }
+    fprintf(out, "total,,,,,%ld,,,%ld\n", total, functions);
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void ResWrite(FILE *out, const FileResult *files, size_t count,        */
+/*   int format, size_t top);                                             */
+/*                                                                        */
+/*      This function writes the report for a list of files in the given  */
+/*      format (RES_JSON or RES_CSV). At most top hotspots are listed.    */
+/*------------------------------------------------------------------------*/
+
+PUBLIC
+void ResWrite(FILE *out, const FileResult *files, size_t count, int format, size_t top)
+  {
+    long     histogram[BAND_COUNT];
+    Hotspot *hotspots;
+    size_t   hotspot_count;
+    size_t   i, j;
+
+    memset(histogram, 0, sizeof(histogram));
+    for (i = 0; i < count; i++) {
+      for (j = 0; j < files[i].count; j++) histogram[band(files[i].functions[j].cyclomatic)]++;
+    }
+    if ((hotspots = (Hotspot *)malloc((top + 1) * sizeof(Hotspot))) == NULL) top = 0;
+    hotspot_count = find_hotspots(files, count, hotspots, top);
+
+    if (format == RES_CSV) write_csv(out, files, count, histogram, hotspots, hotspot_count);
+    else write_json(out, files, count, histogram, hotspots, hotspot_count);
+    free(hotspots);
+    return;
+  }
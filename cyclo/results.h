@@ -0,0 +1,71 @@
+/*****************************************************************************
+FILE     : results.h
+CONTENTS : Collecting and reporting the functions of many files.
+PROGRAMMER    : Peter Chapin
+
+This file contains the interface to the module that keeps the results of
+scanning a file (one FnResult for each function found) and writes the
+report for a whole project. Each FileResult is used by only one thread at a
+time so files can be scanned in parallel; the report is written after all
+of them are done.
+
+See RESULTS.C for more information.
+
+*****************************************************************************/
+
+#ifndef RESULTS_H
+#define RESULTS_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "fnscan.h"
+
+#define RES_BLOCK_SIZE 65536  /* Size of the work area for ResScan().     */
+
+/* Report formats. */
+#define RES_JSON 0
+#define RES_CSV  1
+
+/* One function. */
+typedef struct {
+  char       *name;
+  long        first_line;
+  long        last_line;
+  long        cyclomatic;
+  long        cases;
+  long        depth;
+} FnResult;
+
+/* One file. */
+typedef struct {
+  char       *name;
+  FnResult   *functions;      /* In the order they appear in the file.    */
+  size_t      count;
+  size_t      size;
+  const char *error;          /* What went wrong with the file, or NULL.  */
+  uint64_t    hash;           /* Hash of the text (see CACHE.C) and its   */
+  size_t      length;         /*   length, if hashed is YES.              */
+  boolean     hashed;
+  boolean     cached;         /* =YES if the results came from the cache. */
+} FileResult;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern void    ResInit(FileResult *, const char *);
+extern boolean ResAdd(FileResult *, const FnInfo *);
+extern void    ResScan(FileResult *, FILE *, char *);
+extern void    ResScanText(FileResult *, const char *, size_t);
+extern void    ResFree(FileResult *);
+extern void    ResWrite(FILE *, const FileResult *, size_t, int, size_t);
+extern boolean ResIsSource(const char *);
+extern void    ResPutJson(FILE *, const char *);
+extern void    ResPutCsv(FILE *, const char *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -4,21 +4,64 @@ CONTENTS : C/C++ comment stripping functions.
 PROGRAMMER    : Peter Chapin
 
 This file contains the interface to a module that recognizes comments and
-quoted strings in C or C++ source code. To use it, you must first send
+quoted strings in C or C++ source code. There are two ways to use it.
+
+The block interface classifies whole blocks of source text held in memory.
+All of its state is in a CmtScanner object supplied by the caller so any
+number of files can be scanned at once (on different threads if desired).
+CmtScanSpan() walks a block a run at a time and reports each run as a span
+(kind, offset, length) of the caller's buffer along with its line number.
+
+The original interface is still available. To use it, you must first send
 CmtScanInit() a pointer to a function that reads the source. Then, calls to
 CmtScanGetChar() will return characters from the file, but it will set some
-global variables to indicate what that character is part of. See CMTSCAN.C
-for more information.
+global variables to indicate what that character is part of. This interface
+is not re-entrant.
+
+See CMTSCAN.C for more information.
 
 *****************************************************************************/
 
 #ifndef SCANNERS_H
 #define SCANNERS_H
 
+#include <stddef.h>
+
+/* The kinds of characters reported by the block interface. */
+#define CMT_CODE        0   /* Ordinary code.                          */
+#define CMT_C_COMMENT   1   /* Part of a C comment, with delimiters.   */
+#define CMT_CPP_COMMENT 2   /* Part of a C++ comment, with // and \n.  */
+#define CMT_STRING      3   /* Part of a string literal, with quotes.  */
+#define CMT_CHAR        4   /* Part of a character constant.           */
+
+typedef struct {
+  int     state;              /* Where the FSM is. Private to CMTSCAN.C.  */
+  int     pending;            /* Scanned chars not yet reported. Private. */
+  int     pending_kind;       /* Kind of those chars. Private.            */
+  long    line;               /* Line of the next char (see CmtScanSpan). */
+  boolean OpenCommentError;   /* =YES if input ended inside a comment.    */
+  boolean OpenStringError;    /* =YES if input ended inside a string.     */
+  boolean OpenCharError;      /* =YES if input ended inside a char const. */
+} CmtScanner;
+
+/* A run of characters of one kind, as reported by CmtScanSpan(). */
+typedef struct {
+  int     kind;               /* One of the CMT_xxx values.               */
+  size_t  offset;             /* Position of the first char in the block. */
+  size_t  length;             /* Number of chars in the run (never zero). */
+  long    line;               /* Line number of the first char.           */
+  long    newlines;           /* Number of new-lines in the run.          */
+} CmtSpan;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+extern void    CmtScanReset(CmtScanner *);
+extern size_t  CmtScanBlock(CmtScanner *, const char *, size_t, unsigned char *, boolean);
+extern size_t  CmtScanRun(CmtScanner *, const char *, size_t, int *, boolean);
+extern boolean CmtScanSpan(CmtScanner *, const char *, size_t, size_t *, CmtSpan *, boolean);
+
 extern void CmtScanInit(int (*)(void));
 extern int  CmtScanGetChar(void);
 
@@ -8,10 +8,11 @@
 #include <iostream>
 #include <cstdlib>
 #include <cstring>
+#include <string>
 
-#include "filename.hpp"
-#include "filescan.hpp"
+#include "discover.hpp"
 #include "get_switch.hpp"
+#include "include_graph.hpp"
 #include "misc.hpp"
 #include "output.hpp"
 #include "record_f.hpp"
@@ -26,23 +27,62 @@ const int BUFFER_SIZE = 80;
 
 static int continuation_character = '\\';
 static const char *include_list = NULL;
+static const char *root_list    = NULL;
+static const char *pattern_list = "*.c;*.cpp";
+static const char *ignore_list  = NULL;
 // static char *object_extension = "obj";
 
 static SwitchInfo switch_table[] = {
   { 'c', chr_switch, &continuation_character, NULL,
     "Continuation character used in makefile (default = '\\')" },
   { 'I', str_switch, NULL, &include_list,
-    "Semicolon delimited list of directory names for include files" }
+    "Semicolon delimited list of directory names for include files" },
+  { 'R', str_switch, NULL, &root_list,
+    "Semicolon delimited list of directories to search for sources (replaces lst_file)" },
+  { 'p', str_switch, NULL, &pattern_list,
+    "Semicolon delimited list of source name patterns used with -R (default = *.c;*.cpp)" },
+  { 'x', str_switch, NULL, &ignore_list,
+    "Semicolon delimited list of name patterns to skip when using -R" }
 };
 static int switch_table_size = sizeof( switch_table )/sizeof( SwitchInfo );
 
+/*====================================*/
+/*           Progress Display           */
+/*====================================*/
+
+/*----------------------------------------------------------------------------
+The depend program writes the makefile text as usual but also shows the name
+of each file as it is scanned, indented to show the nesting of the headers.
+----------------------------------------------------------------------------*/
+
+class ProgressWriter : public MakefileWriter {
+
+  public:
+    explicit ProgressWriter( char continuation ) : MakefileWriter( continuation ) { }
+
+    void scanning( const string &name, int nesting_level )
+    {
+        for( int i = 0; i < nesting_level; i++ ) cout << "  ";
+        cout << "Scanning " << name << "..." << endl;
+    }
+
+    void open_failed( const string &name, int nesting_level )
+    {
+        for( int i = 0; i < nesting_level; i++ ) cout << "  ";
+        cout << "!!! Can't open " << name << " for input. Skipping..." << endl;
+    }
+};
+
 /*==================================*/
 /*           Main Program           */
 /*==================================*/
 
 /*----------------------------------------------------------------------------
 The following function loops over all lines in the dependency file emiting
-a dependency list for each one.
+a dependency list for each one. If -R is used, the sources are instead found
+by searching the given directories. Each source is scanned as soon as it is
+found while the search continues in the background; the dependency lists are
+held and written in order of the source names once the search is over.
 ----------------------------------------------------------------------------*/
 
 int main( int argc, char *argv[] )
@@ -50,6 +90,7 @@ int main( int argc, char *argv[] )
     int exit_code = 0;  // =1 if error.
 
     argc = get_switchs( argc, argv, switch_table, switch_table_size );
+    ProgressWriter output( static_cast<char>( continuation_character ) );
 
     // Print credits.
     #if eOPSYS == eOS2
@@ -65,13 +106,18 @@ int main( int argc, char *argv[] )
             "Public Domain Software by Peter Chapin\n" << endl;
     #endif
 
+    // The list file is not used if the sources are found by searching.
+    int output_index = ( root_list == NULL ) ? 2 : 1;
+
     // Check usage.
-    if( argc != 3 ) {
+    if( argc != output_index + 1 ) {
         cerr <<
             "Wrong number of arguments.\n"
             "\n"
             "Usage: DEPEND [switches] lst_file out_file\n"
-            "  Where lst_file is the name of a file contain source names and\n"
+            "       DEPEND [switches] -Rroot_dirs out_file\n"
+            "  Where lst_file is the name of a file contain source names,\n"
+            "        root_dirs is a list of directories to search for sources, and\n"
             "        out_file is the name of the file to write." << endl;
         cerr << "\nLegal switches are:" << endl;
         print_usage(switch_table, switch_table_size, cerr);
@@ -79,31 +125,37 @@ int main( int argc, char *argv[] )
     }
 
     // Try to open the output file.
-    else if( !open( argv[2] ) ) {
-        cerr << "Error: Can't open file " << argv[2] << " for output." << endl;
+    else if( !output.open( argv[output_index] ) ) {
+        cerr << "Error: Can't open file " << argv[output_index] << " for output." << endl;
         exit_code = 1;
     }
 
     else {
-        char **fields;
-
-        // Register the include file names with module that handles such things.
-        set_directory_list( include_list );
-
-        // Open the master input file.
-        RecordFile list_file( argv[1], RecordFile::DEFAULT, BUFFER_SIZE, '#', " \t" );
-        if( list_file.is_ok ) {
+        // Register the include file names with the scanner.
+        IncludeGraph graph( include_list );
+
+        // Search for the sources if asked, scanning each one as it turns up. The walk finds them
+        // in no fixed order, so the lists are held and written sorted by name at the end.
+        if( root_list != NULL ) {
+            SourceWalker walker( root_list, pattern_list, ignore_list );
+            string       name;
+
+            output.hold_lists( );
+            while( walker.get_name( name ) ) graph.scan( name, output );
+            output.write_held_lists( );
+        }
 
-            // Read lines from the dependency file and handle each one.
-            while( ( fields = list_file.get_line( ) ) != NULL ) {
+        // Otherwise open the master input file.
+        else {
+            char **fields;
+            RecordFile list_file( argv[1], RecordFile::DEFAULT, BUFFER_SIZE, '#', " \t" );
+            if( list_file.is_ok ) {
 
-                // Skip blank lines.
-                if( list_file.get_length( ) != 0 ) {
+                // Read lines from the dependency file and handle each one.
+                while( ( fields = list_file.get_line( ) ) != NULL ) {
 
-                    // Write out the full dependency list for this file.
-                    start( fields[0] );
-                    handle_file( fields[0] );
-                    flush( continuation_character );
+                    // Skip blank lines. Otherwise write out the full dependency list.
+                    if( list_file.get_length( ) != 0 ) graph.scan( fields[0], output );
                 }
             }
         }
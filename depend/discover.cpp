@@ -0,0 +1,217 @@
+/*! \file    discover.cpp
+ *  \brief   Implementation of recursive source file discovery.
+ *  \author  Peter Chapin <chapinp@proton.me>
+ */
+
+#include "environ.hpp"
+
+#include <cstring>
+#include <iostream>
+
+#if eOPSYS == ePOSIX
+#include <dirent.h>
+#include <fnmatch.h>
+#include <sys/stat.h>
+#endif
+
+#include "discover.hpp"
+
+using namespace std;
+
+// The following function breaks a semicolon delimited list into its components. Empty
+// components are dropped. A NULL list produces an empty vector.
+
+static vector<string> split_list( const char *list )
+{
+    vector<string> result;
+
+    if( list == NULL ) return result;
+    const char *start = list;
+    while( true ) {
+        const char *end = strchr( start, ';' );
+        if( end == NULL ) end = strchr( start, '\0' );
+        if( end != start ) result.push_back( string( start, end ) );
+        if( *end == '\0' ) break;
+        start = end + 1;
+    }
+    return result;
+}
+
+// The constructor queues the root directories and starts the workers. The walk begins at once.
+
+SourceWalker::SourceWalker(
+  const char *root_list,     // Directories to search.
+  const char *pattern_list,  // Glob patterns for source files, for example "*.c;*.cpp".
+  const char *ignore_list,   // Glob patterns for files and directories to skip. Can be NULL.
+  int   worker_count )
+  : patterns( split_list( pattern_list ) ),
+    ignores( split_list( ignore_list ) ),
+    busy_count( 0 ),
+    done( false )
+{
+    vector<string> roots = split_list( root_list );
+    directories.insert( directories.end( ), roots.begin( ), roots.end( ) );
+
+    if( directories.empty( ) ) {
+        done = true;
+        return;
+    }
+
+    if( worker_count <= 0 ) worker_count = static_cast<int>( thread::hardware_concurrency( ) );
+    if( worker_count <= 0 ) worker_count = 2;
+    for( int i = 0; i < worker_count; ++i ) {
+        workers.push_back( thread( &SourceWalker::worker, this ) );
+    }
+}
+
+// The destructor waits for the workers. If the caller stops calling get_name() early the rest of
+// the walk is still completed (and discarded) before the destructor returns.
+
+SourceWalker::~SourceWalker( )
+{
+    for( vector<thread>::iterator p = workers.begin( ); p != workers.end( ); ++p ) {
+        p->join( );
+    }
+}
+
+// The following function returns the next source file name. Names come out in the order they
+// are discovered, which depends on the timing of the workers.
+
+bool SourceWalker::get_name( string &name )
+{
+    unique_lock<mutex> guard( lock );
+
+    while( names.empty( ) && !done ) name_ready.wait( guard );
+    if( names.empty( ) ) return false;
+    name = names.front( );
+    names.pop_front( );
+    return true;
+}
+
+// Each worker repeatedly takes a directory off the shared queue and scans it. The walk is over
+// when the queue is empty and no worker is busy (a busy worker might still queue more
+// directories).
+
+void SourceWalker::worker( )
+{
+    unique_lock<mutex> guard( lock );
+
+    while( true ) {
+        while( directories.empty( ) && busy_count != 0 ) work_ready.wait( guard );
+        if( directories.empty( ) ) break;
+
+        string directory = directories.front( );
+        directories.pop_front( );
+        ++busy_count;
+        guard.unlock( );
+
+        scan_directory( directory );
+
+        guard.lock( );
+        --busy_count;
+        if( directories.empty( ) && busy_count == 0 ) {
+            done = true;
+            name_ready.notify_all( );
+        }
+        work_ready.notify_all( );
+    }
+}
+
+// The following function returns true if the given name matches any of the given patterns.
+
+bool SourceWalker::matches( const string &name, const vector<string> &patterns )
+{
+    for( vector<string>::const_iterator p = patterns.begin( ); p != patterns.end( ); ++p ) {
+        #if eOPSYS == ePOSIX
+        if( fnmatch( p->c_str( ), name.c_str( ), 0 ) == 0 ) return true;
+        #else
+        if( *p == name ) return true;
+        #endif
+    }
+    return false;
+}
+
+#if eOPSYS == ePOSIX
+
+enum EntryType { OTHER_ENTRY, DIRECTORY_ENTRY, FILE_ENTRY, LINK_ENTRY };
+
+// The following function classifies a directory entry using lstat(). It is only used when the
+// file system doesn't fill in d_type.
+
+static EntryType classify( const string &path )
+{
+    struct stat file_info;
+
+    if( lstat( path.c_str( ), &file_info ) != 0 ) return OTHER_ENTRY;
+    if( S_ISDIR( file_info.st_mode ) ) return DIRECTORY_ENTRY;
+    if( S_ISREG( file_info.st_mode ) ) return FILE_ENTRY;
+    if( S_ISLNK( file_info.st_mode ) ) return LINK_ENTRY;
+    return OTHER_ENTRY;
+}
+
+#endif
+
+// The following function reads one directory. The type of each entry is taken from d_type when
+// the file system provides it so that no stat() call is needed. Symbolic links are followed to
+// regular files but never to directories; that keeps the walk from looping. Everything found is
+// queued in one step so the lock is taken only once per directory.
+
+void SourceWalker::scan_directory( const string &directory )
+{
+    #if eOPSYS == ePOSIX
+    vector<string> found_directories;
+    vector<string> found_names;
+
+    DIR *handle = opendir( directory.c_str( ) );
+    if( handle == NULL ) {
+        lock_guard<mutex> guard( lock );
+        cerr << "!!! Can't open directory " << directory << ". Skipping..." << endl;
+        return;
+    }
+
+    struct dirent *entry;
+    while( ( entry = readdir( handle ) ) != NULL ) {
+        const char *entry_name = entry->d_name;
+        if( strcmp( entry_name, "." ) == 0 || strcmp( entry_name, ".." ) == 0 ) continue;
+
+        // Don't decorate names found in the current directory with a useless "./".
+        string path = ( directory == "." ) ? string( entry_name ) : directory + "/" + entry_name;
+        if( matches( entry_name, ignores ) || matches( path, ignores ) ) continue;
+
+        EntryType type = OTHER_ENTRY;
+        #ifdef _DIRENT_HAVE_D_TYPE
+        if( entry->d_type == DT_DIR ) type = DIRECTORY_ENTRY;
+        else if( entry->d_type == DT_REG ) type = FILE_ENTRY;
+        else if( entry->d_type == DT_LNK ) type = LINK_ENTRY;
+        else if( entry->d_type == DT_UNKNOWN ) type = classify( path );
+        #else
+        type = classify( path );
+        #endif
+
+        // Only now is a stat() needed, and only for links.
+        if( type == LINK_ENTRY ) {
+            struct stat file_info;
+            if( stat( path.c_str( ), &file_info ) == 0 && S_ISREG( file_info.st_mode ) ) {
+                type = FILE_ENTRY;
+            }
+        }
+
+        if( type == DIRECTORY_ENTRY ) found_directories.push_back( path );
+        else if( type == FILE_ENTRY && matches( entry_name, patterns ) ) {
+            found_names.push_back( path );
+        }
+    }
+    closedir( handle );
+
+    lock_guard<mutex> guard( lock );
+    directories.insert( directories.end( ), found_directories.begin( ), found_directories.end( ) );
+    if( !found_names.empty( ) ) {
+        names.insert( names.end( ), found_names.begin( ), found_names.end( ) );
+        name_ready.notify_one( );
+    }
+    #else
+    lock_guard<mutex> guard( lock );
+    cerr << "!!! Directory search is not supported on this system. Skipping "
+         << directory << "..." << endl;
+    #endif
+}
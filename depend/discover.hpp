@@ -0,0 +1,62 @@
+/*! \file    discover.hpp
+ *  \brief   Recursive discovery of source files.
+ *  \author  Peter Chapin <chapinp@proton.me>
+ */
+
+#ifndef DISCOVER_HPP
+#define DISCOVER_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*!
+ * This class walks one or more directory trees looking for source files with names that match
+ * a list of glob patterns. The walk is done by several worker threads in parallel. Names are
+ * handed out by get_name() as soon as they are found so the caller can scan each source file
+ * while the rest of the walk is still in progress.
+ *
+ * All lists given to the constructor are semicolon delimited (like the -I switch). Ignore
+ * patterns are matched against both the simple name and the path of each directory entry.
+ * Matching directories are not entered and matching files are not reported.
+ */
+class SourceWalker {
+
+  public:
+    SourceWalker(                   // Starts the worker threads.
+      const char *root_list,
+      const char *pattern_list,
+      const char *ignore_list,
+      int   worker_count = 0 );     // Zero means use one worker per processor.
+   ~SourceWalker( );                // Waits for the workers to finish.
+
+    bool get_name( std::string &name );
+      // Blocks until another source file has been found. Returns false when the walk is over.
+
+  private:
+    void worker( );
+    void scan_directory( const std::string &directory );
+    static bool matches( const std::string &name, const std::vector<std::string> &patterns );
+
+    std::vector<std::string> patterns;     // Names of interesting files.
+    std::vector<std::string> ignores;      // Names of files and directories to skip.
+
+    std::mutex               lock;         // Protects everything below.
+    std::condition_variable  work_ready;   // Signaled when directories are queued or done.
+    std::condition_variable  name_ready;   // Signaled when names are queued or done.
+    std::deque<std::string>  directories;  // Directories waiting to be scanned.
+    std::deque<std::string>  names;        // Source files waiting to be handed out.
+    int                      busy_count;   // Number of workers currently scanning.
+    bool                     done;         // =true when the walk is finished.
+
+    std::vector<std::thread> workers;
+
+    // Not copyable.
+    SourceWalker( const SourceWalker & );
+    SourceWalker &operator=( const SourceWalker & );
+};
+
+#endif
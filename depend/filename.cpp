@@ -5,9 +5,8 @@
 
 #include "environ.hpp"
 
+#include <cstring>
 #include <list>
-#include <stdio.h>
-#include <string.h>
 #include <string>
 
 #if eOPSYS == ePOSIX
@@ -23,12 +22,6 @@
 
 using namespace std;
 
-/*=================================*/
-/*           Global Data           */
-/*=================================*/
-
-static list<string> directory_list;
-
 /*==========================================*/
 /*           Function Definitions           */
 /*==========================================*/
@@ -36,46 +29,51 @@ static list<string> directory_list;
 // The following function returns true if the given string does not end with a directory
 // delimiter character. Otherwise it returns false.
 
-bool no_trail( char *buffer )
+static bool no_trail( const string &buffer )
 {
-    if( strlen( buffer ) == 0 ) return true;
+    if( buffer.empty( ) ) return true;
 
-    char *end_pointer = strchr( buffer, '\0' ) - 1;
-
-    #if eOPSYS == pPOSIX
-      if( *end_pointer != '/' ) return true;
+    #if eOPSYS == ePOSIX
+      if( buffer[buffer.length( ) - 1] != '/' ) return true;
     #else
-      if( *end_pointer != '\\' ) return true;
+      if( buffer[buffer.length( ) - 1] != '\\' ) return true;
     #endif
     return false;
 }
 
+// The constructor installs the initial list of directory names (see set() below).
+
+DirectoryList::DirectoryList( const char *new_directory_list )
+{
+    set( new_directory_list );
+}
+
 // The following function takes a semicolon delimited list of directory names and puts the names
-// into the String_List named directory_list above. This function does not append the
-// directories to the list. If there were already names in the list, they are erased first. This
-// function also inserts a null name as the first entry. This function modifies the string given
-// to it as an argument.
+// into the directory list. This function does not append the directories to the list. If there
+// were already names in the list, they are erased first. This function also inserts a null name
+// as the first entry.
 
-void set_directory_list( const char *new_directory_list )
+void DirectoryList::set( const char *new_directory_list )
 {
     // Make sure the list is empty.
-    directory_list.clear( );
+    directories.clear( );
 
-    // Install a null directory name (makes logic of Match_Name easier).
-    directory_list.push_back( "" );
+    // Install a null directory name (makes logic of match_name easier).
+    directories.push_back( "" );
 
     // If we really didn't get anything in new_directory_list, then we are done.
     if( new_directory_list == NULL ) return;
 
     // Install ";" delimited directory names into the list.
-    char *temporary_directory_list = new char[strlen( new_directory_list ) + 1];
-    strcpy( temporary_directory_list, new_directory_list );
-    char *directory_name = strtok( temporary_directory_list, ";" );
-    while( directory_name != NULL ) {
-        directory_list.push_back( directory_name );
-        directory_name = strtok( NULL, ";" );
+    const char *directory_name = new_directory_list;
+    while( *directory_name != '\0' ) {
+        const char *end_pointer = strchr( directory_name, ';' );
+        if( end_pointer == NULL ) end_pointer = strchr( directory_name, '\0' );
+        if( end_pointer != directory_name ) {
+            directories.push_back( string( directory_name, end_pointer ) );
+        }
+        directory_name = ( *end_pointer == '\0' ) ? end_pointer : end_pointer + 1;
     }
-    delete [] temporary_directory_list;
     return;
 }
 
@@ -84,35 +82,22 @@ void set_directory_list( const char *new_directory_list )
 // directory list. If no file exists with the given name, the orignal string is returned. If the
 // given name starts with a backslash, the directory list is not used.
 
-char *match_name( char *name )
-  {
-    // Holds final matched name.
-    static char buffer[FILENAME_LENGTH+1];
-
+string DirectoryList::match_name( const string &name ) const
+{
     // If name starts with a directory delimiter character, don't try to append directory names
     // on it.
     #if eOPSYS == ePOSIX
-      if( *name == '/' ) {
-          strcpy( buffer, name );
-          return buffer;
-      }
+      if( !name.empty( ) && name[0] == '/' ) return name;
     #else
-      if( *name == '\\' ) {
-          strcpy( buffer, name );
-          return buffer;
-      }
+      if( !name.empty( ) && name[0] == '\\' ) return name;
     #endif
 
     // If name starts with a drive specifier, don't try to append directory names on it.
-    if( name[0] != '\0' && name[1] == ':' ) {
-        strcpy( buffer, name );
-        return buffer;
-    }
+    if( name.length( ) >= 2 && name[1] == ':' ) return name;
 
     // Loop through all the directory names to see if an existing file name can be found.
-    bool match_found = false;
-    for( list<string>::const_iterator current_directory = directory_list.begin();
-         current_directory != directory_list.end();
+    for( list<string>::const_iterator current_directory = directories.begin();
+         current_directory != directories.end();
          ++current_directory ) {
 
       #if eOPSYS == ePOSIX
@@ -120,41 +105,34 @@ char *match_name( char *name )
       #elif eOPSYS != eWIN32
         struct find_t file_info;
       #endif
-      
 
         // Copy directory prefix into buffer. Append a directory delimiter only if there's
         // something there and only if there isn't a trailing directory delimiter allready.
         //
-        strcpy(buffer, current_directory->c_str( ) );
+        string buffer( *current_directory );
       #if eOPSYS == ePOSIX
-        if( strlen( buffer ) != 0 && no_trail( buffer ) ) strcat( buffer, "/" );
+        if( buffer.length( ) != 0 && no_trail( buffer ) ) buffer += "/";
       #else
-        if( strlen( buffer ) != 0 && no_trail( buffer ) ) strcat( buffer, "\\" );
+        if( buffer.length( ) != 0 && no_trail( buffer ) ) buffer += "\\";
       #endif
-        strcat( buffer, name );
+        buffer += name;
 
         // See if the file exists.
         #if eOPSYS == ePOSIX
-        if( stat( buffer, &file_info ) == 0 && S_ISREG( file_info.st_mode ) ) {
-            match_found = true;
-            break;
+        if( stat( buffer.c_str( ), &file_info ) == 0 && S_ISREG( file_info.st_mode ) ) {
+            return buffer;
         }
         #elif eOPSYS == eWIN32
-        if( GetFileAttributes( buffer ) != 0xFFFFFFFFU ) {
-            match_found = true;
-            break;
+        if( GetFileAttributes( buffer.c_str( ) ) != 0xFFFFFFFFU ) {
+            return buffer;
         }
         #else
-        if( _dos_findfirst( buffer, _A_NORMAL, &file_info ) == 0 ) {
-            match_found = true;
-            break;
+        if( _dos_findfirst( buffer.c_str( ), _A_NORMAL, &file_info ) == 0 ) {
+            return buffer;
         }
         #endif
     }
 
-    // If we found a match return it, otherwise return the original.
-    if( !match_found ) strcpy( buffer, name );
-
-    return buffer;
+    // We didn't find a match so return the original.
+    return name;
 }
-
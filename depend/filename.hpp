@@ -6,18 +6,29 @@
 #ifndef FILENAME_HPP
 #define FILENAME_HPP
 
-const int FILENAME_LENGTH = 256;
+#include <list>
+#include <string>
 
-void set_directory_list( const char *new_directory_list );
-  // This function takes a semicolon delimited list of directory names and inserts the names
-  // into an internal list for later use.
+/*!
+ * This class holds the list of directories that are searched for include files. Once the list
+ * is set, match_name() only reads it, so a single object can be shared by several threads.
+ */
+class DirectoryList {
 
-char *match_name( char *name );
-  // This function takes a simple filename and returns either the name it's been given or the
-  // "true" filename with the directory path prepended. The prepending of a directory path
-  // occurs if the file resides in one of the directories in the current directory list (see
-  // above). The pointer returned by this function points at internal, static storage.
+  public:
+    explicit DirectoryList( const char *new_directory_list = NULL );
 
-#endif
+    void set( const char *new_directory_list );
+      // This function takes a semicolon delimited list of directory names and inserts the names
+      // into an internal list for later use. Any names already in the list are removed.
 
+    std::string match_name( const std::string &name ) const;
+      // This function takes a simple filename and returns either the name it's been given or
+      // the "true" filename with the directory path prepended. The prepending of a directory
+      // path occurs if the file resides in one of the directories in the list (see above).
 
+  private:
+    std::list<std::string> directories;
+};
+
+#endif
@@ -1,13 +0,0 @@
-/*! \file    filescan.hpp
- *  \brief   Declarations of functions that do the actual source file scanning.
- *  \author  Peter Chapin <chapinp@proton.me>
- */
-
-#ifndef FILESCAN_HPP
-#define FILESCAN_HPP
-
-extern void handle_file( char *name );
-  // This function writes out the dependencies for the specified file.
-
-#endif
-
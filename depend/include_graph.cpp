@@ -0,0 +1,105 @@
+/*! \file    include_graph.cpp
+ *  \brief   Implementation of the reentrant dependency scanner.
+ *  \author  Peter Chapin <chapinp@proton.me>
+ */
+
+#include "environ.hpp"
+
+#include <fstream>
+#include <set>
+
+#include "include_graph.hpp"
+#include "linescan.hpp"
+
+using namespace std;
+
+// Everything that changes during a single scan lives here rather than in the IncludeGraph.
+struct IncludeGraph::ScanState {
+    DependencySink &sink;
+    set<string>     seen;      // Headers already reported for the current source.
+
+    explicit ScanState( DependencySink &s ) : sink( s ) { }
+};
+
+// This sink collects the names for dependencies().
+namespace {
+
+    class ListSink : public DependencySink {
+      public:
+        explicit ListSink( vector<string> &n ) : names( n ) { }
+
+        void begin_source( const string & ) { }
+        void dependency( const string &name ) { names.push_back( name ); }
+        void end_source( const string & ) { }
+
+      private:
+        vector<string> &names;
+    };
+
+}
+
+IncludeGraph::IncludeGraph( const char *directory_list ) :
+    directories( directory_list )
+{ }
+
+void IncludeGraph::set_directory_list( const char *directory_list )
+{
+    directories.set( directory_list );
+}
+
+// The following function writes out the dependencies of one primary source file.
+
+void IncludeGraph::scan( const string &source, DependencySink &sink ) const
+{
+    ScanState state( sink );
+
+    sink.begin_source( source );
+    handle_file( source, 0, state );
+    sink.end_source( source );
+}
+
+vector<string> IncludeGraph::dependencies( const string &source ) const
+{
+    vector<string> names;
+    ListSink       sink( names );
+
+    scan( source, sink );
+    return names;
+}
+
+// The following function reads all the lines out of the specified input file and looks for
+// #include directives. Each header that hasn't been seen yet is reported and then scanned in
+// turn, so this function is recursive.
+//
+// Name matching is not done on the top level names. The user will probably specify those names
+// fully anyway. (An older version matched them too, and found that the extra searching made the
+// program fail on the Y source code under OS/2.)
+
+void IncludeGraph::handle_file( const string &name, int nesting_level, ScanState &state ) const
+{
+    ifstream input_file( name.c_str( ) );
+
+    if( !input_file ) {
+        // The error appears where the name would go, one level deeper than the includer.
+        state.sink.open_failed( name, nesting_level + 1 );
+        return;
+    }
+
+    string line;
+    string header;
+
+    state.sink.scanning( name, nesting_level + 1 );
+    while( getline( input_file, line ) ) {
+        if( !include_name( line, header ) ) continue;
+
+        // Match name to that of an existing file.
+        string file_name = directories.match_name( header );
+
+        if( state.seen.insert( file_name ).second ) {
+
+            // Report the name and then see what headers it further includes.
+            state.sink.dependency( file_name );
+            handle_file( file_name, nesting_level + 1, state );
+        }
+    }
+}
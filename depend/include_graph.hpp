@@ -0,0 +1,67 @@
+/*! \file    include_graph.hpp
+ *  \brief   Declaration of the reentrant dependency scanner.
+ *  \author  Peter Chapin <chapinp@proton.me>
+ *
+ * This is the interface to libdepend. A program that wants header dependencies can link with
+ * the library and call IncludeGraph::scan() directly rather than running the depend program and
+ * reading its output file. No global state is used, so several scans can be active at once in
+ * different threads, even on the same IncludeGraph object.
+ */
+
+#ifndef INCLUDE_GRAPH_HPP
+#define INCLUDE_GRAPH_HPP
+
+#include <string>
+#include <vector>
+
+#include "filename.hpp"
+
+/*!
+ * The scanner reports what it finds to an object derived from this class. The functions are
+ * called in the order the information is found: begin_source(), then dependency() once for each
+ * distinct header (in the order the headers are first included), then end_source(). The
+ * scanning() and open_failed() functions are progress notices; by default they do nothing.
+ */
+class DependencySink {
+
+  public:
+    virtual ~DependencySink( ) { }
+
+    virtual void begin_source( const std::string &name ) = 0;
+    virtual void dependency( const std::string &name ) = 0;
+    virtual void end_source( const std::string &name ) = 0;
+
+    virtual void scanning( const std::string & /* name */, int /* nesting_level */ ) { }
+    virtual void open_failed( const std::string & /* name */, int /* nesting_level */ ) { }
+};
+
+/*!
+ * This class computes the header dependencies of source files. Only headers named in quoted
+ * #include directives are followed. Header names are looked up in the directory list as with
+ * the -I switch of the depend program.
+ */
+class IncludeGraph {
+
+  public:
+    explicit IncludeGraph( const char *directory_list = NULL );
+
+    void set_directory_list( const char *directory_list );
+      // Replaces the semicolon delimited list of include directories. This must not be called
+      // while a scan is in progress.
+
+    void scan( const std::string &source, DependencySink &sink ) const;
+      // Scans the named source file and all the headers it includes (recursively), reporting
+      // the results to the sink.
+
+    std::vector<std::string> dependencies( const std::string &source ) const;
+      // Returns the headers the named source depends on, in the order scan() reports them.
+
+  private:
+    struct ScanState;
+
+    void handle_file( const std::string &name, int nesting_level, ScanState &state ) const;
+
+    DirectoryList directories;
+};
+
+#endif
@@ -5,21 +5,19 @@
 
 #include "environ.hpp"
 
-#include <ctype.h>
-#include <string.h>
+#include <cstring>
 
-#include "filename.hpp"
-#include "filescan.hpp"
 #include "linescan.hpp"
-#include "output.hpp"
+
+using namespace std;
 
 // This function skips leading white space on the string pointed at by 'line'. It then checks
 // for the presence of "#include". If it finds it, the function returns the address of the first
 // non-white space character after the "#include". Otherwise, the function returns NULL.
 
-static char *skip_include( char *line )
+static const char *skip_include( const char *line )
 {
-    char *return_value = NULL;
+    const char *return_value = NULL;
 
     // Scan line, skipping spaces and tabs.
     while( *line  &&  ( *line == ' '  ||  *line == '\t' ) ) line++;
@@ -35,40 +33,30 @@ static char *skip_include( char *line )
     return return_value;
 }
 
-// This function orchestrates the action of the program for each line from each file.
+// This function extracts the name from a line containing a quoted #include.
 
-void handle_line( char *line )
+bool include_name( const string &line, string &name )
 {
-    char *line_pointer;
-    char *end_pointer;
-    char  file_name[FILENAME_LENGTH + 1];
+    const char *line_pointer;
+    const char *end_pointer;
 
     // Do nothing if this line has no #include statement on it.
-    if( ( line_pointer = skip_include( line ) ) != NULL ) {
-
-        // If this is a '<...>' enclosed #include, ignore it.
-        if( *line_pointer == '<' ) return;
-
-        // Advance past the '\"' character.
-        if( *line_pointer ) line_pointer++;
+    if( ( line_pointer = skip_include( line.c_str( ) ) ) == NULL ) return false;
 
-        // Chop off next '\"' character.
-        if( ( end_pointer = strchr( line_pointer, '\"' ) ) != NULL ) *end_pointer = '\0';
+    // If this is a '<...>' enclosed #include, ignore it.
+    if( *line_pointer == '<' ) return false;
 
-        // Why was this being done? It's clearly wrong on Unix systems.
-        // _strlwr( line_pointer );
+    // Advance past the '\"' character.
+    if( *line_pointer ) line_pointer++;
 
-        // Match name to that of an existing file.
-        strcpy( file_name, match_name( line_pointer ) );
-
-        if( !already_scanned( file_name ) ) {
+    // Stop at the next '\"' character.
+    if( ( end_pointer = strchr( line_pointer, '\"' ) ) == NULL ) {
+        end_pointer = strchr( line_pointer, '\0' );
+    }
 
-            // Emit the name into the output file.
-            emit( file_name );
+    // Why was this being done? It's clearly wrong on Unix systems.
+    // _strlwr( line_pointer );
 
-            // See what headers this #included file further includes.
-            handle_file( file_name );
-        }
-    }
-    return;
+    name.assign( line_pointer, end_pointer );
+    return true;
 }
@@ -6,9 +6,11 @@
 #ifndef LINESCAN_HPP
 #define LINESCAN_HPP
 
-extern void handle_line( char *line );
-  // This function figures out if the given line is a #include and, if so, it writes information
-  // into the current dependency list as well as calls handle_file( ) so that this include file
-  // gets scanned.
+#include <string>
+
+extern bool include_name( const std::string &line, std::string &name );
+  // This function figures out if the given line is a #include of a quoted name. If so, it puts
+  // the name (as written, without quotes) into 'name' and returns true. Lines that #include a
+  // '<...>' name are not of interest and return false. The function has no side effects.
 
 #endif
@@ -3,14 +3,11 @@
  *  \author  Peter Chapin <chapinp@proton.me>
  */
 
-#include <cstring>
+#include "environ.hpp"
+
 #include <ctime>
-#include <fstream>
-#include <iostream>
-#include <list>
-#include <string>
+#include <sstream>
 
-#include "filename.hpp"
 #include "output.hpp"
 
 using namespace std;
@@ -19,20 +16,22 @@ using namespace std;
 /*           Global Data           */
 /*=================================*/
 
-static ofstream      output_file;       // File where dependencies are written.
-static list<string> *name_list = NULL;  // Contains list of dependent filenames.
-static int           column_count;      // Counts characters on current line of output.
-static const char   *preamble =         // Printed at top of dependencies.
+static const char *preamble =         // Printed at top of dependencies.
   "# Module dependencies -- Produced with \'depend\' on ";
 
 /*==========================================*/
 /*           Function Definitions           */
 /*==========================================*/
 
+MakefileWriter::MakefileWriter( char continuation_character ) :
+    continuation( continuation_character ),
+    holding( false )
+{ }
+
 // The following function opens the file that will contain the dependency list. The file will be
 // suitable for cut and paste into a makefile.
 
-bool open( char *name )
+bool MakefileWriter::open( const char *name )
 {
     time_t now = time(NULL);
 
@@ -42,110 +41,98 @@ bool open( char *name )
     return true;
 }
 
-// The following function is called whenever a new primary source file is scanned. It prints the
-// start of the dependency list. In particular, the object file name and the source file name
-// itself. This function also initializes the dependency list to an empty state.
+// The following function is called whenever a new primary source file is scanned. It prepares
+// the start of the dependency list. In particular, the object file name and the source file
+// name itself. The object file is named after the base part of the source name; it is assumed
+// to be in the current directory. This function also initializes the dependency list to an
+// empty state.
 
-void start( char *name )
+void MakefileWriter::begin_source( const string &name )
 {
-    char base[FILENAME_LENGTH + 1];
-    char extension[3 + 1];
-
-    // Locate the extension part of the filename.
-    char *end_pointer = strchr( name, '\0' );
-    while( end_pointer != name && *end_pointer != '.' ) end_pointer--;
-    strcpy( extension, end_pointer + 1 );
-
-    // Find the base part of the filename.
-    char *start_pointer = end_pointer - 1;
+    // Locate the extension and base parts of the filename.
     #if eOPSYS == ePOSIX
-      while( start_pointer != name && *start_pointer != '/' && *start_pointer != ':' ) start_pointer--;
+      string::size_type start_index = name.find_last_of( "/:" );
     #else
-      while( start_pointer != name && *start_pointer != '\\' && *start_pointer != ':' ) start_pointer--;
+      string::size_type start_index = name.find_last_of( "\\/:" );
     #endif
-    *end_pointer = '\0';
-    strcpy( base, start_pointer );
-    *end_pointer = '.';
+    start_index = ( start_index == string::npos ) ? 0 : start_index + 1;
+    string::size_type end_index = name.rfind( '.' );
+    if( end_index == string::npos || end_index < start_index ) end_index = name.length( );
+    string base( name, start_index, end_index - start_index );
 
-    // Print out object file name and source file name.
+    // Remember the object file name and source file name.
     #if eOPSYS == ePOSIX
-      output_file << "\n" << base << ".o:\t" << base << "." << extension << " ";
+      target_line = "\n" + base + ".o:\t" + name + " ";
     #else
-      output_file << "\n" << base << ".obj:\t" << base << "." << extension << " ";
+      target_line = "\n" + base + ".obj:\t" + name + " ";
     #endif
-    column_count = 16 + strlen( base ) + strlen( extension );
 
     // Prepare list for filenames.
-    name_list = new list<string>;
+    name_list.clear( );
 }
 
-// This function returns YES if the given filename is already in the dependency list. Checking
-// for this allows the program to skip redundant file reads.
+// The following function adds the given name to the list of dependent files. The scanner never
+// reports the same name twice for one source.
 
-bool already_scanned( char *name )
+void MakefileWriter::dependency( const string &name )
 {
-    // Skip out if there's no name list.
-    if( name_list == NULL ) return false;
-
-    // Search the current list of filenames. Return true if already on list.
-    for( list<string>::const_iterator current_name = name_list->begin();
-         current_name != name_list->end();
-         ++current_name ) {
-
-        if( *current_name == name ) return true;
-    }
-
-    return false;
+    name_list.push_back( name );
 }
 
-// The following function adds the given name (assumed to be complete) to the list of dependent
-// files. It first searchs the list to see if the name is already on it. Names are not added to
-// the list twice.
+// The following function writes the current dependency list to the output file, or keeps it if
+// lists are being held. The list is written in one piece here, rather than a name at a time in
+// dependency(), so that long lists can be wrapped.
 
-void emit( char *name )
+void MakefileWriter::end_source( const string &name )
 {
-    // Skip out if there's no name list.
-    if( name_list == NULL ) return;
+    ostringstream list_text;
 
-    // Search the current list of filenames. Return at once if already on list.
-    if( already_scanned( name ) ) return;
+    // Counts characters on current line of output.
+    string::size_type column_count = 15 + name.length( );
 
-    // There must have been no match. Add the new name.
-    name_list->push_back( name );
-    return;
-}
-
-// The following function writes the current dependency list to the output file. This writing is
-// postponed to this time (rather than being done in emit()) so that multiple copies of the same
-// file are not written.
-
-void flush( char continuation )
-{
-    // Skip out if there's no list.
-    if( name_list == NULL ) return;
+    list_text << target_line;
 
     // Scan over list printing the names as they are found.
-    for( list<string>::const_iterator name = name_list->begin();
-         name != name_list->end();
-         ++name ) {
+    for( vector<string>::const_iterator current_name = name_list.begin( );
+         current_name != name_list.end( );
+         ++current_name ) {
 
         // Output name and advance counter.
-        output_file << *name << " ";
-        column_count += name->length( ) + 1;
+        list_text << *current_name << " ";
+        column_count += current_name->length( ) + 1;
 
         // Adjust column count, wrapping line if necessary.
         if( column_count > 95 ) {
-            output_file << continuation << "\n\t";
+            list_text << continuation << "\n\t";
             column_count = 8;
         }
     }
 
     // Be sure we're starting on a fresh line for the next dependency list.
-    output_file << "\n";
+    list_text << "\n";
+
+    if( holding ) held.insert( make_pair( name, list_text.str( ) ) );
+    else output_file << list_text.str( );
 
     // Erase the current list.
-    delete name_list;
-    name_list = NULL;
+    name_list.clear( );
+}
+
+// The following function causes the lists finished after it to be kept by end_source().
 
-    return;
+void MakefileWriter::hold_lists( )
+{
+    holding = true;
+}
+
+// The following function writes the kept lists in order of their source names (a multimap keeps
+// its keys sorted) and stops keeping them.
+
+void MakefileWriter::write_held_lists( )
+{
+    for( multimap<string, string>::const_iterator p = held.begin( ); p != held.end( ); ++p ) {
+        output_file << p->second;
+    }
+    held.clear( );
+    holding = false;
 }
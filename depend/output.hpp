@@ -6,21 +6,49 @@
 #ifndef OUTPUT_HPP
 #define OUTPUT_HPP
 
-bool open( char *name );
-  // Opens the named output file and writes preamble.
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "include_graph.hpp"
+
+/*!
+ * This sink writes dependency lists in a form suitable for cut and paste into a makefile. Each
+ * list is held until end_source() so that it can be written in one piece. After hold_lists()
+ * the finished lists are kept instead, and write_held_lists() writes them sorted by source name;
+ * that gives the same output whatever order the sources are scanned in.
+ */
+class MakefileWriter : public DependencySink {
 
-void start( char *name );
-  // Prepares a dependency list.
+  public:
+    explicit MakefileWriter( char continuation = '\\' );
 
-bool already_scanned( char *name );
-  // Returns YES if this file already on current dependency list.
+    bool open( const char *name );
+      // Opens the named output file and writes preamble.
 
-void emit( char *name );
-  // Installs a name in the dependency list.
+    void begin_source( const std::string &name );
+      // Prepares a dependency list.
 
-void flush( char continuation );
-  // Writes the dependency list. The character argument is the line continuation required in the
-  // MakeFile.
+    void dependency( const std::string &name );
+      // Installs a name in the dependency list.
 
-#endif
+    void end_source( const std::string &name );
+      // Writes the dependency list, wrapping long lines with the continuation character.
+
+    void hold_lists( );
+      // Keeps the lists finished from now on rather than writing them.
 
+    void write_held_lists( );
+      // Writes the kept lists in order of their source names.
+
+  private:
+    std::ofstream            output_file;   // File where dependencies are written.
+    char                     continuation;  // Line continuation required in the makefile.
+    std::string              target_line;   // Object and source name for the current list.
+    std::vector<std::string> name_list;     // Contains list of dependent filenames.
+    bool                     holding;       // =true if finished lists are to be kept.
+    std::multimap<std::string, std::string> held;  // Finished lists by source name.
+};
+
+#endif
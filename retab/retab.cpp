@@ -45,6 +45,37 @@
 #include <cstdlib>
 #include <cstring>
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <dirent.h>
+#include <fcntl.h>
+#include <glob.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#define RETAB_POSIX
+#endif
+
+//  Large mapped files can be retabbed by several threads (see below).
+#if defined(RETAB_POSIX) && !defined(RETAB_NO_THREADS) && \
+    ( __cplusplus >= 201103L || ( defined(_MSC_VER) && _MSC_VER >= 1900 ) )
+#define RETAB_PARALLEL
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+//  Compile with RETAB_NO_SIMD defined to force the plain version.
+#if !defined(RETAB_NO_SIMD) && defined(__AVX2__)
+#define RETAB_AVX2
+#include <immintrin.h>
+#endif
+#if !defined(RETAB_NO_SIMD) && \
+    (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define RETAB_SSE2
+#include <emmintrin.h>
+#endif
+
 using namespace std;
 
 //  User-adjustable default values:
@@ -56,6 +87,16 @@ using namespace std;
 #define NORMAL      0       //  Normal state.
 #define QUOTE       1       //  Quoted string skip state.
 #define BLANK       2       //  Blank parsing state.
+#define REST        3       //  Rest of a line state (-l only).
+
+// Sizes for the engine (see below).
+#define BLOCK_SIZE  ( 1024*1024 )   //  Input read at a time when not mapped.
+#define OUTPUT_SIZE ( 64*1024 )     //  Output collected before writing.
+#define MAX_PIECES  512             //  Pieces of output per write.
+#define DIRECT_RUN  256             //  Runs this long are written in place.
+#define CHUNK_SIZE  ( 8*1024*1024 ) //  Input given to a thread at a time.
+#define CHUNK_SLACK ( 64*1024 )     //  How far to look for a good place to cut.
+
 
 const char *usage[]={
   "     This program  allows you  to insert  or delete  tabs in  a text file so",
@@ -63,7 +104,9 @@ const char *usage[]={
   "can be  used to  remove all tabs from a file or to replace as many spaces as",
   "possible with tabs.",
   "",
-  "RETAB -o[old tab stop] -n[new tab stop] oldfile newfile",
+  "RETAB -o[old tab stop] -n[new tab stop] -j[threads] oldfile newfile",
+  "RETAB -i -o[old tab stop] -n[new tab stop] -j[threads] names...",
+  "RETAB -c -o[old tab stop] -n[new tab stop] -j[threads] names...",
   "",
   "     For example:",
   "",
@@ -81,6 +124,24 @@ const char *usage[]={
   "",
   "     The default  tab stop  size is  8 for  both the  old and the new files.",
   "Thus \"RETAB old new\" inserts tabs, and \"RETAB -n1 old new\" removes them.",
+  "",
+  "     Columns are counted in UTF-8 characters. With -w the wide characters of",
+  "East Asian scripts count as two columns.",
+  "",
+  "     A large file can be retabbed in pieces by several threads at once. The",
+  "-j option gives the number of threads (-j alone uses one per processor). The",
+  "new file is the same however many threads are used.",
+  "",
+  "     With -i the files are changed in place. The names can be files,",
+  "directories (every file under them except hidden ones), or patterns such as",
+  "*.c. Files that would not change, and binary files, are not touched. The",
+  "files are done by -j threads at once (default: one per processor).",
+  "",
+  "     With -c the files are only checked. Each file that would change is",
+  "listed as name:line, giving the first line that would change.",
+  "",
+  "     With -l only the blanks and tabs at the start of each line are changed.",
+  "The rest of each line is copied as it is.",
   NULL
 };
 
@@ -124,42 +185,1353 @@ void print_usage( )
 }
 
 
-void entab( int ch, int blanks, int new_tabs, int column, FILE *new_file )
+//=========================================================================
+//      The retab engine.
+//
+//      The input is taken a block at a time (all of it at once if it can
+// be memory mapped) rather than a character at a time. In the NORMAL and
+// QUOTE states most characters are simply copied, so the engine looks
+// for the next character that matters in that state (16 or 32 at a time
+// with vector compares) and copies the run in front of it in one piece.
+// Only the characters that matter, and those in the BLANK state, go
+// through the state machine one at a time. The output is exactly what the
+// character at a time version of the program produced.
+//
+//      The input is taken to be UTF-8 and passed through unchanged. The
+// column counts characters rather than bytes (with -w the wide characters
+// of East Asian scripts count two). Only ASCII characters are special, so
+// the state machine sees nothing else in the NORMAL and QUOTE states; the
+// width of the runs is worked out as they are skipped, with a quick check
+// for runs that are all ASCII.
+//
+//      Short runs are copied into an output buffer. Long runs are not
+// copied at all: the output is written with writev( ) as a list of
+// pieces, some in the output buffer and some in the input itself. For
+// that reason the output is written before the next block of input is
+// read. Where there is no writev( ) the pieces are written in turn.
+//=========================================================================
+
+#ifndef RETAB_POSIX
+struct iovec {
+    void   *iov_base;
+    size_t  iov_len;
+};
+#endif
+
+// The state of the retab state machine. It carries over between blocks.
+struct Retab {
+    int old_tabs;
+    int new_tabs;
+    int state;
+    int column;
+    int blanks;
+    int literal;
+    int delimiter;
+    int east_asian;     //  !0 if wide characters take two columns (-w).
+    int indent_only;    //  !0 if only the indentation is changed (-l).
+};
+
+// Output waiting to be written.
+struct Output {
+#ifdef RETAB_POSIX
+    int           fd;
+#else
+    FILE         *file;
+#endif
+    int           failed;               //  !0 if a write failed.
+    char         *kept;                 //  If not NULL the output is kept here
+    size_t        kept_used;            //    instead of being written.
+    size_t        kept_size;
+    char          buffer[OUTPUT_SIZE];
+    size_t        used;                 //  Characters in buffer.
+    size_t        start;                //  Characters in buffer not yet in a piece.
+    struct iovec  pieces[MAX_PIECES];
+    int           count;
+};
+
+// special[ state ][ ch ] is !0 if ch must go through the state machine.
+// special[ BLANK ][ ch ] is !0 if a single blank followed by ch isn't
+// copied as it is.
+static unsigned char special[3][256];
+
+
+void init_special( )
+{
+    special[NORMAL]['\n'] = special[NORMAL]['\t'] = special[NORMAL][' '] = 1;
+    special[QUOTE]['\n']  = special[QUOTE]['\t']  = 1;
+    special[QUOTE]['\'']  = special[QUOTE]['"']   = special[QUOTE]['\\'] = 1;
+    special[BLANK][' ']   = special[BLANK]['\t']  = 1;
+    special[BLANK]['\'']  = special[BLANK]['"']   = 1;
+}
+
+
+#if defined(RETAB_SSE2) || defined(RETAB_AVX2)
+
+int first_bit( unsigned mask )
+{
+#if defined(__GNUC__)
+    return __builtin_ctz( mask );
+#else
+    int n = 0;
+
+    while( ( mask & 1 ) == 0 ) {
+        mask >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+#endif
+
+
+// Returns the first character at or after p that is special in the state
+// (NORMAL or QUOTE), or end if there is none.
+const unsigned char *find_special( const unsigned char *p, const unsigned char *end, int state )
+{
+    //  In the NORMAL state the last three are blanks again.
+    const char c0 = '\n', c1 = '\t';
+    const char c2 = ( state == QUOTE ) ? '"'  : ' ';
+    const char c3 = ( state == QUOTE ) ? '\'' : ' ';
+    const char c4 = ( state == QUOTE ) ? '\\' : ' ';
+    unsigned   bits;
+
+#if defined(RETAB_AVX2)
+    {
+        const __m256i w0 = _mm256_set1_epi8( c0 ), w1 = _mm256_set1_epi8( c1 );
+        const __m256i w2 = _mm256_set1_epi8( c2 ), w3 = _mm256_set1_epi8( c3 );
+        const __m256i w4 = _mm256_set1_epi8( c4 );
+        __m256i x, found;
+
+        while( end - p >= 32 ) {
+            x = _mm256_loadu_si256( ( const __m256i * )p );
+            found = _mm256_or_si256(
+                _mm256_or_si256( _mm256_cmpeq_epi8( x, w0 ), _mm256_cmpeq_epi8( x, w1 ) ),
+                _mm256_or_si256(
+                    _mm256_or_si256( _mm256_cmpeq_epi8( x, w2 ), _mm256_cmpeq_epi8( x, w3 ) ),
+                    _mm256_cmpeq_epi8( x, w4 ) ) );
+            if( ( bits = ( unsigned )_mm256_movemask_epi8( found ) ) != 0 )
+                return p + first_bit( bits );
+            p += 32;
+        }
+    }
+#endif
+#if defined(RETAB_SSE2)
+    {
+        const __m128i v0 = _mm_set1_epi8( c0 ), v1 = _mm_set1_epi8( c1 );
+        const __m128i v2 = _mm_set1_epi8( c2 ), v3 = _mm_set1_epi8( c3 );
+        const __m128i v4 = _mm_set1_epi8( c4 );
+        __m128i x, found;
+
+        while( end - p >= 16 ) {
+            x = _mm_loadu_si128( ( const __m128i * )p );
+            found = _mm_or_si128(
+                _mm_or_si128( _mm_cmpeq_epi8( x, v0 ), _mm_cmpeq_epi8( x, v1 ) ),
+                _mm_or_si128(
+                    _mm_or_si128( _mm_cmpeq_epi8( x, v2 ), _mm_cmpeq_epi8( x, v3 ) ),
+                    _mm_cmpeq_epi8( x, v4 ) ) );
+            if( ( bits = ( unsigned )_mm_movemask_epi8( found ) ) != 0 )
+                return p + first_bit( bits );
+            p += 16;
+        }
+    }
+#else
+    ( void )c0; ( void )c1; ( void )c2; ( void )c3; ( void )c4; ( void )bits;
+#endif
+    while( p < end && !special[state][*p] ) ++p;
+    return p;
+}
+
+
+// The width of the vector compares, if there are any.
+#if defined(RETAB_AVX2)
+#define WIDTH 32
+#elif defined(RETAB_SSE2)
+#define WIDTH 16
+#endif
+
+#ifdef WIDTH
+
+// Returns a bit for each of the next WIDTH characters that is special in
+// the NORMAL state or isn't ASCII.
+inline unsigned normal_mask( const unsigned char *p )
+{
+#if defined(RETAB_AVX2)
+    const __m256i x = _mm256_loadu_si256( ( const __m256i * )p );
+
+    return ( unsigned )_mm256_movemask_epi8( _mm256_or_si256(
+        _mm256_or_si256( _mm256_cmpeq_epi8( x, _mm256_set1_epi8( '\n' ) ),
+                         _mm256_cmpeq_epi8( x, _mm256_set1_epi8( '\t' ) ) ),
+        _mm256_or_si256( _mm256_cmpeq_epi8( x, _mm256_set1_epi8( ' ' ) ), x ) ) );
+#else
+    const __m128i x = _mm_loadu_si128( ( const __m128i * )p );
+
+    return ( unsigned )_mm_movemask_epi8( _mm_or_si128(
+        _mm_or_si128( _mm_cmpeq_epi8( x, _mm_set1_epi8( '\n' ) ),
+                      _mm_cmpeq_epi8( x, _mm_set1_epi8( '\t' ) ) ),
+        _mm_or_si128( _mm_cmpeq_epi8( x, _mm_set1_epi8( ' ' ) ), x ) ) );
+#endif
+}
+
+#endif
+
+
+// The characters of East Asian scripts that take two columns (-w).
+static const unsigned long wide_chars[][2] = {
+    { 0x1100,  0x115F  },   //  Hangul Jamo.
+    { 0x2329,  0x232A  },   //  Angle brackets.
+    { 0x2E80,  0x303E  },   //  CJK radicals and punctuation.
+    { 0x3041,  0x33FF  },   //  Kana, Bopomofo, CJK compatibility.
+    { 0x3400,  0x4DBF  },   //  CJK ideographs extension A.
+    { 0x4E00,  0x9FFF  },   //  CJK ideographs.
+    { 0xA000,  0xA4CF  },   //  Yi.
+    { 0xAC00,  0xD7A3  },   //  Hangul syllables.
+    { 0xF900,  0xFAFF  },   //  CJK compatibility ideographs.
+    { 0xFE10,  0xFE19  },   //  Vertical forms.
+    { 0xFE30,  0xFE6F  },   //  CJK compatibility forms.
+    { 0xFF00,  0xFF60  },   //  Fullwidth forms.
+    { 0xFFE0,  0xFFE6  },
+    { 0x1F300, 0x1F64F },   //  Pictographs and emoticons.
+    { 0x1F900, 0x1F9FF },
+    { 0x20000, 0x2FFFD },   //  CJK ideographs extensions.
+    { 0x30000, 0x3FFFD },
+};
+
+
+// Returns !0 if the UTF-8 character at p, which must be complete before
+// end, is a wide one.
+int is_wide( const unsigned char *p, const unsigned char *end )
+{
+    unsigned long code;
+    int           count;
+    size_t        i;
+
+    if( *p >= 0xF0 ) {
+        code  = *p & 0x07;
+        count = 3;
+    }
+    else if( *p >= 0xE0 ) {
+        code  = *p & 0x0F;
+        count = 2;
+    }
+    else return 0;
+    if( end - p <= count ) return 0;
+    while( count-- > 0 ) {
+        if( ( *++p & 0xC0 ) != 0x80 ) return 0;
+        code = ( code << 6 ) | ( *p & 0x3F );
+    }
+    for( i = 0; i < sizeof( wide_chars ) / sizeof( wide_chars[0] ); i++ ) {
+        if( code < wide_chars[i][0] ) return 0;
+        if( code <= wide_chars[i][1] ) return !0;
+    }
+    return 0;
+}
+
+
+// Returns the columns taken by the byte at p, which isn't ASCII. The input
+// is taken to be UTF-8: the first byte of a character takes all of its
+// columns and the rest take none.
+inline int byte_width( const Retab &rt, const unsigned char *p, const unsigned char *end )
+{
+    if( ( *p & 0xC0 ) == 0x80 ) return 0;
+    if( rt.east_asian && *p >= 0xE0 && is_wide( p, end ) ) return 2;
+    return 1;
+}
+
+
+// Returns the columns taken by the characters from p to end. Where there
+// is nothing but ASCII it's simply the number of characters.
+int text_width( const Retab &rt, const unsigned char *p, const unsigned char *end )
+{
+    const unsigned char *start = p;
+    int                  extra = 0;     //  Columns over the number of bytes.
+
+    while( p < end ) {
+#if defined(RETAB_SSE2)
+        while( end - p >= 16 &&
+               _mm_movemask_epi8( _mm_loadu_si128( ( const __m128i * )p ) ) == 0 ) p += 16;
+#endif
+        while( p < end && *p < 0x80 ) ++p;
+        if( p < end ) {
+            extra += byte_width( rt, p, end ) - 1;
+            ++p;
+        }
+    }
+    return ( int )( end - start ) + extra;
+}
+
+
+// Returns the end of the run in the NORMAL state that starts at p and
+// brings the column up to date. The run takes in new-lines and single
+// blanks (see retab_block( )). The special characters in each WIDTH
+// characters are found at once and taken in turn from the bit mask.
+const unsigned char *normal_run( Retab &rt, const unsigned char *p, const unsigned char *end )
+{
+    int column = rt.column;
+
+#ifdef WIDTH
+    unsigned bits;
+    int      k;
+    int      done;      //  Characters of this WIDTH already counted.
+
+    //  One more than WIDTH so that the character after a blank is there.
+    while( end - p > WIDTH ) {
+        bits = normal_mask( p );
+        done = 0;
+        while( bits ) {
+            k = first_bit( bits );
+            bits &= bits - 1;
+            column += k - done;
+            if( p[k] == '\n' ) {
+                column = 0;
+                done = k + 1;
+            }
+            else if( p[k] >= 0x80 ) {
+                column += byte_width( rt, p + k, end );
+                done = k + 1;
+            }
+            else if( p[k] == ' ' && !special[BLANK][p[k + 1]] ) {
+                done = k + 2;
+                if( k + 1 < WIDTH ) bits &= ~( 1u << ( k + 1 ) );
+            }
+            else {
+                rt.column = column;
+                return p + k;
+            }
+        }
+        if( done < WIDTH ) {
+            column += WIDTH - done;
+            done = WIDTH;
+        }
+        p += done;
+    }
+#endif
+    while( p < end ) {
+        if( !special[NORMAL][*p] ) {
+            column += ( *p < 0x80 ) ? 1 : byte_width( rt, p, end );
+            ++p;
+        }
+        else if( *p == '\n' ) {
+            column = 0;
+            ++p;
+        }
+        else if( *p == ' ' && end - p >= 2 && !special[BLANK][p[1]] ) p += 2;
+        else break;
+    }
+    rt.column = column;
+    return p;
+}
+
+
+void out_init( Output &out )
+{
+    out.failed = 0;
+    out.kept   = NULL;
+    out.used   = 0;
+    out.start  = 0;
+    out.count  = 0;
+}
+
+
+// Writes all the output waiting to be written.
+void out_flush( Output &out )
+{
+    struct iovec *piece;
+    int           count;
+
+    if( out.used > out.start ) {
+        out.pieces[out.count].iov_base = out.buffer + out.start;
+        out.pieces[out.count].iov_len  = out.used - out.start;
+        out.count++;
+    }
+    piece = out.pieces;
+    count = out.count;
+    if( out.kept != NULL ) {
+        for( ; count > 0 && !out.failed; piece++, count-- ) {
+            if( out.kept_used + piece->iov_len > out.kept_size ) {
+                size_t  size = 2 * out.kept_size + piece->iov_len;
+                char   *more = ( char * )realloc( out.kept, size );
+
+                if( more == NULL ) {
+                    out.failed = !0;
+                    break;
+                }
+                out.kept      = more;
+                out.kept_size = size;
+            }
+            memcpy( out.kept + out.kept_used, piece->iov_base, piece->iov_len );
+            out.kept_used += piece->iov_len;
+        }
+        count = 0;
+    }
+#ifdef RETAB_POSIX
+    while( count > 0 && !out.failed ) {
+        ssize_t written = writev( out.fd, piece, count );
+
+        if( written < 0 ) {
+            out.failed = !0;
+            break;
+        }
+        while( count > 0 && ( size_t )written >= piece->iov_len ) {
+            written -= piece->iov_len;
+            piece++;
+            count--;
+        }
+        if( count > 0 ) {
+            piece->iov_base = ( char * )piece->iov_base + written;
+            piece->iov_len -= written;
+        }
+    }
+#else
+    for( ; count > 0 && !out.failed; piece++, count-- ) {
+        if( fwrite( piece->iov_base, 1, piece->iov_len, out.file ) != piece->iov_len )
+            out.failed = !0;
+    }
+#endif
+    out.used  = 0;
+    out.start = 0;
+    out.count = 0;
+}
+
+
+inline void out_put( Output &out, int ch )
+{
+    if( out.used == OUTPUT_SIZE ) out_flush( out );
+    out.buffer[out.used++] = ( char )ch;
+}
+
+
+inline void out_fill( Output &out, int ch, size_t n )
+{
+    size_t room;
+
+    while( n > 0 ) {
+        if( out.used == OUTPUT_SIZE ) out_flush( out );
+        room = OUTPUT_SIZE - out.used;
+        if( room > n ) room = n;
+        memset( out.buffer + out.used, ch, room );
+        out.used += room;
+        n -= room;
+    }
+}
+
+
+// Adds a run of the input to the output. Long runs are left where they are.
+void out_copy( Output &out, const unsigned char *p, size_t n )
+{
+    if( n < DIRECT_RUN ) {
+        if( out.used + n > OUTPUT_SIZE ) out_flush( out );
+        memcpy( out.buffer + out.used, p, n );
+        out.used += n;
+        return;
+    }
+    if( out.count + 2 > MAX_PIECES ) out_flush( out );
+    if( out.used > out.start ) {
+        out.pieces[out.count].iov_base = out.buffer + out.start;
+        out.pieces[out.count].iov_len  = out.used - out.start;
+        out.count++;
+        out.start = out.used;
+    }
+    out.pieces[out.count].iov_base = ( void * )p;
+    out.pieces[out.count].iov_len  = n;
+    out.count++;
+}
+
+
+inline int out_stopped( const Output & )
+{
+    return 0;
+}
+
+
+// With -c the output isn't written. It's compared to the input instead, and
+// the engine stops where they first differ. Nothing needs to be buffered.
+struct Check {
+    const unsigned char *next;      //  Where the next output should be found.
+    const unsigned char *end;
+    const unsigned char *differs;   //  Where the output differs, or NULL.
+};
+
+
+inline int out_stopped( const Check &check )
+{
+    return check.differs != NULL;
+}
+
+
+inline void out_put( Check &check, int ch )
+{
+    if( check.differs != NULL ) return;
+    if( check.next == check.end || *check.next != ch ) check.differs = check.next;
+    else check.next++;
+}
+
+
+inline void out_fill( Check &check, int ch, size_t n )
+{
+    while( n-- > 0 && check.differs == NULL ) out_put( check, ch );
+}
+
+
+void out_copy( Check &check, const unsigned char *p, size_t n )
+{
+    //  Runs are copied from the input so they are found where they are
+    //  unless something in front of them differed.
+    if( check.next == p ) check.next += n;
+    else while( n-- > 0 && check.differs == NULL ) out_put( check, *p++ );
+}
+
+
+// Puts out the blanks in front of ch as tabs and spaces, and then ch. The
+// tabs are counted rather than put out one at a time.
+template <class Sink>
+void entab( int ch, int blanks, int new_tabs, int column, Sink &out )
 {
     int j;
 
-    if( blanks > 1 && new_tabs > 1 )
-        while( ( j = new_tabs - column % new_tabs ) <= blanks ) {
-            column += j;
-            blanks -= j;
-            putc( '\t', new_file );
+    if( blanks > 1 && new_tabs > 1 && ( j = new_tabs - column % new_tabs ) <= blanks ) {
+        out_fill( out, '\t', 1 + ( blanks - j ) / new_tabs );
+        blanks = ( blanks - j ) % new_tabs;
+    }
+    out_fill( out, ' ', blanks );
+    out_put( out, ch );
+}
+
+
+// Runs one character through the state machine.
+template <class Sink>
+void retab_char( Retab &rt, int i, Sink &out )
+{
+    switch( rt.state ) {
+
+    case NORMAL:
+        switch( i ) {
+        case '\n':
+            rt.column = 0;
+            out_put( out, '\n' );
+            break;
+
+        case '\t':
+            rt.blanks = rt.old_tabs -  rt.column % rt.old_tabs;
+            rt.state = BLANK;
+            break;
+
+        case ' ':
+            rt.blanks = 1;
+            rt.state = BLANK;
+            break;
+
+        case '\'':
+        case '"':
+            rt.delimiter = i;
+            ++rt.column;
+            out_put( out, i );
+            break;
+
+        default:
+            ++rt.column;
+            out_put( out, i );
+            break;
+        }
+        break;
+
+    case QUOTE:
+        switch( i ) {
+        case '\n':
+            if( !rt.literal ) rt.state = NORMAL;
+            rt.column = 0;
+            break;
+
+        case '\t':
+            rt.column += rt.new_tabs - rt.column % rt.new_tabs;
+            break;
+
+        case '\'':
+        case '"' :
+            if( !rt.literal && i == rt.delimiter ) rt.state = NORMAL;
+            ++rt.column;
+            break;
+
+        default:
+            ++rt.column;
+            break;
+        }
+        out_put( out, i );
+        break;
+
+    case BLANK:
+        switch( i ) {
+        case '\t':
+            rt.blanks += rt.old_tabs - ( rt.column + rt.blanks ) % rt.old_tabs;
+            break;
+
+        case ' ':
+            ++rt.blanks;
+            break;
+
+        case '"':
+        case '\'':
+            rt.delimiter = i;
+            rt.state = QUOTE;
+            entab( i, rt.blanks, rt.new_tabs, rt.column, out );
+            break;
+
+        default:
+            rt.state = NORMAL;
+            entab( i, rt.blanks, rt.new_tabs, rt.column, out );
+            break;
+        }
+        break;
+    }
+    rt.literal = !rt.literal && i == '\\';
+}
+
+
+// Changes only the indentation of each line (-l). The state is NORMAL at
+// the start of a line, BLANK in its indentation, and REST after that. The
+// rest of the line is skipped with memchr( ), and lines whose indentation
+// is already right are left in the run being copied, so most of the input
+// is copied in large pieces without being looked at.
+template <class Sink>
+void indent_block( Retab &rt, const unsigned char *p, const unsigned char *end, Sink &out )
+{
+    const unsigned char *run = p;       //  Input to be copied as it is.
+    const unsigned char *indent = p;    //  Start of the indentation.
+    const void          *found;
+    int                  whole;         //  !0 if all the indentation is here.
+    int                  right;         //  !0 if it needn't be changed.
+    int                  tabs;
+    int                  spaces;
+
+    while( p < end && !out_stopped( out ) ) {
+        if( rt.state == REST ) {
+            if( ( found = memchr( p, '\n', end - p ) ) == NULL ) p = end;
+            else {
+                p = ( const unsigned char * )found + 1;
+                rt.state = NORMAL;
+            }
+            continue;
         }
-    for( ; blanks; --blanks ) {
-        ++column;
-        putc( ' ', new_file );
+        whole = ( rt.state == NORMAL );
+        if( whole ) {
+            rt.state  = BLANK;
+            rt.blanks = 0;
+        }
+        indent = p;
+        for( ; p < end; p++ ) {
+            if( *p == ' ' ) ++rt.blanks;
+            else if( *p == '\t' ) rt.blanks += rt.old_tabs - rt.blanks % rt.old_tabs;
+            else break;
+        }
+        if( p == end ) break;
+
+        //  The indentation as entab( ) would put it out from column zero.
+        tabs   = ( rt.blanks > 1 && rt.new_tabs > 1 ) ? rt.blanks / rt.new_tabs : 0;
+        spaces = rt.blanks - tabs * rt.new_tabs;
+        right = whole && p - indent == tabs + spaces &&
+            ( tabs == 0 || memchr( indent, ' ', tabs ) == NULL ) &&
+            ( spaces == 0 || memchr( indent + tabs, '\t', spaces ) == NULL );
+        if( !right ) {
+            out_copy( out, run, indent - run );
+            out_fill( out, '\t', tabs );
+            out_fill( out, ' ', spaces );
+            run = p;
+        }
+        rt.state = REST;
     }
-    if( ch == '\n' ) column = 0;
-    else
-        ++column;
-    putc( ch, new_file );
+
+    //  Indentation that goes on into the next block is put out there.
+    if( rt.state == BLANK ) p = indent;
+    if( p > run ) out_copy( out, run, p - run );
+}
+
+
+// Runs a block of the input through the state machine. The runs between
+// the special characters only change the column (and the literal flag).
+//
+//      In the NORMAL state two common cases are kept in the run as well. A
+// new-line only sets the column to zero. A single blank followed by an
+// ordinary character (or a new-line) is put out as it is by entab( ),
+// and since entab( ) works on a copy of the column, neither of them
+// changes the column.
+template <class Sink>
+void retab_block( Retab &rt, const unsigned char *p, const unsigned char *end, Sink &out )
+{
+    const unsigned char *run;
+    const unsigned char *q;
+
+    if( rt.indent_only ) {
+        indent_block( rt, p, end, out );
+        return;
+    }
+    while( p < end && !out_stopped( out ) ) {
+        if( rt.state == BLANK ) {
+            //  Count the blanks and then end the run.
+            for( ; p < end; p++ ) {
+                if( *p == ' ' ) ++rt.blanks;
+                else if( *p == '\t' )
+                    rt.blanks += rt.old_tabs - ( rt.column + rt.blanks ) % rt.old_tabs;
+                else break;
+            }
+            if( p < end ) retab_char( rt, *p++, out );
+            continue;
+        }
+        run = p;
+        if( rt.state == QUOTE ) {
+            p = find_special( p, end, QUOTE );
+            rt.column += text_width( rt, run, p );
+        }
+        else p = normal_run( rt, p, end );
+        if( p != run ) {
+            out_copy( out, run, p - run );
+
+            //  A run ends with an even or odd number of backslashes.
+            for( q = p; q > run && q[-1] == '\\'; --q ) ;
+            if( q > run ) rt.literal = ( p - q ) % 2;
+            else if( ( p - q ) % 2 ) rt.literal = !rt.literal;
+        }
+        if( p < end ) retab_char( rt, *p++, out );
+    }
+}
+
+
+// Returns the number of bytes at the end of a block that begin a UTF-8
+// character finished in the next block. They are held back so that the
+// width of the character can be found.
+size_t cut_short( const unsigned char *block, size_t count )
+{
+    size_t i;
+    size_t length;
+
+    for( i = 1; i <= 3 && i <= count; i++ ) {
+        if( ( block[count - i] & 0xC0 ) == 0x80 ) continue;
+        if( block[count - i] < 0xC0 ) return 0;
+        length = ( block[count - i] >= 0xF0 ) ? 4 : ( block[count - i] >= 0xE0 ) ? 3 : 2;
+        return ( length > i ) ? i : 0;
+    }
+    return 0;
+}
+
+
+#ifdef RETAB_PARALLEL
+
+//=========================================================================
+//      Retabbing one file with several threads.
+//
+//      The state at any point depends on everything in front of it, but
+// just after most new-lines it is simply the NORMAL state with the column
+// at zero. A mapped file is cut into chunks at such places and the chunks
+// are retabbed at the same time, each one starting from that state and
+// keeping its output in memory. The chunks are written in order. Before a
+// chunk is written the state it started from is checked against the state
+// the chunk in front of it actually ended in. If they differ (the chunk
+// starts in a string continued with a backslash, or after a line ending
+// in blanks, which leaves the column alone) the chunk is retabbed again
+// from the right state. Either way the new file is exactly what one pass
+// would have produced.
+//
+//      The threads are kept only a few chunks ahead of the writing so that
+// not much of the output is held in memory at once.
+//=========================================================================
+
+struct Chunk {
+    const unsigned char *start;
+    const unsigned char *end;
+    Retab                rt;        //  The state at the end of the chunk.
+    Output              *out;
+    int                  done;
+};
+
+struct Job {
+    Retab                    first;     //  The state assumed at each chunk.
+    Chunk                   *chunks;
+    int                      count;
+    int                      next;      //  The next chunk to be taken.
+    int                      written;   //  Chunks written so far.
+    int                      ahead;     //  Chunks that may be waiting.
+    std::mutex               lock;
+    std::condition_variable  changed;
+};
+
+
+// Returns !0 if the machine does the same from state a as from state b.
+int same_state( const Retab &a, const Retab &b )
+{
+    return a.state == b.state && a.column == b.column && a.literal == b.literal &&
+        ( a.state != BLANK || a.blanks == b.blanks ) &&
+        ( a.state != QUOTE || a.delimiter == b.delimiter );
+}
+
+
+// Returns the place at or after p to cut the input, or end. A new-line
+// that follows a character other than a blank, a tab, or a backslash
+// always leaves the NORMAL state with the column at zero. If there is no
+// such new-line close by the first one is used.
+const unsigned char *find_cut( const unsigned char *p, const unsigned char *end )
+{
+    const unsigned char *limit = ( end - p > CHUNK_SLACK ) ? p + CHUNK_SLACK : end;
+    const unsigned char *first = NULL;
+    const void          *found;
+    int                  before;
+
+    while( p < end && ( found = memchr( p, '\n', end - p ) ) != NULL ) {
+        p = ( const unsigned char * )found;
+        before = p[-1];
+        p++;
+        if( before != ' ' && before != '\t' && before != '\\' ) return p;
+        if( first == NULL ) first = p;
+        if( p >= limit ) break;
+    }
+    return ( first != NULL ) ? first : end;
+}
+
+
+void retab_worker( Job *job )
+{
+    std::unique_lock<std::mutex> hold( job->lock );
+    Chunk *chunk;
+
+    while( job->next < job->count ) {
+        if( job->next >= job->written + job->ahead ) {
+            job->changed.wait( hold );
+            continue;
+        }
+        chunk = &job->chunks[job->next++];
+        hold.unlock();
+
+        chunk->rt  = job->first;
+        chunk->out = new Output;
+        out_init( *chunk->out );
+        chunk->out->kept_size = ( size_t )( chunk->end - chunk->start ) + OUTPUT_SIZE;
+        chunk->out->kept_used = 0;
+        if( ( chunk->out->kept = ( char * )malloc( chunk->out->kept_size ) ) == NULL )
+            chunk->out->failed = !0;
+        else {
+            retab_block( chunk->rt, chunk->start, chunk->end, *chunk->out );
+            out_flush( *chunk->out );
+        }
+
+        hold.lock();
+        chunk->done = !0;
+        job->changed.notify_all();
+    }
+}
+
+
+// Retabs the mapped input with the given number of threads. The state
+// must be the one the machine starts in.
+void retab_parallel( Retab &rt, const unsigned char *p, const unsigned char *end, Output &out, int threads )
+{
+    Job                 job;
+    std::thread        *workers;
+    Chunk              *chunk;
+    int                 i;
+
+    job.first   = rt;
+    job.chunks  = new Chunk[( end - p ) / CHUNK_SIZE + 1];
+    job.count   = 0;
+    job.next    = 0;
+    job.written = 0;
+    job.ahead   = 2 * threads;
+    while( p < end ) {
+        chunk = &job.chunks[job.count++];
+        chunk->start = p;
+        chunk->end   = ( end - p > CHUNK_SIZE ) ? find_cut( p + CHUNK_SIZE, end ) : end;
+        chunk->out   = NULL;
+        chunk->done  = 0;
+        p = chunk->end;
+    }
+
+    workers = new std::thread[threads];
+    for( i = 0; i < threads; i++ ) workers[i] = std::thread( retab_worker, &job );
+
+    for( i = 0; i < job.count; i++ ) {
+        chunk = &job.chunks[i];
+        {
+            std::unique_lock<std::mutex> hold( job.lock );
+            while( !chunk->done ) job.changed.wait( hold );
+        }
+        if( !chunk->out->failed && same_state( rt, job.first ) ) {
+            out_copy( out, ( const unsigned char * )chunk->out->kept, chunk->out->kept_used );
+            out_flush( out );
+            rt = chunk->rt;
+        }
+        else {
+            retab_block( rt, chunk->start, chunk->end, out );
+            out_flush( out );
+        }
+        free( chunk->out->kept );
+        delete chunk->out;
+        {
+            std::lock_guard<std::mutex> hold( job.lock );
+            job.written++;
+            job.changed.notify_all();
+        }
+    }
+
+    for( i = 0; i < threads; i++ ) workers[i].join( );
+    delete [] workers;
+    delete [] job.chunks;
+}
+
+#endif
+
+
+// Retabs one file into another with the given number of threads (if the
+// file can be mapped). Returns !0 if all went well.
+int retab_file( Retab &rt, const char *old_file_name, const char *new_file_name, int threads )
+{
+    Output         *out = new Output;
+    unsigned char  *block;
+    size_t          count;
+    size_t          held = 0;      //  Bytes of a character cut off by a block.
+    int             result = !0;
+
+    out_init( *out );
+#ifdef RETAB_POSIX
+    int             old_fd;
+    struct stat     info;
+    void           *map = MAP_FAILED;
+
+    if( ( old_fd = open( old_file_name, O_RDONLY ) ) < 0 ) {
+        printf( "ERROR:  Cannot find file %s\n\n", old_file_name );
+        delete out;
+        return 0;
+    }
+    if( ( out->fd = open( new_file_name, O_WRONLY | O_CREAT | O_TRUNC, 0666 ) ) < 0 ) {
+        printf( "ERROR:  Cannot create file %s\n\n", new_file_name );
+        close( old_fd );
+        delete out;
+        return 0;
+    }
+
+    //  Map the whole file if possible. Otherwise read it a block at a time.
+    if( fstat( old_fd, &info ) == 0 && S_ISREG( info.st_mode ) &&
+        info.st_size > 0 && ( unsigned long long )info.st_size <= ( size_t )-1 ) {
+        map = mmap( NULL, ( size_t )info.st_size, PROT_READ, MAP_PRIVATE, old_fd, 0 );
+    }
+    if( map != MAP_FAILED ) {
+#ifdef MADV_SEQUENTIAL
+        madvise( map, ( size_t )info.st_size, MADV_SEQUENTIAL );
+#endif
+        block = ( unsigned char * )map;
+#ifdef RETAB_PARALLEL
+        if( threads > 1 && info.st_size > 2 * CHUNK_SIZE )
+            retab_parallel( rt, block, block + info.st_size, *out, threads );
+        else retab_block( rt, block, block + info.st_size, *out );
+#else
+        retab_block( rt, block, block + info.st_size, *out );
+#endif
+        out_flush( *out );
+        munmap( map, ( size_t )info.st_size );
+    }
+    else {
+        block = new unsigned char[BLOCK_SIZE];
+        ssize_t got;
+
+        while( ( got = read( old_fd, block + held, BLOCK_SIZE - held ) ) > 0 ) {
+            count = held + ( size_t )got;
+            held  = cut_short( block, count );
+            retab_block( rt, block, block + count - held, *out );
+            out_flush( *out );
+            memmove( block, block + count - held, held );
+        }
+        retab_block( rt, block, block + held, *out );
+        out_flush( *out );
+        if( got < 0 ) {
+            printf( "ERROR:  Cannot read file %s\n\n", old_file_name );
+            result = 0;
+        }
+        delete [] block;
+    }
+    close( old_fd );
+    if( out->failed || close( out->fd ) ) {
+        printf( "ERROR:  Disk full\n\n" );
+        result = 0;
+    }
+#else
+    FILE           *old_file;
+
+    if( ( old_file = fopen( old_file_name, "r" ) ) == NULL ) {
+        printf( "ERROR:  Cannot find file %s\n\n", old_file_name );
+        delete out;
+        return 0;
+    }
+    if( ( out->file = fopen( new_file_name, "w" ) ) == NULL ) {
+        printf( "ERROR:  Cannot create file %s\n\n", new_file_name );
+        fclose( old_file );
+        delete out;
+        return 0;
+    }
+    block = new unsigned char[BLOCK_SIZE];
+    while( ( count = fread( block + held, 1, BLOCK_SIZE - held, old_file ) ) > 0 ) {
+        count += held;
+        held   = cut_short( block, count );
+        retab_block( rt, block, block + count - held, *out );
+        out_flush( *out );
+        memmove( block, block + count - held, held );
+    }
+    retab_block( rt, block, block + held, *out );
+    out_flush( *out );
+    delete [] block;
+    fclose( old_file );
+    if( out->failed || ferror( out->file ) || fclose( out->file ) ) {
+        printf( "ERROR:  Disk full\n\n" );
+        result = 0;
+    }
+#endif
+    ( void )threads;
+    delete out;
+    return result;
+}
+
+
+#ifdef RETAB_POSIX
+
+//=========================================================================
+//      Retabbing files in place.
+//
+//      With -i the names on the command line are files, directories (all
+// the files under them except hidden ones), or patterns like *.c to be
+// matched. Each file is retabbed into memory by one of a pool of threads.
+// If the result is different it's written to a new file in the same
+// directory which is then renamed over the old one, so the file is never
+// seen half written. It keeps the old file's permissions, owner, and group.
+// A link named on the command line is followed and the file it points at
+// is replaced; links found under a directory are skipped. A file that
+// wouldn't change isn't touched at all.
+// Files with NUL characters in them are taken to be binary and left alone.
+//
+//      With -c the files are only checked: each one is run through the
+// engine with its output compared to the file itself (see Check above),
+// and the line of the first difference is reported.
+//=========================================================================
+
+// Values for Target.result.
+#define UNCHANGED   0       //  The file was already right.
+#define CHANGED     1       //  The file was replaced.
+#define SKIPPED     2       //  The file is binary.
+#define FAILED      3       //  See Target.error.
+#define DIFFERS     4       //  With -c, the file would change at Target.line.
+
+struct Target {
+    char       *name;
+    int         result;
+    const char *error;
+    long        line;
+};
+
+static int     checking     = 0;    //  !0 if the files are only checked.
+
+static Target *targets      = NULL;
+static int     target_count = 0;
+static int     target_size  = 0;
+static int     next_target  = 0;    //  The next one to be taken by a thread.
+
+
+void add_target( const char *name )
+{
+    if( target_count == target_size ) {
+        target_size = ( target_size == 0 ) ? 64 : 2 * target_size;
+        if( ( targets = ( Target * )realloc( targets, target_size * sizeof( Target ) ) ) == NULL ) {
+            printf( "ERROR:  Out of memory\n\n" );
+            exit( 1 );
+        }
+    }
+    if( ( targets[target_count].name = strdup( name ) ) == NULL ) {
+        printf( "ERROR:  Out of memory\n\n" );
+        exit( 1 );
+    }
+    targets[target_count].result = UNCHANGED;
+    targets[target_count].error  = NULL;
+    targets[target_count].line   = 0;
+    target_count++;
+}
+
+
+// Adds the files under a directory. Links aren't followed.
+void add_tree( const char *path )
+{
+    DIR           *directory;
+    struct dirent *entry;
+    struct stat    info;
+    char          *name;
+
+    if( ( directory = opendir( path ) ) == NULL ) {
+        printf( "ERROR:  Cannot open directory %s\n\n", path );
+        return;
+    }
+    while( ( entry = readdir( directory ) ) != NULL ) {
+        if( entry->d_name[0] == '.' ) continue;
+        if( ( name = ( char * )malloc( strlen( path ) + strlen( entry->d_name ) + 2 ) ) == NULL ) {
+            printf( "ERROR:  Out of memory\n\n" );
+            exit( 1 );
+        }
+        sprintf( name, "%s/%s", path, entry->d_name );
+        if( lstat( name, &info ) == 0 ) {
+            if( S_ISDIR( info.st_mode ) ) add_tree( name );
+            else if( S_ISREG( info.st_mode ) ) add_target( name );
+        }
+        free( name );
+    }
+    closedir( directory );
+}
+
+
+// Adds a name from the command line. Returns 0 if nothing matches it. A
+// link is replaced by the name of the file it points at, so that the link
+// itself is left alone when the file is rewritten.
+int add_name( const char *name )
+{
+    struct stat info;
+    glob_t      found;
+    size_t      i;
+    char       *real;
+    int         result;
+
+    if( strpbrk( name, "*?[" ) != NULL && stat( name, &info ) != 0 ) {
+        if( glob( name, 0, NULL, &found ) != 0 ) return 0;
+        for( i = 0; i < found.gl_pathc; i++ ) add_name( found.gl_pathv[i] );
+        globfree( &found );
+        return !0;
+    }
+    if( lstat( name, &info ) == 0 && S_ISLNK( info.st_mode ) &&
+        ( real = realpath( name, NULL ) ) != NULL ) {
+        result = add_name( real );
+        free( real );
+        return result;
+    }
+    if( stat( name, &info ) == 0 && S_ISDIR( info.st_mode ) ) add_tree( name );
+    else add_target( name );
+    return !0;
+}
+
+
+// Writes a new version of a file next to it and renames it over the file.
+// The new file gets the old one's permissions, and its owner and group
+// where the user is allowed to set them. Returns NULL or what went wrong.
+const char *replace_file( const char *name, const struct stat &info, const char *text, size_t size )
+{
+    char    *temporary;
+    int      fd;
+    ssize_t  written;
+    int      failed = 0;
+
+    if( ( temporary = ( char * )malloc( strlen( name ) + 16 ) ) == NULL ) return "Out of memory for";
+    sprintf( temporary, "%s.retab-XXXXXX", name );
+    if( ( fd = mkstemp( temporary ) ) < 0 ) {
+        free( temporary );
+        return "Cannot create a file next to";
+    }
+    if( fchown( fd, info.st_uid, info.st_gid ) != 0 ) fchown( fd, ( uid_t )-1, info.st_gid );
+    fchmod( fd, info.st_mode & 07777 );
+    while( size > 0 ) {
+        if( ( written = write( fd, text, size ) ) <= 0 ) {
+            failed = !0;
+            break;
+        }
+        text += written;
+        size -= ( size_t )written;
+    }
+    if( close( fd ) != 0 ) failed = !0;
+    if( !failed && rename( temporary, name ) != 0 ) failed = !0;
+    if( failed ) unlink( temporary );
+    free( temporary );
+    return failed ? "Cannot replace file" : NULL;
+}
+
+
+// Checks a mapped file.
+void check_target( Retab &rt, const unsigned char *text, size_t size, Target &target )
+{
+    Check                check;
+    const unsigned char *p;
+
+    check.next    = text;
+    check.end     = text + size;
+    check.differs = NULL;
+    retab_block( rt, text, text + size, check );
+
+    //  The output may stop short (blanks at the end are dropped).
+    if( check.differs == NULL && check.next != check.end ) check.differs = check.next;
+    if( check.differs != NULL ) {
+        target.result = DIFFERS;
+        target.line   = 1;
+        for( p = text; ( p = ( const unsigned char * )memchr( p, '\n', check.differs - p ) ) != NULL; p++ )
+            target.line++;
+    }
+}
+
+
+// Retabs a file in place.
+void retab_target( const Retab &settings, Target &target )
+{
+    int          fd;
+    struct stat  info;
+    void        *map;
+    Retab        rt = settings;
+    Output      *out;
+
+    if( ( fd = open( target.name, O_RDONLY ) ) < 0 ) {
+        target.result = FAILED;
+        target.error  = "Cannot find file";
+        return;
+    }
+    if( fstat( fd, &info ) != 0 || !S_ISREG( info.st_mode ) ) {
+        close( fd );
+        target.result = FAILED;
+        target.error  = "Not a file:";
+        return;
+    }
+    if( info.st_size == 0 ) {
+        close( fd );
+        return;
+    }
+    map = mmap( NULL, ( size_t )info.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+    if( map == MAP_FAILED ) {
+        target.result = FAILED;
+        target.error  = "Cannot read file";
+        return;
+    }
+    if( memchr( map, '\0', ( size_t )info.st_size ) != NULL ) {
+        munmap( map, ( size_t )info.st_size );
+        target.result = SKIPPED;
+        return;
+    }
+
+    if( checking ) {
+        check_target( rt, ( unsigned char * )map, ( size_t )info.st_size, target );
+        munmap( map, ( size_t )info.st_size );
+        return;
+    }
+    out = new Output;
+    out_init( *out );
+    out->kept_size = ( size_t )info.st_size + OUTPUT_SIZE;
+    out->kept_used = 0;
+    if( ( out->kept = ( char * )malloc( out->kept_size ) ) == NULL ) out->failed = !0;
+    else {
+        retab_block( rt, ( unsigned char * )map, ( unsigned char * )map + info.st_size, *out );
+        out_flush( *out );
+    }
+    if( out->failed ) {
+        target.result = FAILED;
+        target.error  = "Out of memory for";
+    }
+    else if( out->kept_used != ( size_t )info.st_size ||
+             memcmp( out->kept, map, out->kept_used ) != 0 ) {
+        target.error  = replace_file( target.name, info, out->kept, out->kept_used );
+        target.result = ( target.error == NULL ) ? CHANGED : FAILED;
+    }
+    munmap( map, ( size_t )info.st_size );
+    free( out->kept );
+    delete out;
+}
+
+
+#ifdef RETAB_PARALLEL
+static std::mutex target_lock;
+#endif
+
+void target_worker( const Retab *settings )
+{
+    int i;
+
+    for( ;; ) {
+#ifdef RETAB_PARALLEL
+        {
+            std::lock_guard<std::mutex> hold( target_lock );
+            i = next_target++;
+        }
+#else
+        i = next_target++;
+#endif
+        if( i >= target_count ) break;
+        retab_target( *settings, targets[i] );
+    }
+}
+
+
+// Retabs the targets in place with the given number of threads. Returns !0
+// if all went well.
+int retab_targets( const Retab &rt, int threads )
+{
+    int changed = 0;
+    int differ  = 0;
+    int result  = !0;
+    int i;
+
+#ifdef RETAB_PARALLEL
+    std::thread *workers;
+
+    if( threads > target_count ) threads = target_count;
+    if( threads > 1 ) {
+        workers = new std::thread[threads];
+        for( i = 0; i < threads; i++ ) workers[i] = std::thread( target_worker, &rt );
+        for( i = 0; i < threads; i++ ) workers[i].join( );
+        delete [] workers;
+    }
+    else target_worker( &rt );
+#else
+    ( void )threads;
+    target_worker( &rt );
+#endif
+
+    for( i = 0; i < target_count; i++ ) {
+        switch( targets[i].result ) {
+        case CHANGED:
+            changed++;
+            break;
+
+        case SKIPPED:
+            printf( "Binary file %s left alone\n", targets[i].name );
+            break;
+
+        case FAILED:
+            printf( "ERROR:  %s %s\n", targets[i].error, targets[i].name );
+            result = 0;
+            break;
+
+        case DIFFERS:
+            printf( "%s:%ld\n", targets[i].name, targets[i].line );
+            differ++;
+            result = 0;
+            break;
+        }
+        free( targets[i].name );
+    }
+    if( checking ) printf( "%d of %d files would change\n", differ, target_count );
+    else printf( "%d of %d files changed\n", changed, target_count );
+    free( targets );
+    return result;
+}
+
+#endif
+
+
+// Returns the number of processors, if that can be found.
+int default_threads( )
+{
+#ifdef RETAB_PARALLEL
+    unsigned count = std::thread::hardware_concurrency( );
+
+    if( count > 0 ) return ( int )count;
+#endif
+    return 4;
 }
 
 
 int main(int argc, char **argv)
 {
-           int   delimiter;
-           int   i;
-           FILE *old_file;
-           FILE *new_file;
-    static char *old_file_name = NULL;
-    static char *new_file_name = NULL;
-    static int   error         = 0;
-    static int   old_tabs      = OLDTABS;
-    static int   new_tabs      = NEWTABS;
-    static int   blanks        = 0;
-    static int   column        = 0;
-    static int   literal       = 0;
-    static int   state         = NORMAL;
+           int    i;
+    static char  *old_file_name = NULL;
+    static char  *new_file_name = NULL;
+    static int    error         = 0;
+    static Retab  rt            = { OLDTABS, NEWTABS, NORMAL, 0, 0, 0, 0, 0, 0 };
+    static int    threads       = 0;        //  0 if not given.
+    static int    in_place      = 0;
+           char **names         = new char *[argc];
+           int    name_count    = 0;
     
     printf( "RETAB  (Version 0.1)  Compiled: %s\n", adjust_date( __DATE__ ) );
 
@@ -173,7 +1545,7 @@ int main(int argc, char **argv)
                     printf( "ERROR:  New tab increment < 1\n\n" );
                     error = !0;
                 }
-                else new_tabs = i;
+                else rt.new_tabs = i;
                 break;
 
             case 'o':
@@ -182,129 +1554,86 @@ int main(int argc, char **argv)
                     printf( "ERROR:  Old tab increment < 1\n\n" );
                     error = !0;
                 }
-                else old_tabs = i;
+                else rt.old_tabs = i;
                 break;
 
+            case 'j':
+            case 'J':
+                if( *( *argv + 2 ) == '\0' ) threads = default_threads( );
+                else if( ( i = atoi( *argv + 2 ) ) < 1 ) {
+                    printf( "ERROR:  Thread count < 1\n\n" );
+                    error = !0;
+                }
+                else threads = i;
+                break;
+
+            case 'w':
+            case 'W':
+                rt.east_asian = !0;
+                break;
+
+            case 'l':
+            case 'L':
+                rt.indent_only = !0;
+                break;
+
+#ifdef RETAB_POSIX
+            case 'i':
+            case 'I':
+                in_place = !0;
+                break;
+
+            case 'c':
+            case 'C':
+                in_place = !0;
+                checking = !0;
+                break;
+#endif
+
             default:
                 printf( "ERROR:  Illegal option %s\n\n", *argv );
                 error = !0;
                 break;
             }
         }
-        else if( !old_file_name ) old_file_name = *argv;
-        else if( !new_file_name ) new_file_name = *argv;
-        else {
-            printf( "ERROR:  Extra filename %s\n\n", *argv );
+        else names[name_count++] = *argv;
+    }
+
+#ifdef RETAB_POSIX
+    if( in_place ) {
+        if( name_count == 0 ) {
+            print_usage( );
             error = !0;
         }
+        for( i = 0; i < name_count; i++ ) {
+            if( !add_name( names[i] ) ) {
+                printf( "ERROR:  No files match %s\n\n", names[i] );
+                error = !0;
+            }
+        }
+        if( !error ) {
+            init_special( );
+            if( !retab_targets( rt, threads ? threads : default_threads( ) ) ) error = !0;
+        }
+        delete [] names;
+        return error;
     }
-    if( !old_file_name || !new_file_name ) {
-        print_usage( );
+#endif
+
+    if( name_count > 0 ) old_file_name = names[0];
+    if( name_count > 1 ) new_file_name = names[1];
+    for( i = 2; i < name_count; i++ ) {
+        printf( "ERROR:  Extra filename %s\n\n", names[i] );
         error = !0;
     }
-    else if( ( old_file = fopen( old_file_name, "r" ) ) == NULL ) {
-        printf( "ERROR:  Cannot find file %s\n\n", old_file_name );
+    if( !old_file_name || !new_file_name ) {
+        print_usage( );
         error = !0;
     }
     else {
-        if( ( new_file = fopen( new_file_name, "w" ) ) == NULL ) {
-            printf( "ERROR:  Cannot create file %s\n\n", new_file_name );
-            error = !0;
-        }
-        else {
-            setvbuf( old_file, NULL, _IOFBF, 8*1024 );
-            setvbuf( new_file, NULL, _IOFBF, 8*1024 );
-            while( ( i = getc( old_file ) ) != EOF ) {
-                i &= 0177;
-                switch( state ) {
-          	
-                case NORMAL:
-                    switch( i ) {
-                    case '\n':
-                        column = 0;
-                        putc( '\n', new_file );
-                        break;
-
-                    case '\t':
-                        blanks = old_tabs -  column % old_tabs;
-                        state = BLANK;
-                        break;
-
-                    case ' ':
-                        blanks = 1;
-                        state = BLANK;
-                        break;
-
-                    case '\'':
-                    case '"':
-                        delimiter = i;
-                        ++column;
-                        putc( i, new_file );
-                        break;
-
-                    default:
-                        ++column;
-                        putc( i, new_file );
-                        break;
-                    }
-                    break;
-
-                case QUOTE:
-                    switch( i ) {
-                    case '\n':
-                        if( !literal ) state = NORMAL;
-                        column = 0;
-                        break;
-
-                    case '\t':
-                        column += new_tabs - column % new_tabs;
-                        break;
-
-                    case '\'':
-                    case '"' :
-                        if( !literal && i == delimiter ) state = NORMAL;
-                        ++column;
-                        break;
-
-                    default:
-                        ++column;
-                        break;
-                    }
-                    putc( i, new_file );
-                    break;
-
-                case BLANK:
-                    switch( i ) {
-                    case '\t':
-                        blanks += old_tabs - ( column + blanks ) % old_tabs;
-                        break;
-
-                    case ' ':
-                        ++blanks;
-                        break;
-
-                    case '"':
-                    case '\'':
-                        delimiter = i;
-                        state = QUOTE;
-                        entab( i, blanks, new_tabs, column, new_file );
-                        break;
-
-                    default:
-                        state = NORMAL;
-                        entab( i, blanks, new_tabs, column, new_file );
-                        break;
-                    }
-                    break;
-                }
-                literal = !literal && i == '\\';
-            }
-            if( ferror( new_file) || fclose( new_file ) ) {
-                printf( "ERROR:  Disk full\n\n" );
-                error = !0;
-            }
-        }
-        fclose( old_file );
+        init_special( );
+        if( !retab_file( rt, old_file_name, new_file_name, threads ? threads : 1 ) ) error = !0;
     }
+    delete [] names;
     return error;
 }
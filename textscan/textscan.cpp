@@ -12,28 +12,177 @@
 /*      The program  was designed  to scan whole groups of files. Thus it */
 /* accepts wildcards on the command line. The name of each file is echoed */
 /* to the  output so  that a meaningful report can be generated using I/O */
-/* redirection.                                                           */
+/* redirection.  The files are scanned by several threads at once but the */
+/* reports are printed in the order the files were named. A very large    */
+/* file is split among the threads (see scan_split()).                    */
 /*                                                                        */
 /*      Usage:                                                            */
-/*	textscan infile [infile...]					  */
+/*	textscan [-jn] [-s] [-m] [-en] infile [infile...]		  */
+/*									  */
+/*	-jn	Scan n files at once (default: one per processor).	  */
+/*	-s	Print only the summary of each file.			  */
+/*	-m	Print the counts of each file as JSON.			  */
+/*	-en	Print at most n lines for each kind of thing found.	  */
 /*									  */
 /* Peter Chapin 							  */
 /* P.O. Box 317 							  */
 /* Randolph Ctr, VT 05061						  */
 /*========================================================================*/
 
+#include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1900)
+#define TEXTSCAN_THREADS
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+/* Large files can be split among the threads on systems with pread(). */
+#if defined(TEXTSCAN_THREADS) && (defined(__unix__) || defined(__APPLE__))
+#define TEXTSCAN_SPLIT
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/* Compile with TEXTSCAN_NO_SIMD defined to force the plain version. */
+#if !defined(TEXTSCAN_NO_SIMD) && defined(__AVX2__)
+#define TEXTSCAN_AVX2
+#include <immintrin.h>
+#elif !defined(TEXTSCAN_NO_SIMD) && \
+    (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define TEXTSCAN_SSE2
+#include <emmintrin.h>
+#endif
+
+#define BLOCK_SIZE (1024*1024)	/* Amount of a file read at a time.	*/
+#define GROUP	   32		/* Characters checked at once.		*/
+#define SPLIT_SIZE (64L*1024*1024)	/* Files this large are split.	*/
+#define CHUNK_SIZE (8*1024*1024)	/* Size of the pieces.		*/
+
+/* The kinds of things reported. */
+#define TRAILING_WHITE	0
+#define BELL		1
+#define BACKSPACE	2
+#define FORM_FEED	3
+#define CARRIAGE_RETURN 4
+#define VERTICAL_TAB	5
+#define DELETE_CHAR	6
+#define ODD_CONTROL	7
+#define NON_ASCII	8
+#define KINDS		9
 
 /*=================================*/
 /*	     Global Data	   */
 /*=================================*/
 
-long ccount[256];	 /* Array holds counts for each character. */
+/* How often one kind of thing was found in a file. */
+struct Tally {
+  long	      count;
+  long	      first_line;
+  long	      last_line;
+};
+
+/* One file named on the command line. Its report is kept until it can be
+   printed in turn. */
+struct FileScan {
+  const char *name;
+  char	     *text;		/* The report.				*/
+  size_t      used;
+  size_t      size;
+  int	      opened;		/* =false if the file couldn't be opened.	*/
+  int	      done;		/* =true when the scan is finished.	*/
+  int	      split;		/* =true if the file is split (see	*/
+				/*   scan_split()).			*/
+  Tally       tally[KINDS];
+};
+
+/* A character to report. */
+struct Event {
+  long	      line;
+  int	      c;
+};
+
+struct Events {
+  Event      *list;
+  size_t      count;
+  size_t      size;
+};
+
+/* The work area of one thread. The character in front of the block is the
+   last one of the previous block so that the character before any
+   character can be seen. */
+struct Scanner {
+  long		ccount[256];	/* Counts for each character.		*/
+  Events	events; 	/* Found in the current block.		*/
+  unsigned char block_area[1 + BLOCK_SIZE];
+};
+
+const char *const kind_name[KINDS] = {
+  "Trailing white space", "Bell character", "Backspace", "Form feed",
+  "Carriage return", "Vertical tab", "Delete character",
+  "Odd control character", "Non ASCII character"
+};
+
+const char *const kind_key[KINDS] = {	/* The names used in JSON.	*/
+  "trailing_white_space", "bell", "backspace", "form_feed",
+  "carriage_return", "vertical_tab", "delete", "odd_control", "non_ascii"
+};
+
+int	  summary_only = false; /* =true to leave out the lines found (-s). */
+int	  json_output = false;	/* =true for JSON (-m). 		*/
+long	  event_limit = -1L;	/* Lines printed of each kind (-e), or -1. */
+
+FileScan *files;		/* The files in the order named.	*/
+int	  file_count = 0;
+int	  next_file = 0;	/* The next one to be scanned.		*/
+int	  printed = 0;		/* Files whose reports have been printed. */
+int	  ahead;		/* How many reports may be waiting.	*/
+
+#ifdef TEXTSCAN_THREADS
+std::mutex		file_lock;
+std::condition_variable file_changed;
+#endif
 
 /*==========================================*/
 /*	     Function Definitions	    */
 /*==========================================*/
 
+/*------------------------------------------------------------------------*/
+/* void put(FileScan *scan, const char *format, ...);                     */
+/*                                                                        */
+/*      This function adds to the report of a file as printf() would.     */
+/*------------------------------------------------------------------------*/
+
+void put(FileScan *scan, const char *format, ...)
+  {
+    va_list args;
+    int     n;
+    char   *more;
+
+    for (;;) {
+      va_start(args, format);
+      n = vsnprintf(scan->text + scan->used, scan->size - scan->used, format, args);
+      va_end(args);
+      if (n < 0) return;
+      if (scan->used + n < scan->size) {
+	scan->used += n;
+	return;
+      }
+      if ((more = (char *)realloc(scan->text, 2*scan->size + n + 256)) == NULL) {
+	fprintf(stderr, "\n\nOut of memory.\n\n");
+	exit(1);
+      }
+      scan->text = more;
+      scan->size = 2*scan->size + n + 256;
+    }
+  }
+
 /*------------------------------------------------------------------------*/
 /* int unknown_cntrl(int c);                                              */
 /*                                                                        */
@@ -59,29 +208,66 @@ int unknown_cntrl(int c)
   }
 
 /*------------------------------------------------------------------------*/
-/* void print_report(long counts[]);                                      */
+/* void put_json_string(FileScan *scan, const char *text);                */
 /*                                                                        */
-/*      This function  prints the  summary report  at the  end of a scan. */
-/*      Counts is  an array  with 256  elements containing  the number of */
-/*      occurances of  each character.  Although the current version does */
-/*	not use all of this information, future versions may.		  */
+/*      This function adds a quoted JSON string to the report of a file.  */
+/*------------------------------------------------------------------------*/
+
+void put_json_string(FileScan *scan, const char *text)
+  {
+    put(scan, "\"");
+    for ( ; *text; text++) {
+      if (*text == '"' || *text == '\\') put(scan, "\\%c", *text);
+      else if ((unsigned char)*text < 0x20) put(scan, "\\u%04x", (unsigned char)*text);
+      else put(scan, "%c", *text);
+    }
+    put(scan, "\"");
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void add_up(long counts[], long *sumup, long *bad_cntrl,               */
+/*	       long *non_ascii);					  */
+/*                                                                        */
+/*      This function works out the totals in the summary from the count */
+/*      of each character.                                                */
 /*------------------------------------------------------------------------*/
 
-void print_report(long counts[])
+void add_up(long counts[], long *sumup, long *bad_cntrl, long *non_ascii)
   {
-    long sumup=0L;
-    long bad_cntrl=0L;
-    long non_ascii=0L;
     int  i;
 
-    for (i=0; i<256; i++) sumup += counts[i];
+    *sumup = *bad_cntrl = *non_ascii = 0L;
+    for (i=0; i<256; i++) *sumup += counts[i];
     for (i=0; i<0x20; i++) {
-      if (i != '\t' && i != '\n') bad_cntrl += counts[i];
+      if (i != '\t' && i != '\n') *bad_cntrl += counts[i];
     }
-    bad_cntrl += counts[127];
-    for (i=128; i<256; i++) non_ascii += counts[i];
+    *bad_cntrl += counts[127];
+    for (i=128; i<256; i++) *non_ascii += counts[i];
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void print_report(FileScan *scan, long counts[]);                      */
+/*                                                                        */
+/*      This function  prints the  summary report  at the  end of a scan. */
+/*      Counts is  an array  with 256  elements containing  the number of */
+/*      occurances of  each character.  Although the current version does */
+/*	not use all of this information, future versions may. If only the */
+/*	summary is wanted, or some of the lines found were left out, the  */
+/*	number of each kind of thing found is given as well.		  */
+/*------------------------------------------------------------------------*/
 
-    printf("\n\nSummary:\n\n"
+void print_report(FileScan *scan, long counts[])
+  {
+    long sumup;
+    long bad_cntrl;
+    long non_ascii;
+    int  left_out = summary_only;
+    int  i;
+
+    add_up(counts, &sumup, &bad_cntrl, &non_ascii);
+    put(scan, "\n\nSummary:\n\n"
 	   "Total number of characters found.................: %ld\n"
 	   "Total number of terminated lines found...........: %ld\n"
 	   "Total number of spaces found.....................: %ld\n"
@@ -94,83 +280,784 @@ void print_report(long counts[])
 	   counts['\t'],
 	   bad_cntrl,
 	   non_ascii );
+
+    for (i=0; i<KINDS; i++) {
+      if (event_limit >= 0 && scan->tally[i].count > event_limit) left_out = true;
+    }
+    if (!left_out) return;
+    put(scan, "\nFound                    Number  First line   Last line\n\n");
+    for (i=0; i<KINDS; i++) {
+      if (scan->tally[i].count == 0) continue;
+      put(scan, "%-21s %10ld  %10ld  %10ld\n", kind_name[i], scan->tally[i].count,
+	  scan->tally[i].first_line, scan->tally[i].last_line);
+    }
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void print_json(FileScan *scan, long counts[], int unterminated);      */
+/*                                                                        */
+/*      This function gives the results for a file as a JSON object (-m).  */
+/*------------------------------------------------------------------------*/
+
+void print_json(FileScan *scan, long counts[], int unterminated)
+  {
+    long sumup;
+    long bad_cntrl;
+    long non_ascii;
+    int  first = true;
+    int  i;
+
+    add_up(counts, &sumup, &bad_cntrl, &non_ascii);
+    put(scan, "  {\"file\": ");
+    put_json_string(scan, scan->name);
+    put(scan, ", \"characters\": %ld, \"lines\": %ld, \"spaces\": %ld, \"tabs\": %ld, "
+	      "\"other_control\": %ld, \"non_ascii\": %ld, \"unterminated\": %s,\n"
+	      "   \"found\": {",
+	sumup, counts['\n'], counts[' '], counts['\t'], bad_cntrl, non_ascii,
+	unterminated ? "true" : "false");
+    for (i=0; i<KINDS; i++) {
+      if (scan->tally[i].count == 0) continue;
+      put(scan, "%s\n     \"%s\": {\"count\": %ld, \"first_line\": %ld, \"last_line\": %ld}",
+	  first ? "" : ",", kind_key[i], scan->tally[i].count,
+	  scan->tally[i].first_line, scan->tally[i].last_line);
+      first = false;
+    }
+    put(scan, first ? "}}" : "\n   }}");
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void finish_report(FileScan *scan, long counts[], int unterminated);   */
+/*                                                                        */
+/*      This function ends the report of a file that has been scanned.   */
+/*      Unterminated is true if the last line doesn't end with '\n'.     */
+/*------------------------------------------------------------------------*/
+
+void finish_report(FileScan *scan, long counts[], int unterminated)
+  {
+    if (json_output) {
+      print_json(scan, counts, unterminated);
+      return;
+    }
+    if (unterminated) {
+      put(scan, "\nLast line in the file does not end with the \'\\n\' character");
+    }
+    print_report(scan, counts);
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void count_block(long counts[], const unsigned char *p, size_t n);     */
+/*                                                                        */
+/*      This function adds the characters of a block to counts[]. Four    */
+/*      histograms are kept and the characters are spread over them in    */
+/*      turn, so that a run of the same character does not make each      */
+/*      increment wait for the one before it to be stored. They are       */
+/*      added together at the end.                                        */
+/*------------------------------------------------------------------------*/
+
+void count_block(long counts[], const unsigned char *p, size_t n)
+  {
+    uint32_t	    sub[4][256];
+    uint64_t	    word;
+    int 	    i;
+
+    memset(sub, 0, sizeof(sub));
+    for ( ; n >= 8; p += 8, n -= 8) {
+      memcpy(&word, p, 8);
+      sub[0][ word	  & 0xFF]++;
+      sub[1][(word >>  8) & 0xFF]++;
+      sub[2][(word >> 16) & 0xFF]++;
+      sub[3][(word >> 24) & 0xFF]++;
+      sub[0][(word >> 32) & 0xFF]++;
+      sub[1][(word >> 40) & 0xFF]++;
+      sub[2][(word >> 48) & 0xFF]++;
+      sub[3][ word >> 56	 ]++;
+    }
+    while (n-- > 0) sub[0][*p++]++;
+    for (i=0; i<256; i++) counts[i] += sub[0][i] + sub[1][i] + sub[2][i] + sub[3][i];
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* int is_event(const unsigned char *p);                                  */
+/*                                                                        */
+/*      This function returns true if the character at p is reported: a   */
+/*      control character other than '\t' and '\n', DEL, a non ASCII     */
+/*      character, or a '\n' after a space or a tab. The character in     */
+/*      front of p must be readable.                                      */
+/*------------------------------------------------------------------------*/
+
+int is_event(const unsigned char *p)
+  {
+    if (*p == '\n') return p[-1] == ' '  ||  p[-1] == '\t';
+    return *p < 0x20  ?  *p != '\t'  :  *p >= 127;
+  }
+
+/*------------------------------------------------------------------------*/
+/* unsigned event_mask(const unsigned char *p);                           */
+/*                                                                        */
+/*      This function returns a bit for each of the GROUP characters at p */
+/*      that is_event() is true for. Most groups in a text file have      */
+/*      none, and those are passed over with a few vector compares.       */
+/*------------------------------------------------------------------------*/
+
+#if defined(TEXTSCAN_AVX2)
+
+unsigned event_mask(const unsigned char *p)
+  {
+    const __m256i x    = _mm256_loadu_si256((const __m256i *)p);
+    const __m256i prev = _mm256_loadu_si256((const __m256i *)(p - 1));
+    const __m256i nl   = _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\n'));
+
+    /* Signed compare: the non ASCII characters are below 0x20 as well. */
+    __m256i odd = _mm256_andnot_si256(
+      _mm256_or_si256(nl, _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\t'))),
+      _mm256_cmpgt_epi8(_mm256_set1_epi8(0x20), x));
+    odd = _mm256_or_si256(odd, _mm256_cmpeq_epi8(x, _mm256_set1_epi8(127)));
+
+    __m256i trail = _mm256_and_si256(nl, _mm256_or_si256(
+      _mm256_cmpeq_epi8(prev, _mm256_set1_epi8(' ')),
+      _mm256_cmpeq_epi8(prev, _mm256_set1_epi8('\t'))));
+
+    return (unsigned)_mm256_movemask_epi8(_mm256_or_si256(odd, trail));
+  }
+
+#elif defined(TEXTSCAN_SSE2)
+
+unsigned event_mask_16(const unsigned char *p)
+  {
+    const __m128i x    = _mm_loadu_si128((const __m128i *)p);
+    const __m128i prev = _mm_loadu_si128((const __m128i *)(p - 1));
+    const __m128i nl   = _mm_cmpeq_epi8(x, _mm_set1_epi8('\n'));
+
+    /* Signed compare: the non ASCII characters are below 0x20 as well. */
+    __m128i odd = _mm_andnot_si128(
+      _mm_or_si128(nl, _mm_cmpeq_epi8(x, _mm_set1_epi8('\t'))),
+      _mm_cmplt_epi8(x, _mm_set1_epi8(0x20)));
+    odd = _mm_or_si128(odd, _mm_cmpeq_epi8(x, _mm_set1_epi8(127)));
+
+    __m128i trail = _mm_and_si128(nl, _mm_or_si128(
+      _mm_cmpeq_epi8(prev, _mm_set1_epi8(' ')),
+      _mm_cmpeq_epi8(prev, _mm_set1_epi8('\t'))));
+
+    return (unsigned)_mm_movemask_epi8(_mm_or_si128(odd, trail));
+  }
+
+unsigned event_mask(const unsigned char *p)
+  {
+    return event_mask_16(p) | (event_mask_16(p + 16) << 16);
+  }
+
+#else
+
+unsigned event_mask(const unsigned char *p)
+  {
+    unsigned mask = 0;
+    int      i;
+
+    for (i=0; i<GROUP; i++) {
+      if (is_event(p + i)) mask |= 1u << i;
+    }
+    return mask;
+  }
+
+#endif
+
+/*------------------------------------------------------------------------*/
+/* int event_kind(int c);                                                 */
+/*                                                                        */
+/*      This function returns the kind of a character that is_event() was */
+/*      true for.                                                         */
+/*------------------------------------------------------------------------*/
+
+int event_kind(int c)
+  {
+    if (c == '\n')	   return TRAILING_WHITE;
+    else if (c == '\a')   return BELL;
+    else if (c == '\b')   return BACKSPACE;
+    else if (c == '\f')   return FORM_FEED;
+    else if (c == '\r')   return CARRIAGE_RETURN;
+    else if (c == '\v')   return VERTICAL_TAB;
+    else if (c == 127)	   return DELETE_CHAR;
+    else if (c < 0x20)	   return ODD_CONTROL;
+    else		   return NON_ASCII;
+  }
+
+/*------------------------------------------------------------------------*/
+/* int wanted(long count);                                                */
+/*                                                                        */
+/*      This function returns true if the message for the count'th thing */
+/*      of a kind is printed.                                             */
+/*------------------------------------------------------------------------*/
+
+int wanted(long count)
+  {
+    if (summary_only || json_output) return false;
+    return event_limit < 0 || count <= event_limit;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void print_event(FileScan *scan, int c, long line);                    */
+/*                                                                        */
+/*      This function reports the message for a character that is_event() */
+/*      was true for, on the given line.                                  */
+/*------------------------------------------------------------------------*/
+
+void print_event(FileScan *scan, int c, long line)
+  {
+    if (c == '\n')
+      put(scan, "\nLine %5ld: Trailing white space", line);
+    else if (c == '\a')
+      put(scan, "\nLine %5ld: Bell character found", line);
+    else if (c == '\b')
+      put(scan, "\nLine %5ld: Backspace found", line);
+    else if (c == '\f')
+      put(scan, "\nLine %5ld: Form feed found", line);
+    else if (c == '\r')
+      put(scan, "\nLine %5ld: Carriage return found", line);
+    else if (c == '\v')
+      put(scan, "\nLine %5ld: Line feed found", line);
+    else if (c == 127)
+      put(scan, "\nLine %5ld: Delete character found", line);
+    else if (unknown_cntrl(c)) {
+      put(scan, "\nLine %5ld: Odd control character found: 0x%02X: ^%c",
+	      line, (unsigned) c, c+0x40);
+    }
+    else {
+      put(scan, "\nLine %5ld: Non ASCII character found: 0x%02X",
+	      line, (unsigned) c);
+    }
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void add_event(Events *events, int c, long line);                      */
+/*                                                                        */
+/*      This function adds a character to report to a list of them.       */
+/*------------------------------------------------------------------------*/
+
+void add_event(Events *events, int c, long line)
+  {
+    Event *more;
+
+    if (events->count == events->size) {
+      events->size = (events->size == 0) ? 256 : 2*events->size;
+      if ((more = (Event *)realloc(events->list, events->size*sizeof(Event))) == NULL) {
+	fprintf(stderr, "\n\nOut of memory.\n\n");
+	exit(1);
+      }
+      events->list = more;
+    }
+    events->list[events->count].c    = c;
+    events->list[events->count].line = line;
+    events->count++;
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void scan_block(long counts[], const unsigned char *block, size_t n,   */
+/*		   long lines, Tally tally[], Events *events);		  */
+/*                                                                        */
+/*      This function adds the characters of a block to counts[] and the  */
+/*      characters to report in it to tally[]. Those whose messages are   */
+/*      printed are added to events as well. Lines is the number of       */
+/*      new-lines in front of the block. The character in front of the   */
+/*      block must be readable. The block is counted in one pass and then */
+/*      checked GROUP characters at a time for characters to report; the  */
+/*      line number is only worked out (by counting new-lines from the    */
+/*      last place it was known) when there is something to report.       */
+/*------------------------------------------------------------------------*/
+
+void scan_block(long counts[], const unsigned char *block, size_t n,
+		long lines, Tally tally[], Events *events)
+  {
+    const unsigned char *known = block; /* Where lines was counted up to.   */
+    const unsigned char *p;
+    const unsigned char *end = block + n;
+    const void		*found;
+    Tally		*kind;
+    unsigned		 mask;
+    int 		 i;
+
+    count_block(counts, block, n);
+    for (p = block; p < end; p += GROUP) {
+      if (end - p >= GROUP) mask = event_mask(p);
+      else {
+	for (mask = 0, i = 0; p + i < end; i++) {
+	  if (is_event(p + i)) mask |= 1u << i;
+	}
+      }
+      for ( ; mask != 0; mask &= mask - 1) {
+	for (i = 0; ((mask >> i) & 1) == 0; i++) ;
+	while ((found = memchr(known, '\n', p + i - known)) != NULL) {
+	  lines++;
+	  known = (const unsigned char *)found + 1;
+	}
+	known = p + i;
+	kind = &tally[event_kind(p[i])];
+	if (kind->count++ == 0) kind->first_line = lines + 1;
+	kind->last_line = lines + 1;
+	if (wanted(kind->count)) add_event(events, p[i], lines + 1);
+      }
+    }
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* int scan_file(FILE *infile, Scanner *scanner, FileScan *scan);         */
+/*                                                                        */
+/*      This function scans an open file a block at a time, reporting a   */
+/*      message for each unusual thing found in it, and leaves the counts */
+/*      of its characters in the scanner's ccount[]. It returns true if  */
+/*      the last line of the file doesn't end with '\n'.                 */
+/*------------------------------------------------------------------------*/
+
+int scan_file(FILE *infile, Scanner *scanner, FileScan *scan)
+  {
+    long	  *ccount = scanner->ccount;
+    unsigned char *block  = scanner->block_area + 1;
+    size_t	   n;			/* Characters in the block.	    */
+    size_t	   k;
+    int 	   last = '\n';		/* Last character of the file.	    */
+    int 	   i;
+
+    for (i=0; i<256; i++) ccount[i] = 0L;
+    block[-1] = '\n';
+    while ((n = fread(block, 1, BLOCK_SIZE, infile)) > 0) {
+      scanner->events.count = 0;
+      scan_block(ccount, block, n, ccount['\n'], scan->tally, &scanner->events);
+      for (k = 0; k < scanner->events.count; k++)
+	print_event(scan, scanner->events.list[k].c, scanner->events.list[k].line);
+      last = block[n - 1];
+      block[-1] = block[n - 1];
+    }
+    return last != '\n';
+  }
+
+/*------------------------------------------------------------------------*/
+/* void scan_one(FileScan *scan, Scanner *scanner);                       */
+/*                                                                        */
+/*      This function scans one file into its report.                     */
+/*------------------------------------------------------------------------*/
+
+void scan_one(FileScan *scan, Scanner *scanner)
+  {
+    FILE *infile;	/* Points to the input file.	     */
+    int   unterminated;
+
+    if ((infile=fopen(scan->name, "r")) == NULL) {
+      scan->opened = false;
+      return;
+    }
+    scan->opened = true;
+    if (!json_output) put(scan, "\n\n********** FILE: %s **********\n\n", scan->name);
+    unterminated = scan_file(infile, scanner, scan);
+    fclose(infile);
+    finish_report(scan, scanner->ccount, unterminated);
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void print_scan(FileScan *scan);                                       */
+/*                                                                        */
+/*      This function prints the report of a file and lets it go.         */
+/*------------------------------------------------------------------------*/
+
+void print_scan(FileScan *scan)
+  {
+    if (!scan->opened) {
+      fprintf(stderr, "\n\nCan't open %s; ignoring.\n\n", scan->name);
+      if (json_output) {
+	put(scan, "  {\"file\": ");
+	put_json_string(scan, scan->name);
+	put(scan, ", \"error\": \"can't open\"}");
+      }
+    }
+    fwrite(scan->text, 1, scan->used, stdout);
+    free(scan->text);
+    scan->text = NULL;
     return;
   }
 
+#ifdef TEXTSCAN_SPLIT
+
+/*------------------------------------------------------------------------*/
+/*      A file larger than SPLIT_SIZE is split into chunks which are      */
+/*      scanned at the same time by several threads. A chunk can't know   */
+/*      its line numbers, so each one keeps its tallies and events with   */
+/*      the lines counted from its own start, along with its character    */
+/*      counts. Only the events that might be printed are kept: none with */
+/*      -s or -m, and no more than the -e limit of each kind, so with     */
+/*      those options the chunks waiting to be taken stay small however   */
+/*      odd the file is. The chunks are then taken in order: the new-     */
+/*      lines of the chunks in front of each one are added up to give its */
+/*      line numbers, and its tallies and counts are added to those of    */
+/*      the file. Each chunk is read together with the character in front */
+/*      of it, so a new-line at its start that ends a line with trailing  */
+/*      white space is seen just as it is when the file is scanned from   */
+/*      the beginning. The report is the same.                            */
+/*------------------------------------------------------------------------*/
+
+struct Chunk {
+  off_t       start;
+  size_t      length;
+  long	      counts[256];
+  Tally       tally[KINDS];	/* Lines counted from the chunk's start.	*/
+  Events      events;		/* Only those that might be printed.	*/
+  int	      last;		/* The last character of the chunk.	*/
+  int	      failed;		/* =true if the chunk couldn't be read. */
+  int	      done;
+};
+
+struct Split {
+  int			  fd;
+  Chunk 		 *chunks;
+  int			  count;
+  int			  next;		/* The next chunk to be scanned.	*/
+  int			  taken;	/* Chunks added into the report.	*/
+  int			  ahead;	/* How many chunks may be waiting.	*/
+  std::mutex		  lock;
+  std::condition_variable changed;
+};
+
+/*------------------------------------------------------------------------*/
+/* int read_at(int fd, unsigned char *buffer, size_t n, off_t where);     */
+/*                                                                        */
+/*      This function reads n characters from the given place in a file.  */
+/*      It returns false if they can't all be read.                       */
+/*------------------------------------------------------------------------*/
+
+int read_at(int fd, unsigned char *buffer, size_t n, off_t where)
+  {
+    ssize_t got;
+
+    while (n > 0) {
+      if ((got = pread(fd, buffer, n, where)) <= 0) return false;
+      buffer += got;
+      where  += got;
+      n      -= (size_t)got;
+    }
+    return true;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void split_worker(Split *split);                                       */
+/*                                                                        */
+/*      This function is run by each thread scanning a split file.        */
+/*------------------------------------------------------------------------*/
+
+void split_worker(Split *split)
+  {
+    unsigned char *area = new unsigned char[1 + CHUNK_SIZE];
+    Chunk	  *chunk;
+    std::unique_lock<std::mutex> hold(split->lock);
+
+    while (split->next < split->count) {
+      if (split->next >= split->taken + split->ahead) {
+	split->changed.wait(hold);
+	continue;
+      }
+      chunk = &split->chunks[split->next++];
+      hold.unlock();
+
+      area[0] = '\n';
+      if (chunk->start == 0)
+	chunk->failed = !read_at(split->fd, area + 1, chunk->length, 0);
+      else
+	chunk->failed = !read_at(split->fd, area, chunk->length + 1, chunk->start - 1);
+      if (!chunk->failed) {
+	scan_block(chunk->counts, area + 1, chunk->length, 0L, chunk->tally, &chunk->events);
+	chunk->last = area[chunk->length];
+      }
+
+      hold.lock();
+      chunk->done = true;
+      split->changed.notify_all();
+    }
+    hold.unlock();
+    delete [] area;
+    return;
+  }
+
+/*------------------------------------------------------------------------*/
+/* void scan_split(FileScan *scan, int threads);                          */
+/*                                                                        */
+/*      This function scans a large file with the given number of         */
+/*      threads. The report is printed as it goes.                        */
+/*------------------------------------------------------------------------*/
+
+void scan_split(FileScan *scan, int threads)
+  {
+    Split	 split;
+    Chunk	*chunk;
+    struct stat  info;
+    std::thread *workers;
+    long	 totals[256];
+    long	 seen[KINDS];		/* Of each kind, with the chunk's so far. */
+    long	 lines = 0L;
+    int 	 last = '\n';
+    int 	 stopped = false;	/* =true after a chunk couldn't be read. */
+    size_t	 k;
+    int 	 i;
+    int 	 j;
+
+    if ((split.fd = open(scan->name, O_RDONLY)) < 0) {
+      scan->opened = false;
+      return;
+    }
+    if (fstat(split.fd, &info) != 0) info.st_size = 0;
+    scan->opened = true;
+    if (!json_output) put(scan, "\n\n********** FILE: %s **********\n\n", scan->name);
+
+    split.count  = (int)((info.st_size + CHUNK_SIZE - 1) / CHUNK_SIZE);
+    split.chunks = new Chunk[split.count]();
+    split.next	 = 0;
+    split.taken  = 0;
+    split.ahead  = 2*threads;
+    for (i=0; i<split.count; i++) {
+      chunk = &split.chunks[i];
+      chunk->start  = (off_t)i * CHUNK_SIZE;
+      chunk->length = (info.st_size - chunk->start < CHUNK_SIZE) ?
+		      (size_t)(info.st_size - chunk->start) : CHUNK_SIZE;
+    }
+    workers = new std::thread[threads];
+    for (i=0; i<threads; i++) workers[i] = std::thread(split_worker, &split);
+
+    for (j=0; j<256; j++) totals[j] = 0L;
+    for (i=0; i<split.count; i++) {
+      chunk = &split.chunks[i];
+      {
+	std::unique_lock<std::mutex> hold(split.lock);
+	while (!chunk->done) split.changed.wait(hold);
+      }
+
+      /* Like fread(), stop at the first part that can't be read. */
+      if (chunk->failed) stopped = true;
+      if (!stopped) {
+	/* Those in front may already have used up the -e limit of a kind. */
+	for (j=0; j<KINDS; j++) seen[j] = scan->tally[j].count;
+	for (k = 0; k < chunk->events.count; k++) {
+	  if (wanted(++seen[event_kind(chunk->events.list[k].c)]))
+	    print_event(scan, chunk->events.list[k].c, lines + chunk->events.list[k].line);
+	}
+	for (j=0; j<KINDS; j++) {
+	  if (chunk->tally[j].count == 0) continue;
+	  if (scan->tally[j].count == 0) scan->tally[j].first_line = lines + chunk->tally[j].first_line;
+	  scan->tally[j].last_line = lines + chunk->tally[j].last_line;
+	  scan->tally[j].count += chunk->tally[j].count;
+	}
+	for (j=0; j<256; j++) totals[j] += chunk->counts[j];
+	lines += chunk->counts['\n'];
+	last = chunk->last;
+	fwrite(scan->text, 1, scan->used, stdout);
+	scan->used = 0;
+      }
+      free(chunk->events.list);
+      {
+	std::lock_guard<std::mutex> hold(split.lock);
+	split.taken++;
+	split.changed.notify_all();
+      }
+    }
+    for (i=0; i<threads; i++) workers[i].join();
+    delete [] workers;
+    delete [] split.chunks;
+    close(split.fd);
+    finish_report(scan, totals, last != '\n');
+    return;
+  }
+
+#endif
+
+#ifdef TEXTSCAN_THREADS
+
+/*------------------------------------------------------------------------*/
+/* void worker();                                                         */
+/*                                                                        */
+/*      This function is run by each thread. It takes the files in turn  */
+/*      but stays no more than ahead files in front of the printing.      */
+/*------------------------------------------------------------------------*/
+
+void worker()
+  {
+    Scanner *scanner = new Scanner();
+    FileScan *scan;
+    std::unique_lock<std::mutex> hold(file_lock);
+
+    while (next_file < file_count) {
+      if (next_file >= printed + ahead) {
+	file_changed.wait(hold);
+	continue;
+      }
+      scan = &files[next_file++];
+      hold.unlock();
+      if (!scan->split) scan_one(scan, scanner);
+      hold.lock();
+      scan->done = true;
+      file_changed.notify_all();
+    }
+    hold.unlock();
+    free(scanner->events.list);
+    delete scanner;
+    return;
+  }
+
+#endif
+
+/*------------------------------------------------------------------------*/
+/* int default_threads();                                                 */
+/*                                                                        */
+/*      This function returns the number of processors, if that can be    */
+/*      found.                                                            */
+/*------------------------------------------------------------------------*/
+
+int default_threads()
+  {
+#ifdef TEXTSCAN_THREADS
+    unsigned count = std::thread::hardware_concurrency();
+
+    if (count > 0) return (int)count;
+#endif
+    return 4;
+  }
+
+/*------------------------------------------------------------------------*/
+/* bool number_option(const char *digits);                                */
+/*                                                                        */
+/*      This function returns true if the text after an option letter is  */
+/*      a non-empty run of decimal digits.                                */
+/*------------------------------------------------------------------------*/
+
+bool number_option(const char *digits)
+  {
+    if (*digits == '\0') return false;
+    while (*digits >= '0' && *digits <= '9') digits++;
+    return *digits == '\0';
+  }
+
+/*------------------------------------------------------------------------*/
+/* int bad_option(const char *option);                                    */
+/*                                                                        */
+/*      This function complains about a malformed option and returns the  */
+/*      exit status for main().                                           */
+/*------------------------------------------------------------------------*/
+
+int bad_option(const char *option)
+  {
+    fprintf(stderr, "\nBad option: %s\n"
+		    "Usage: textscan [-jn] [-s] [-m] [-en] infile [infile...]\n", option);
+    return 1;
+  }
+
 /*==================================*/
 /*	     Main Program	    */
 /*==================================*/
 
 int main(int argc, char *argv[])
   {
-    int 	c;		/* Current character from file.      */
-    int 	trail_white;	/* =true if there is trailing white. */
-    int 	terminated;	/* =false when inside a line.	     */
-    char       *file_name;	/* Actual filename.		     */
-    FILE       *infile; 	/* Points to the input file.	     */
+    int 	thread_count = default_threads();
     int 	i;		/* Index into argv[].		     */
-    int 	j;		/* Used to clear out ccount[].	     */
 
     fprintf(stderr, "TEXTSCAN (May 24, 2000)\n"
 		    "Public Domain Software by Peter Chapin\n");
 
     if (argc == 1)
-      fprintf(stderr, "\nUsage: textscan infile [infile...]\n\n"
+      fprintf(stderr, "\nUsage: textscan [-jn] [-s] [-m] [-en] infile [infile...]\n\n"
 		      "Program scans the input files and reports on unusual\n"
 		      "characters and other odd characteristics.  The input\n"
 		      "files are  assumed to  be text files.  Wildcards are\n"
-		      "allowed.\n");
+		      "allowed. The  -j option sets  the number of files to\n"
+		      "scan at once. With  -s only the  summary is printed,\n"
+		      "with  -m the  counts are  printed as JSON, and with\n"
+		      "-en at most n lines are printed for each kind of odd\n"
+		      "thing found.\n");
 
-    /*------------------*/
-    /* Read input file. */
-    /*------------------*/
+    files = new FileScan[argc];
     for (i=1; i<argc; i++) {
-      while ((file_name=*++argv) != NULL) {
-	if ((infile=fopen(file_name, "r")) == NULL) {
-	  fprintf(stderr, "\n\nCan't open %s; ignoring.\n\n", file_name);
-	}
-	else {
-	  printf("\n\n********** FILE: %s **********\n\n", file_name);
-	  trail_white = false;
-	  terminated = true;
-	  for (j=0; j<256; j++) ccount[j] = 0L;
-	  while ((c=getc(infile)) != EOF) {
-	    ccount[c]++;
-	    if (c == '\n'  &&  trail_white) {
-	      printf("\nLine %5ld: Trailing white space", ccount['\n']);
-	      trail_white = false;
-	    }
-	    if (c == '\a')
-	      printf("\nLine %5ld: Bell character found", ccount['\n']+1);
-	    if (c == '\b')
-	      printf("\nLine %5ld: Backspace found", ccount['\n']+1);
-	    if (c == '\f')
-	      printf("\nLine %5ld: Form feed found", ccount['\n']+1);
-	    if (c == '\r')
-	      printf("\nLine %5ld: Carriage return found", ccount['\n']+1);
-	    if (c == '\v')
-	      printf("\nLine %5ld: Line feed found", ccount['\n']+1);
-	    if (c == 127)
-	      printf("\nLine %5ld: Delete character found", ccount['\n']+1);
-	    if (unknown_cntrl(c)) {
-	      printf("\nLine %5ld: Odd control character found: 0x%02X: ^%c",
-		      ccount['\n']+1, (unsigned) c, c+0x40);
-	    }
-	    if ((unsigned) c > 127) {
-	      printf("\nLine %5ld: Non ASCII character found: 0x%02X",
-		      ccount['\n']+1, (unsigned) c);
-	    }
-	    if (c==' '	||  c=='\t') trail_white=true; else trail_white=false;
-	    if (c == '\n') terminated = true; else terminated = false;
-	  }
-	  if (!terminated) {
-	    printf("\nLast line in the file does not end with the \'\\n\' character");
-	  }
-	  fclose(infile);
-	  print_report(ccount);
-	} /* End of if (can't open file) ... else ...      */
-      }   /* End of while loop that processes each file.   */
-    }	  /* End of for loop that processes each argument. */
+      if (argv[i][0] == '-' && argv[i][1] == 'j') {
+	if (!number_option(argv[i] + 2) || atoi(argv[i] + 2) == 0) return bad_option(argv[i]);
+	thread_count = atoi(argv[i] + 2);
+	continue;
+      }
+      if (strcmp(argv[i], "-s") == 0) {
+	summary_only = true;
+	continue;
+      }
+      if (strcmp(argv[i], "-m") == 0) {
+	json_output = true;
+	continue;
+      }
+      if (argv[i][0] == '-' && argv[i][1] == 'e') {
+	if (!number_option(argv[i] + 2)) return bad_option(argv[i]);
+	event_limit = atol(argv[i] + 2);
+	continue;
+      }
+      files[file_count].name   = argv[i];
+      files[file_count].text   = NULL;
+      files[file_count].used   = 0;
+      files[file_count].size   = 0;
+      files[file_count].opened = false;
+      files[file_count].done   = false;
+      files[file_count].split  = false;
+      memset(files[file_count].tally, 0, sizeof(files[file_count].tally));
+      file_count++;
+    }
+
+    /*-------------------*/
+    /* Read input files. */
+    /*-------------------*/
+#ifdef TEXTSCAN_THREADS
+    std::thread *workers;
+    int 	 pool_size;	/* Threads scanning whole files.	*/
+#ifdef TEXTSCAN_SPLIT
+    struct stat  info;
+
+    for (i=0; i<file_count && thread_count > 1; i++) {
+      if (stat(files[i].name, &info) == 0 && S_ISREG(info.st_mode) &&
+	  info.st_size > SPLIT_SIZE) files[i].split = true;
+    }
+#endif
+
+    pool_size = (thread_count < file_count) ? thread_count : file_count;
+    ahead = 4*pool_size;
+    workers = new std::thread[pool_size];
+    for (i=0; i<pool_size; i++) workers[i] = std::thread(worker);
+    if (json_output) fputs("[\n", stdout);
+    for (i=0; i<file_count; i++) {
+      {
+	std::unique_lock<std::mutex> hold(file_lock);
+	while (!files[i].done) file_changed.wait(hold);
+      }
+      if (json_output && i > 0) fputs(",\n", stdout);
+#ifdef TEXTSCAN_SPLIT
+      if (files[i].split) scan_split(&files[i], thread_count);
+#endif
+      print_scan(&files[i]);
+      {
+	std::lock_guard<std::mutex> hold(file_lock);
+	printed++;
+	file_changed.notify_all();
+      }
+    }
+    if (json_output) fputs("\n]\n", stdout);
+    for (i=0; i<pool_size; i++) workers[i].join();
+    delete [] workers;
+#else
+    Scanner *scanner = new Scanner();
 
+    (void)thread_count;
+    if (json_output) fputs("[\n", stdout);
+    for (i=0; i<file_count; i++) {
+      scan_one(&files[i], scanner);
+      if (json_output && i > 0) fputs(",\n", stdout);
+      print_scan(&files[i]);
+    }
+    if (json_output) fputs("\n]\n", stdout);
+    free(scanner->events.list);
+    delete scanner;
+#endif
+    delete [] files;
     return 0;
   }